@@ -0,0 +1,148 @@
+/*
+ * batch.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Runs a list of guest binaries, each in its own virtual machine, on a
+ * pool of host threads. Every instance gets a wall clock timeout. After
+ * all runs are finished, a result line per binary is printed.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "definitions.hpp"
+#include "machine.hpp"
+
+#define	CYCLES_PER_STEP	4096
+
+enum job_status_t {
+	JOB_PENDING,
+	JOB_OK,
+	JOB_TIMEOUT,
+	JOB_ERROR
+};
+
+struct job_t {
+	char *binary;
+	enum job_status_t status;
+	uint64_t frames;
+	uint64_t cycles;
+	uint64_t ram_hash;
+	double seconds;
+};
+
+static const char *status_names[] = { "pending", "ok", "timeout", "error" };
+
+static uint64_t frames = 600;
+static double timeout = 10.0;
+static const char *rom_file = nullptr;
+
+static std::vector<job_t> jobs;
+static std::atomic<size_t> next_job(0);
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options] <binary> [<binary> ...]\n"
+	       "  -f <frames>       run number of frames per binary (default 600)\n"
+	       "  -t <seconds>      wall clock timeout per binary (default 10)\n"
+	       "  -j <threads>      number of host threads (default all cores)\n"
+	       "  -r <file>         use rom image from file instead of built-in rom\n",
+	       name);
+}
+
+static void run_job(job_t *job)
+{
+	std::chrono::time_point<std::chrono::steady_clock> start_time = std::chrono::steady_clock::now();
+	std::chrono::time_point<std::chrono::steady_clock> deadline = start_time +
+		std::chrono::microseconds((int64_t)(timeout * 1000000));
+
+	E64::machine_t *machine = new E64::machine_t();
+
+	if (rom_file) machine->mmu->use_custom_rom(rom_file);
+	machine->reset();
+
+	if (!machine->mmu->insert_binary(job->binary)) {
+		job->status = JOB_ERROR;
+	} else {
+		job->status = JOB_OK;
+		while (job->frames < frames) {
+			machine->run(CYCLES_PER_STEP);
+			if (machine->frame_done()) job->frames++;
+			if (std::chrono::steady_clock::now() > deadline) {
+				job->status = JOB_TIMEOUT;
+				break;
+			}
+		}
+	}
+
+	job->cycles = machine->m68k->getClock();
+	job->ram_hash = machine->ram_hash();
+	job->seconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start_time).count() / 1000000;
+
+	delete machine;
+}
+
+static void worker()
+{
+	size_t i;
+	while ((i = next_job++) < jobs.size()) run_job(&jobs[i]);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int no_of_threads = std::thread::hardware_concurrency();
+
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc)) {
+			frames = strtoull(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+			timeout = strtod(argv[++i], nullptr);
+		} else if ((strcmp(argv[i], "-j") == 0) && (i + 1 < argc)) {
+			no_of_threads = strtoul(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+			rom_file = argv[++i];
+		} else if (argv[i][0] == '-') {
+			usage(argv[0]);
+			return 1;
+		} else {
+			jobs.push_back({ argv[i], JOB_PENDING, 0, 0, 0, 0.0 });
+		}
+	}
+
+	if (jobs.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (no_of_threads == 0) no_of_threads = 1;
+	if (no_of_threads > jobs.size()) no_of_threads = jobs.size();
+
+	printf("[Batch] Running %lu binaries on %u threads\n", (unsigned long)jobs.size(), no_of_threads);
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < no_of_threads; i++) threads.push_back(std::thread(worker));
+	for (std::thread &t : threads) t.join();
+
+	int failures = 0;
+
+	printf("\n");
+	for (job_t &job : jobs) {
+		printf("[Batch] %-7s %6lu frames %12lu cycles  ram hash %016lx  %6.2fs  %s\n",
+		       status_names[job.status],
+		       (unsigned long)job.frames,
+		       (unsigned long)job.cycles,
+		       (unsigned long)job.ram_hash,
+		       job.seconds,
+		       job.binary);
+		if (job.status != JOB_OK) failures++;
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * bench.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Measures raw cpu speed in millions of instructions per second. A
+ * small loop (ram loads and stores, alu, shifts and branches) is placed
+ * in general ram and the main cpu executes it with interrupts masked,
+ * without scheduler, blitter or sound. E64-headless reports the speed
+ * of the complete machine instead.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "machine.hpp"
+
+#define	BENCH_ADDRESS	0x100000
+
+/*
+ * Loops forever over a 4kb buffer at $200000
+ */
+static const uint8_t bench_code[] = {
+	0x41, 0xf9, 0x00, 0x20, 0x00, 0x00,	// lea     $200000.l, A0
+	0x30, 0x3c, 0x03, 0xff,			// move.w  #$3ff, D0
+	0x22, 0x10,				// move.l  (A0), D1
+	0xd4, 0x81,				// add.l   D1, D2
+	0x20, 0xc2,				// move.l  D2, (A0)+
+	0xe3, 0x8a,				// lsl.l   #1, D2
+	0xb1, 0x82,				// eor.l   D0, D2
+	0x51, 0xc8, 0xff, 0xf4,			// dbra    D0, $10000a
+	0x60, 0xe6				// bra.s   $100000
+};
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options]\n"
+	       "  -i <millions>     instructions per run (default 50)\n"
+	       "  -n <runs>         number of runs (default 3)\n"
+	       "  -t                use the block cache\n"
+	       "  -j                use the block cache and jit\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t instructions = 50000000;
+	int runs = 3;
+	bool block_cache = false;
+	bool jit = false;
+	
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc)) {
+			instructions = strtoull(argv[++i], nullptr, 10) * 1000000;
+		} else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+			runs = strtoul(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "-t") == 0) {
+			block_cache = true;
+		} else if (strcmp(argv[i], "-j") == 0) {
+			block_cache = jit = true;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	
+	E64::machine_t machine;
+	machine.enable_block_cache(block_cache);
+	machine.enable_jit(jit);
+	machine.reset();
+	
+	for (size_t i = 0; i < sizeof(bench_code); i++) {
+		machine.mmu->write_memory_8(BENCH_ADDRESS + i, bench_code[i]);
+	}
+	machine.m68k->setSR(0x2700);
+	machine.m68k->jump(BENCH_ADDRESS);
+	
+	double best = 0.0;
+	
+	for (int run = 1; run <= runs; run++) {
+		uint64_t start_clock = machine.m68k->getClock();
+		std::chrono::time_point<std::chrono::steady_clock> start_time = std::chrono::steady_clock::now();
+		
+		if (block_cache) {
+			for (uint64_t i = 0; i < instructions; ) i += machine.m68k->execute_cached(INT64_MAX);
+		} else {
+			for (uint64_t i = 0; i < instructions; i++) machine.m68k->execute();
+		}
+		
+		double seconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start_time).count() / 1000000;
+		double mips = seconds > 0 ? instructions / seconds / 1000000 : 0.0;
+		if (mips > best) best = mips;
+		
+		printf("[Bench] run %i: %lu instructions, %lu cycles in %.3f s, %.2f MIPS\n",
+		       run,
+		       (unsigned long)instructions,
+		       (unsigned long)(machine.m68k->getClock() - start_clock),
+		       seconds, mips);
+	}
+	
+	printf("[Bench] best: %.2f MIPS\n", best);
+	if (jit) printf("[Bench] %lu blocks translated, buffer full %lu times\n",
+			(unsigned long)machine.m68k->blocks_translated,
+			(unsigned long)machine.m68k->jit_flushes);
+	
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * compare.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Compares two state hash logs (made with E64-headless -x or E64
+ * -hashes) and reports the first frame in which they diverge, plus
+ * the subsystems that differ in that frame.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "state_hash_log.hpp"
+
+struct frame_hashes_t {
+	unsigned long frame;
+	unsigned long hashes[E64::STATE_HASH_SUBSYSTEMS];
+};
+
+/*
+ * Reads the next frame line, skipping comments. Returns false at the
+ * end of the file or on a malformed line.
+ */
+static bool read_frame(FILE *f, struct frame_hashes_t *frame)
+{
+	char line[512];
+	
+	while (fgets(line, 512, f)) {
+		if (line[0] == '#') continue;
+		
+		int n;
+		char *p = line;
+		if (sscanf(p, "%lu%n", &frame->frame, &n) != 1) return false;
+		p += n;
+		for (int i = 0; i < E64::STATE_HASH_SUBSYSTEMS; i++) {
+			if (sscanf(p, "%lx%n", &frame->hashes[i], &n) != 1) return false;
+			p += n;
+		}
+		return true;
+	}
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		printf("Usage: %s <hashes a> <hashes b>\n", argv[0]);
+		return 2;
+	}
+	
+	FILE *a = fopen(argv[1], "r");
+	if (!a) {
+		printf("[Compare] Error: can't open %s\n", argv[1]);
+		return 2;
+	}
+	FILE *b = fopen(argv[2], "r");
+	if (!b) {
+		printf("[Compare] Error: can't open %s\n", argv[2]);
+		fclose(a);
+		return 2;
+	}
+	
+	struct frame_hashes_t frame_a, frame_b;
+	unsigned long frames = 0;
+	int result = 0;
+	
+	while (true) {
+		bool more_a = read_frame(a, &frame_a);
+		bool more_b = read_frame(b, &frame_b);
+		
+		if (!more_a || !more_b) {
+			if (more_a || more_b) {
+				printf("[Compare] No divergence in %lu frames, %s has more frames\n",
+				       frames, more_a ? argv[1] : argv[2]);
+			} else {
+				printf("[Compare] No divergence in %lu frames\n", frames);
+			}
+			break;
+		}
+		
+		if (frame_a.frame != frame_b.frame) {
+			printf("[Compare] Error: frame numbers out of step (%lu and %lu)\n", frame_a.frame, frame_b.frame);
+			result = 2;
+			break;
+		}
+		
+		if (memcmp(frame_a.hashes, frame_b.hashes, sizeof(frame_a.hashes))) {
+			printf("[Compare] First divergence at frame %lu:", frame_a.frame);
+			for (int i = 0; i < E64::STATE_HASH_SUBSYSTEMS; i++) {
+				if (frame_a.hashes[i] != frame_b.hashes[i]) printf(" %s", E64::state_hash_subsystem_names[i]);
+			}
+			printf("\n");
+			for (int i = 0; i < E64::STATE_HASH_SUBSYSTEMS; i++) {
+				printf("[Compare]  %-6s %016lx %016lx%s\n",
+				       E64::state_hash_subsystem_names[i],
+				       frame_a.hashes[i],
+				       frame_b.hashes[i],
+				       (frame_a.hashes[i] != frame_b.hashes[i]) ? "  <-" : "");
+			}
+			result = 1;
+			break;
+		}
+		
+		frames++;
+	}
+	
+	fclose(a);
+	fclose(b);
+	
+	return result;
+}
@@ -8,7 +8,6 @@
  */
 
 #include "TTL74LS148.hpp"
-#include "common.hpp"
 
 E64::TTL74LS148_ic::TTL74LS148_ic()
 {
@@ -56,3 +55,15 @@ void E64::TTL74LS148_ic::update_interrupt_level()
 	//machine.m68k->setIPL(interrupt_level);
 	if (m68k_connected) m68k->setIPL(interrupt_level);
 }
+
+void E64::TTL74LS148_ic::save_state(FILE *f)
+{
+	fwrite(devices, sizeof(struct device), 256, f);
+	fwrite(&interrupt_level, sizeof(interrupt_level), 1, f);
+}
+
+void E64::TTL74LS148_ic::load_state(FILE *f)
+{
+	fread(devices, sizeof(struct device), 256, f);
+	fread(&interrupt_level, sizeof(interrupt_level), 1, f);
+}
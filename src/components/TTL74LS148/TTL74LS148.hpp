@@ -11,6 +11,7 @@
 #define TTL74LS148_HPP
 
 #include <cstdint>
+#include <cstdio>
 #include "m68k.hpp"
 
 namespace E64
@@ -48,6 +49,9 @@ public:
 	 * level (1-6) must be supplied. Returns a unique interrupt_device_no
 	 */
 	uint8_t connect_device(int level);
+	
+	void save_state(FILE *f);
+	void load_state(FILE *f);
 };
 
 }
@@ -5,9 +5,10 @@
  * Copyright © 2020-2023 elmerucr. All rights reserved.
  */
 
+#include <cstring>
 #include "blitter.hpp"
 #include "rom.hpp"
-#include "common.hpp"
+#include "definitions.hpp"
 
 /*
  * The alpha_blend lambda expression takes the current color (destination, which is
@@ -97,39 +98,17 @@ E64::blitter_ic::blitter_ic(uint16_t _pps, uint16_t _sl)
 											// ============
 											//  16mb total
 
-	/*
-	 * Fill blit memory alternating 64 bytes 0x00 and 64 bytes 0xff
-	 */
-	for (int i=0; i < (0x100 * 0x10000); i++) {
-		video_memory_write_8(i, i & 0b1000000 ? 0xff : 0x00);
-	}
-
 	/*
 	 * Array of 256 blits
 	 */
 	blit = new struct blit_t[256];
 
-	for (int i=0; i<256; i++) {
-		blit[i].number = i;
-
-		blit[i].background = false;
-		blit[i].multicolor = false;
-		blit[i].color_per_tile = false;
-		blit[i].font_no = 0;
-
-		blit[i].flags_1 = 0;
-		blit[i].process_flags_1();
-
-		blit[i].set_tile_width(1);
-		blit[i].set_tile_height(1);
-		blit[i].set_columns(1);
-		blit[i].set_rows(1);
-
-		blit[i].foreground_color = 0;
-		blit[i].background_color = 0;
-		blit[i].x_pos = 0;
-		blit[i].y_pos = 0;
-	}
+	pixels_drawn = 0;
+	clear_dirty_pages();
+	for (int i=0; i<(VIDEO_MEMORY_PAGES/64); i++) coprocessor_dirty_pages[i] = 0;
+	journal_active = false;
+	journal_data = nullptr;
+	power_on();
 
 	/*
 	 * fonts as bitmaps
@@ -170,6 +149,7 @@ E64::blitter_ic::blitter_ic(uint16_t _pps, uint16_t _sl)
 
 E64::blitter_ic::~blitter_ic()
 {
+	delete [] journal_data;
 	delete [] amiga_font;
 	delete [] cbm_font;
 	delete [] blit;
@@ -188,6 +168,38 @@ void E64::blitter_ic::connect_exceptions_ic(TTL74LS148_ic *unit)
 	exceptions_connected = true;
 }
 
+void E64::blitter_ic::power_on()
+{
+	/*
+	 * Fill blit memory alternating 64 bytes 0x00 and 64 bytes 0xff
+	 */
+	for (int i=0; i < (0x100 * 0x10000); i++) {
+		video_memory_write_8(i, i & 0b1000000 ? 0xff : 0x00);
+	}
+
+	for (int i=0; i<256; i++) {
+		blit[i].number = i;
+
+		blit[i].background = false;
+		blit[i].multicolor = false;
+		blit[i].color_per_tile = false;
+		blit[i].font_no = 0;
+
+		blit[i].flags_1 = 0;
+		blit[i].process_flags_1();
+
+		blit[i].set_tile_width(1);
+		blit[i].set_tile_height(1);
+		blit[i].set_columns(1);
+		blit[i].set_rows(1);
+
+		blit[i].foreground_color = 0;
+		blit[i].background_color = 0;
+		blit[i].x_pos = 0;
+		blit[i].y_pos = 0;
+	}
+}
+
 void E64::blitter_ic::reset()
 {
 	head = 0;
@@ -264,6 +276,8 @@ uint32_t E64::blitter_ic::draw_vertical_border()
 		for (uint32_t x=0; x<ver_border_size; x++) {
 			alpha_blend(&fb[(y*pixels_per_scanline)+x], &ver_border_color);
 			alpha_blend(&fb[(y*pixels_per_scanline)+x+constant], &ver_border_color);
+			
+			pixels += 2;
 		}
 	}
 	
@@ -454,16 +468,16 @@ bool E64::blitter_ic::run_next_operation()
 	if (head != tail) {
 		switch (operations[tail].type) {
 			case CLEAR:
-				clear_framebuffer();
+				pixels_drawn += clear_framebuffer();
 				break;
 			case HOR_BORDER:
-				draw_horizontal_border();
+				pixels_drawn += draw_horizontal_border();
 				break;
 			case VER_BORDER:
-				draw_vertical_border();
+				pixels_drawn += draw_vertical_border();
 				break;
 			case BLIT:
-				draw_blit(&operations[tail].blit);
+				pixels_drawn += draw_blit(&operations[tail].blit);
 				break;
 		}
 		tail++;
@@ -824,21 +838,26 @@ void E64::blitter_ic::io_blit_context_write_8(uint8_t blit_no, uint8_t address,
 			blit[blit_no].cursor_interval = byte;
 			break;
 		case BLIT_CURSOR_CHAR:
+			mark_page_dirty(0x200000 + (((blit_no << 13) + blit[blit_no].cursor_position) & TILE_RAM_ELEMENTS_MASK));
 			tile_ram[((blit_no << 13) + blit[blit_no].cursor_position) & TILE_RAM_ELEMENTS_MASK] = byte;
 			break;
 		case BLIT_CURSOR_FG_COLOR_MSB:
+			mark_page_dirty(0x400000 + ((((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK) << 1));
 			tile_foreground_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] =
 			(tile_foreground_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] & 0x00ff) | (byte << 8);
 			break;
 		case BLIT_CURSOR_FG_COLOR_LSB:
+			mark_page_dirty(0x400000 + ((((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK) << 1));
 			tile_foreground_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] =
 			(tile_foreground_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] & 0xff00) | byte;
 			break;
 		case BLIT_CURSOR_BG_COLOR_MSB:
+			mark_page_dirty(0x600000 + ((((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK) << 1));
 			tile_background_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] =
 			(tile_background_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] & 0x00ff) | (byte << 8);
 			break;
 		case BLIT_CURSOR_BG_COLOR_LSB:
+			mark_page_dirty(0x600000 + ((((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK) << 1));
 			tile_background_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] =
 			(tile_background_color_ram[((blit_no << 12) + blit[blit_no].cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] & 0xff00) | byte;
 			break;
@@ -855,3 +874,228 @@ void E64::blitter_ic::notify_screen_refreshed()
 		TTL74LS148->pull_line(interrupt_device_no);
 	}
 }
+
+void E64::blitter_ic::save_memory(FILE *f)
+{
+	fwrite(general_ram, sizeof(uint8_t), GENERAL_RAM_ELEMENTS, f);
+	fwrite(tile_ram, sizeof(uint8_t), TILE_RAM_ELEMENTS, f);
+	fwrite(tile_foreground_color_ram, sizeof(uint16_t), TILE_FOREGROUND_COLOR_RAM_ELEMENTS, f);
+	fwrite(tile_background_color_ram, sizeof(uint16_t), TILE_BACKGROUND_COLOR_RAM_ELEMENTS, f);
+	fwrite(pixel_ram, sizeof(uint16_t), PIXEL_RAM_ELEMENTS, f);
+}
+
+void E64::blitter_ic::load_memory(FILE *f)
+{
+	fread(general_ram, sizeof(uint8_t), GENERAL_RAM_ELEMENTS, f);
+	fread(tile_ram, sizeof(uint8_t), TILE_RAM_ELEMENTS, f);
+	fread(tile_foreground_color_ram, sizeof(uint16_t), TILE_FOREGROUND_COLOR_RAM_ELEMENTS, f);
+	fread(tile_background_color_ram, sizeof(uint16_t), TILE_BACKGROUND_COLOR_RAM_ELEMENTS, f);
+	fread(pixel_ram, sizeof(uint16_t), PIXEL_RAM_ELEMENTS, f);
+	
+	for (int i=0; i<(VIDEO_MEMORY_PAGES/64); i++) dirty_pages[i] = ~(uint64_t)0;
+}
+
+void E64::blitter_ic::save_state(FILE *f)
+{
+	fwrite(&current_blitter_width, 1, 1, f);
+	fwrite(&current_blitter_height, 1, 1, f);
+	fwrite(&pending_screenrefresh_irq, sizeof(bool), 1, f);
+	fwrite(&generate_screenrefresh_irq, sizeof(bool), 1, f);
+	fwrite(&hor_border_size, sizeof(uint16_t), 1, f);
+	fwrite(&ver_border_size, sizeof(uint16_t), 1, f);
+	fwrite(&hor_border_color, sizeof(uint16_t), 1, f);
+	fwrite(&ver_border_color, sizeof(uint16_t), 1, f);
+	fwrite(&clear_color, sizeof(uint16_t), 1, f);
+	fwrite(&blitter_context_0, 1, 1, f);
+	fwrite(&blitter_context_1, 1, 1, f);
+	fwrite(&blitter_context_2, 1, 1, f);
+	fwrite(&blitter_context_3, 1, 1, f);
+	fwrite(&blitter_context_4, 1, 1, f);
+	fwrite(&blitter_context_5, 1, 1, f);
+	fwrite(&blitter_context_6, 1, 1, f);
+	fwrite(&blitter_context_ptr_no, 1, 1, f);
+	
+	fwrite(blit, sizeof(struct blit_t), 256, f);
+	
+	/*
+	 * Only the operations that are still pending
+	 */
+	fwrite(&head, sizeof(uint16_t), 1, f);
+	fwrite(&tail, sizeof(uint16_t), 1, f);
+	for (uint16_t i = tail; i != head; i++) {
+		fwrite(&operations[i], sizeof(struct operation), 1, f);
+	}
+}
+
+void E64::blitter_ic::load_state(FILE *f)
+{
+	fread(&current_blitter_width, 1, 1, f);
+	fread(&current_blitter_height, 1, 1, f);
+	fread(&pending_screenrefresh_irq, sizeof(bool), 1, f);
+	fread(&generate_screenrefresh_irq, sizeof(bool), 1, f);
+	fread(&hor_border_size, sizeof(uint16_t), 1, f);
+	fread(&ver_border_size, sizeof(uint16_t), 1, f);
+	fread(&hor_border_color, sizeof(uint16_t), 1, f);
+	fread(&ver_border_color, sizeof(uint16_t), 1, f);
+	fread(&clear_color, sizeof(uint16_t), 1, f);
+	fread(&blitter_context_0, 1, 1, f);
+	fread(&blitter_context_1, 1, 1, f);
+	fread(&blitter_context_2, 1, 1, f);
+	fread(&blitter_context_3, 1, 1, f);
+	fread(&blitter_context_4, 1, 1, f);
+	fread(&blitter_context_5, 1, 1, f);
+	fread(&blitter_context_6, 1, 1, f);
+	fread(&blitter_context_ptr_no, 1, 1, f);
+	
+	fread(blit, sizeof(struct blit_t), 256, f);
+	
+	fread(&head, sizeof(uint16_t), 1, f);
+	fread(&tail, sizeof(uint16_t), 1, f);
+	for (uint16_t i = tail; i != head; i++) {
+		fread(&operations[i], sizeof(struct operation), 1, f);
+	}
+}
+
+uint8_t *E64::blitter_ic::video_memory_page(uint16_t page)
+{
+	uint32_t address = (page << VIDEO_MEMORY_PAGE_SHIFT) & 0xffffff;
+	
+	/*
+	 * The 16 bit arrays hold two bytes of address space per
+	 * element, so byte offsets are the same as in address space
+	 */
+	switch (address >> 21) {
+		case 0b000:
+			return &general_ram[address & 0x1fffff];
+		case 0b001:
+			return &tile_ram[address & 0x1fffff];
+		case 0b010:
+			return (uint8_t *)tile_foreground_color_ram + (address & 0x1fffff);
+		case 0b011:
+			return (uint8_t *)tile_background_color_ram + (address & 0x1fffff);
+		default:
+			return (uint8_t *)pixel_ram + (address & 0x7fffff);
+	}
+}
+
+/*
+ * The 16 bit areas keep their elements in host byte order, within a
+ * page the byte at an even address lives at the odd offset on little
+ * endian hosts (see video_memory_page())
+ */
+static inline uint32_t page_swap(uint32_t address)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	return ((address & 0xffffff) >> 21) > 0b001 ? 1 : 0;
+#else
+	return 0;
+#endif
+}
+
+void E64::blitter_ic::video_memory_copy(uint32_t dst, uint32_t src, uint32_t bytes)
+{
+	while (bytes) {
+		uint32_t dst_offset = dst & (VIDEO_MEMORY_PAGE_SIZE - 1);
+		uint32_t src_offset = src & (VIDEO_MEMORY_PAGE_SIZE - 1);
+		uint32_t chunk = VIDEO_MEMORY_PAGE_SIZE - ((dst_offset > src_offset) ? dst_offset : src_offset);
+		if (chunk > bytes) chunk = bytes;
+		
+		mark_page_dirty(dst);
+		uint8_t *d = video_memory_page((dst & 0xffffff) >> VIDEO_MEMORY_PAGE_SHIFT);
+		uint8_t *s = video_memory_page((src & 0xffffff) >> VIDEO_MEMORY_PAGE_SHIFT);
+		uint32_t dst_swap = page_swap(dst);
+		uint32_t src_swap = page_swap(src);
+		
+		if (!dst_swap && !src_swap) {
+			memmove(&d[dst_offset], &s[src_offset], chunk);
+		} else if (dst_swap && src_swap && !((dst_offset | src_offset | chunk) & 1)) {
+			memmove(&d[dst_offset], &s[src_offset], chunk);
+		} else {
+			for (uint32_t i = 0; i < chunk; i++) {
+				d[(dst_offset + i) ^ dst_swap] = s[(src_offset + i) ^ src_swap];
+			}
+		}
+		
+		dst += chunk;
+		src += chunk;
+		bytes -= chunk;
+	}
+}
+
+void E64::blitter_ic::video_memory_fill(uint32_t dst, uint32_t pattern, int size, uint32_t bytes)
+{
+	uint8_t values[4];
+	bool uniform = true;
+	for (int i = 0; i < size; i++) {
+		values[i] = pattern >> (8 * (size - 1 - i));
+		if (values[i] != values[0]) uniform = false;
+	}
+	
+	uint32_t position = 0;
+	while (bytes) {
+		uint32_t offset = dst & (VIDEO_MEMORY_PAGE_SIZE - 1);
+		uint32_t chunk = VIDEO_MEMORY_PAGE_SIZE - offset;
+		if (chunk > bytes) chunk = bytes;
+		
+		mark_page_dirty(dst);
+		uint8_t *d = video_memory_page((dst & 0xffffff) >> VIDEO_MEMORY_PAGE_SHIFT);
+		uint32_t swap = page_swap(dst);
+		
+		if (uniform && !(swap && ((offset | chunk) & 1))) {
+			memset(&d[offset], values[0], chunk);
+		} else {
+			for (uint32_t i = 0; i < chunk; i++) {
+				d[(offset + i) ^ swap] = values[(position + i) % size];
+			}
+		}
+		
+		position += chunk;
+		dst += chunk;
+		bytes -= chunk;
+	}
+}
+
+void E64::blitter_ic::merge_coprocessor_dirty_pages()
+{
+	for (int i=0; i<(VIDEO_MEMORY_PAGES/64); i++) {
+		dirty_pages[i] |= coprocessor_dirty_pages[i];
+		coprocessor_dirty_pages[i] = 0;
+	}
+}
+
+void E64::blitter_ic::start_journal()
+{
+	if (journal_data == nullptr)
+		journal_data = new uint8_t[VIDEO_MEMORY_PAGES * VIDEO_MEMORY_PAGE_SIZE];
+	
+	for (int i=0; i<(VIDEO_MEMORY_PAGES/64); i++) {
+		journal_dirty_pages[i] = dirty_pages[i];
+		dirty_pages[i] = 0;
+	}
+	journal_no_of_pages = 0;
+	journal_active = true;
+}
+
+void E64::blitter_ic::journal_page(uint16_t page)
+{
+	memcpy(&journal_data[journal_no_of_pages << VIDEO_MEMORY_PAGE_SHIFT],
+	       video_memory_page(page), VIDEO_MEMORY_PAGE_SIZE);
+	journal_page_numbers[journal_no_of_pages++] = page;
+}
+
+void E64::blitter_ic::undo_journal()
+{
+	while (journal_no_of_pages) {
+		journal_no_of_pages--;
+		memcpy(video_memory_page(journal_page_numbers[journal_no_of_pages]),
+		       &journal_data[journal_no_of_pages << VIDEO_MEMORY_PAGE_SHIFT],
+		       VIDEO_MEMORY_PAGE_SIZE);
+	}
+	
+	/*
+	 * All pages are back at their contents from the start of the
+	 * journal, and so is the dirty state that matters for rewinding
+	 */
+	for (int i=0; i<(VIDEO_MEMORY_PAGES/64); i++) dirty_pages[i] = journal_dirty_pages[i];
+	journal_active = false;
+}
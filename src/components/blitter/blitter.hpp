@@ -108,13 +108,27 @@
 #define TILE_BACKGROUND_COLOR_RAM_ELEMENTS_MASK	(TILE_BACKGROUND_COLOR_RAM_ELEMENTS-1)
 #define PIXEL_RAM_ELEMENTS_MASK			(PIXEL_RAM_ELEMENTS-1)
 
+/*
+ * Writes to video memory are tracked per 4kb page
+ */
+#define VIDEO_MEMORY_PAGE_SHIFT			12
+#define VIDEO_MEMORY_PAGE_SIZE			(1 << VIDEO_MEMORY_PAGE_SHIFT)
+#define VIDEO_MEMORY_PAGES			(0x1000000 >> VIDEO_MEMORY_PAGE_SHIFT)
+
+#include <cstdio>
 #include "blit.hpp"
 #include "TTL74LS148.hpp"
-#include <SDL2/SDL.h>
 
 namespace E64
 {
 
+struct rectangle {
+	int x;
+	int y;
+	int w;
+	int h;
+};
+
 enum operation_type {
 	CLEAR,
 	HOR_BORDER,
@@ -148,6 +162,34 @@ private:
 	uint16_t *tile_foreground_color_ram;	// 2mb
 	uint16_t *tile_background_color_ram;	// 2mb
 	uint16_t *pixel_ram;			// 8mb
+	
+	/*
+	 * One bit per page, set on each write. Must be called before
+	 * the actual write, so a journal can copy the old contents.
+	 */
+	uint64_t dirty_pages[VIDEO_MEMORY_PAGES / 64];
+	uint64_t coprocessor_dirty_pages[VIDEO_MEMORY_PAGES / 64];
+	
+	inline void mark_page_dirty(uint32_t address)
+	{
+		uint16_t page = (address & 0xffffff) >> VIDEO_MEMORY_PAGE_SHIFT;
+		uint64_t bit = (uint64_t)1 << (page & 63);
+		if (!(dirty_pages[page >> 6] & bit)) {
+			dirty_pages[page >> 6] |= bit;
+			if (journal_active) journal_page(page);
+		}
+	}
+	
+	/*
+	 * Copy on write journal, keeps the original contents of each
+	 * page on its first write after start_journal()
+	 */
+	bool journal_active;
+	uint64_t journal_dirty_pages[VIDEO_MEMORY_PAGES / 64];
+	uint16_t journal_page_numbers[VIDEO_MEMORY_PAGES];
+	uint32_t journal_no_of_pages;
+	uint8_t *journal_data;
+	void journal_page(uint16_t page);
 
 	/*
 	 * Specific for border
@@ -201,8 +243,8 @@ public:
 	
 	uint8_t interrupt_device_no;
 	
-	SDL_Rect screen_size;
-	SDL_Rect scanline_screen_size;
+	struct rectangle screen_size;
+	struct rectangle scanline_screen_size;
 	
 	void connect_exceptions_ic(TTL74LS148_ic *unit);
 
@@ -284,6 +326,34 @@ public:
 	}
 
 	inline void video_memory_write_8(uint32_t address, uint8_t value)
+	{
+		mark_page_dirty(address);
+		video_memory_store_8(address, value);
+	}
+	
+	/*
+	 * Writes from the coprocessor thread are tracked in a bitmap of
+	 * their own, merged by the main thread when both cpu's are at a
+	 * barrier. There's no journaling for these.
+	 */
+	inline void video_memory_write_8_coprocessor(uint32_t address, uint8_t value)
+	{
+		uint16_t page = (address & 0xffffff) >> VIDEO_MEMORY_PAGE_SHIFT;
+		coprocessor_dirty_pages[page >> 6] |= (uint64_t)1 << (page & 63);
+		video_memory_store_8(address, value);
+	}
+	void merge_coprocessor_dirty_pages();
+	
+	/*
+	 * Bulk stores for the cpu, with the same result as storing byte
+	 * by byte in ascending order through video_memory_write_8().
+	 * A copy may only overlap with dst below src. Fill repeats the
+	 * big endian pattern of size bytes.
+	 */
+	void video_memory_copy(uint32_t dst, uint32_t src, uint32_t bytes);
+	void video_memory_fill(uint32_t dst, uint32_t pattern, int size, uint32_t bytes);
+	
+	inline void video_memory_store_8(uint32_t address, uint8_t value)
 	{
 		switch ((address & 0x00e00000) >> 21) {
 			case 0b000:
@@ -320,7 +390,49 @@ public:
 		}
 	}
 
+	/*
+	 * Initial memory contents and blit descriptors, as after
+	 * switching on the machine. Not touched by a reset.
+	 */
+	void power_on();
 	void reset();
+	
+	/*
+	 * Video ram is written and read in bulk (16mb). The state
+	 * consists of registers, blit contexts and pending operations.
+	 */
+	void save_memory(FILE *f);
+	void load_memory(FILE *f);
+	void save_state(FILE *f);
+	void load_state(FILE *f);
+	
+	/*
+	 * Dirty page tracking, used for rewinding. A page pointer gives
+	 * direct access to the 4kb of storage behind a page, in host
+	 * byte order.
+	 */
+	inline bool page_dirty(uint16_t page)
+	{
+		return dirty_pages[page >> 6] & ((uint64_t)1 << (page & 63));
+	}
+	inline void clear_dirty_pages()
+	{
+		for (int i=0; i<(VIDEO_MEMORY_PAGES/64); i++) dirty_pages[i] = 0;
+	}
+	uint8_t *video_memory_page(uint16_t page);
+	
+	/*
+	 * Journaling, used for running ahead. undo_journal() brings all
+	 * memory back to its contents at start_journal().
+	 */
+	void start_journal();
+	void undo_journal();
+	
+	/*
+	 * Pages written since start_journal()
+	 */
+	inline uint32_t journal_pages() { return journal_no_of_pages; }
+	inline uint16_t journal_page_number(uint32_t n) { return journal_page_numbers[n]; }
 
 	struct blit_t *blit;
 
@@ -335,6 +447,18 @@ public:
 	
 	bool run_next_operation();
 	
+	/*
+	 * Pixels written by all operations run so far, the owner may
+	 * reset it
+	 */
+	uint32_t pixels_drawn;
+	
+	/*
+	 * Drops all pending operations without drawing, for frames that
+	 * won't be shown. Operations only write to the framebuffer.
+	 */
+	inline void discard_operations() { tail = head; }
+	
 	uint32_t clear_framebuffer();
 	uint32_t draw_horizontal_border();
 	uint32_t draw_vertical_border();
@@ -376,15 +500,23 @@ public:
 	void terminal_cursor_increase(uint8_t no);		// moves to the right, and wraps around
 	void terminal_cursor_left(uint8_t no);
 	void terminal_cursor_right(uint8_t no);
-	void terminal_cursor_up(uint8_t no);
-	void terminal_cursor_down(uint8_t no);
+	
+	/*
+	 * When scrolling the terminal, a monitor line may move out of
+	 * view. In that case, the type of line is returned and the
+	 * (unchecked) hex address of that line is copied into address,
+	 * which must be able to hold 7 characters. The caller may add a
+	 * new line.
+	 */
+	enum E64::terminal_output_type terminal_cursor_up(uint8_t no, char *address);
+	enum E64::terminal_output_type terminal_cursor_down(uint8_t no, char *address);
 	void terminal_backspace(uint8_t no);
 	void terminal_add_top_row(uint8_t no);
 	void terminal_add_bottom_row(uint8_t no);
 
 	void terminal_process_cursor_state(uint8_t no);
 	char *terminal_enter_command(uint8_t no);
-	enum E64::terminal_output_type terminal_check_output(uint8_t no, bool top_down, uint32_t *address);
+	enum E64::terminal_output_type terminal_check_output(uint8_t no, bool top_down, char *address);
 	
 	inline void set_current_blitter_width(uint8_t w) {
 		if (w < (pixels_per_scanline / 8)) {
@@ -5,26 +5,25 @@
  * Copyright © 2022-2023 elmerucr. All rights reserved.
  */
 
-#include "common.hpp"
+#include <cstdarg>
+#include "definitions.hpp"
 #include "blitter.hpp"
 
-/*
- * TODO - needs work?
- */
-#define RAM_SIZE_CPU_VISIBLE 0x1000000
-
 void E64::blitter_ic::terminal_set_tile(uint8_t number, uint16_t cursor_position, char symbol)
 {
+	mark_page_dirty(0x200000 + (((number << 13) + cursor_position) & TILE_RAM_ELEMENTS_MASK));
 	tile_ram[((number << 13) + cursor_position) & TILE_RAM_ELEMENTS_MASK] = symbol;
 }
 
 void E64::blitter_ic::terminal_set_tile_fg_color(uint8_t number, uint16_t cursor_position, uint16_t color)
 {
+	mark_page_dirty(0x400000 + ((((number << 12) + cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK) << 1));
 	tile_foreground_color_ram[((number << 12) + cursor_position) & TILE_FOREGROUND_COLOR_RAM_ELEMENTS_MASK] = color;
 }
 
 void E64::blitter_ic::terminal_set_tile_bg_color(uint8_t number, uint16_t cursor_position, uint16_t color)
 {
+	mark_page_dirty(0x600000 + ((((number << 12) + cursor_position) & TILE_BACKGROUND_COLOR_RAM_ELEMENTS_MASK) << 1));
 	tile_background_color_ram[((number << 12) + cursor_position) & TILE_BACKGROUND_COLOR_RAM_ELEMENTS_MASK] = color;
 }
 
@@ -45,6 +44,7 @@ uint16_t E64::blitter_ic::terminal_get_tile_bg_color(uint8_t number, uint16_t cu
 
 void E64::blitter_ic::set_pixel(uint8_t number, uint32_t pixel_no, uint16_t color)
 {
+	mark_page_dirty(0x800000 + ((((number << 14) + pixel_no) & PIXEL_RAM_ELEMENTS_MASK) << 1));
 	pixel_ram[((number << 14) + pixel_no) & PIXEL_RAM_ELEMENTS_MASK] = color;
 }
 
@@ -241,55 +241,35 @@ void E64::blitter_ic::terminal_cursor_right(uint8_t no)
 	}
 }
 
-void E64::blitter_ic::terminal_cursor_up(uint8_t no)
+enum E64::terminal_output_type E64::blitter_ic::terminal_cursor_up(uint8_t no, char *address)
 {
+	enum terminal_output_type output = NOTHING;
+	
 	blit[no].cursor_position -= blit[no].get_columns();
 
 	if (blit[no].cursor_position >= blit[no].get_tiles()) {
-		uint32_t address;
-
-		switch (terminal_check_output(no, true, &address)) {
-			case E64::NOTHING:
-				terminal_add_top_row(no);
-				break;
-			case E64::ASCII:
-				terminal_add_top_row(no);
-				hud.memory_dump((address-8) & (RAM_SIZE_CPU_VISIBLE - 1), 1);
-				break;
-			case E64::MONITOR_WORD:
-				terminal_add_top_row(no);
-				hud.memory_word_dump((address - 16) & 0xfffffe, 1);
-				break;
-		}
+		output = terminal_check_output(no, true, address);
+		terminal_add_top_row(no);
 	}
+	
+	return output;
 }
 
 
-void E64::blitter_ic::terminal_cursor_down(uint8_t no)
+enum E64::terminal_output_type E64::blitter_ic::terminal_cursor_down(uint8_t no, char *address)
 {
+	enum terminal_output_type output = NOTHING;
+	
 	blit[no].cursor_position += blit[no].get_columns();
 
 	// cursor out of current screen?
 	if (blit[no].cursor_position >= blit[no].get_tiles()) {
-		uint32_t address;
-
-		switch (terminal_check_output(no, false, &address)) {
-			case E64::NOTHING:
-				terminal_add_bottom_row(no);
-				blit[no].cursor_position -= blit[no].get_columns();
-				break;
-			case E64::ASCII:
-				terminal_add_bottom_row(no);
-				blit[no].cursor_position -= blit[no].get_columns();
-				hud.memory_dump((address+8) & (RAM_SIZE_CPU_VISIBLE - 1), 1);
-				break;
-			case E64::MONITOR_WORD:
-				terminal_add_bottom_row(no);
-				blit[no].cursor_position -= blit[no].get_columns();
-				hud.memory_word_dump((address + 16) & 0xfffffe, 1);
-				break;
-		}
+		output = terminal_check_output(no, false, address);
+		terminal_add_bottom_row(no);
+		blit[no].cursor_position -= blit[no].get_columns();
 	}
+	
+	return output;
 }
 
 char *E64::blitter_ic::terminal_enter_command(uint8_t no)
@@ -338,28 +318,24 @@ void E64::blitter_ic::terminal_add_bottom_row(uint8_t no)
 	}
 }
 
-enum E64::terminal_output_type E64::blitter_ic::terminal_check_output(uint8_t no, bool top_down, uint32_t *address)
+enum E64::terminal_output_type E64::blitter_ic::terminal_check_output(uint8_t no, bool top_down, char *address)
 {
 	enum terminal_output_type output = NOTHING;
 
 	for (int i = 0; i < blit[no].get_tiles(); i += blit[no].get_columns()) {
 		if (terminal_get_tile(no, i) == ':') {
 			output = ASCII;
-			char potential_address[7];
 			for (int j=0; j<6; j++) {
-				potential_address[j] = terminal_get_tile(no, i+1+j);
+				address[j] = terminal_get_tile(no, i+1+j);
 			}
-			potential_address[6] = 0;
-			hud.hex_string_to_int(potential_address, address);
+			address[6] = 0;
 			if (top_down) break;
 		} else if (terminal_get_tile(no, i) == ';') {
 			output = MONITOR_WORD;
-			char potential_address[7];
 			for (int j=0; j<6; j++) {
-				potential_address[j] = terminal_get_tile(no, i+1+j);
+				address[j] = terminal_get_tile(no, i+1+j);
 			}
-			potential_address[6] = 0;
-			hud.hex_string_to_int(potential_address, address);
+			address[6] = 0;
 			if (top_down) break;
 		}
 	}
@@ -6,8 +6,7 @@
  */
 
 #include "cia.hpp"
-#include "common.hpp"
-#include "sdl2.hpp"
+#include "definitions.hpp"
 #include <cstdio>
 
 bool scancode_not_modifier[] =
@@ -225,18 +224,25 @@ inline char event_to_ascii(uint8_t scancode, uint8_t modifiers)
     return 0;
 }
 
-E64::cia_ic::cia_ic()
+E64::cia_ic::cia_ic(uint8_t *keys)
 {
+    key_states = keys;
     cycles_per_interval = CPU_CLOCK_SPEED / 100; // no of cycles @ cpu clockspeed for a total of 10 ms
     reset();
 }
 
+void E64::cia_ic::set_clock_speed(uint32_t hz)
+{
+    uint32_t interval = hz / 100;
+    cycle_counter = ((uint64_t)cycle_counter * interval) / cycles_per_interval;
+    cycles_per_interval = interval;
+}
+
 void E64::cia_ic::reset()
 {
     cycle_counter = 0;
     
     for(int i=0; i<256; i++) registers[i] = 0x00;
-    //for(int i=0; i<128; i++) sdl2_keys_last_known_state[i] = 0x00;
     for(int i=0; i<256; i++) event_list[i] = 0x00;
     head = tail = 0;
     
@@ -281,16 +287,16 @@ void E64::cia_ic::run(int no_of_cycles)
 		cycle_counter -= cycles_per_interval;
         
 		// check modifier keys
-		uint8_t modifier_keys_status =  (sdl2_keys_last_known_state[SCANCODE_LSHIFT] ? SHIFT_PRESSED : 0) |
-						(sdl2_keys_last_known_state[SCANCODE_RSHIFT] ? SHIFT_PRESSED : 0) |
-						(sdl2_keys_last_known_state[SCANCODE_LCTRL ] ? CTRL_PRESSED  : 0) |
-						(sdl2_keys_last_known_state[SCANCODE_RCTRL ] ? CTRL_PRESSED  : 0);
+		uint8_t modifier_keys_status =  (key_states[SCANCODE_LSHIFT] ? SHIFT_PRESSED : 0) |
+						(key_states[SCANCODE_RSHIFT] ? SHIFT_PRESSED : 0) |
+						(key_states[SCANCODE_LCTRL ] ? CTRL_PRESSED  : 0) |
+						(key_states[SCANCODE_RCTRL ] ? CTRL_PRESSED  : 0);
         
 		// registers 128 to 255 reflect the current keyboard state
 		// shift each register one bit to the left, bit 0 is only set if key is pressed
 		// if one of the keys changed its state, push an event
 		for (int i=0x00; i<0x80; i++) {
-			registers[0x80 | i] = (registers[0x80 | i] << 1) | sdl2_keys_last_known_state[i];
+			registers[0x80 | i] = (registers[0x80 | i] << 1) | key_states[i];
 
 			switch (registers[0x80 | i] & 0b00000011) {
 				case 0b01:
@@ -398,3 +404,37 @@ void E64::cia_ic::generate_key_events()
 {
 	io_write_8(0x01, 0b00000001);
 }
+
+void E64::cia_ic::save_state(FILE *f)
+{
+	fwrite(&cycle_counter, sizeof(cycle_counter), 1, f);
+	fwrite(&cycles_per_interval, sizeof(cycles_per_interval), 1, f);
+	fwrite(&generating_key_events, sizeof(generating_key_events), 1, f);
+	fwrite(event_list, 1, 256, f);
+	fwrite(&head, 1, 1, f);
+	fwrite(&tail, 1, 1, f);
+	fwrite(&key_down, sizeof(key_down), 1, f);
+	fwrite(&last_key, 1, 1, f);
+	fwrite(&keyboard_repeat_delay, 1, 1, f);
+	fwrite(&keyboard_repeat_speed, 1, 1, f);
+	fwrite(&keyboard_repeat_counter, 1, 1, f);
+	fwrite(&keyboard_repeat_current_max, 1, 1, f);
+	fwrite(registers, 1, 256, f);
+}
+
+void E64::cia_ic::load_state(FILE *f)
+{
+	fread(&cycle_counter, sizeof(cycle_counter), 1, f);
+	fread(&cycles_per_interval, sizeof(cycles_per_interval), 1, f);
+	fread(&generating_key_events, sizeof(generating_key_events), 1, f);
+	fread(event_list, 1, 256, f);
+	fread(&head, 1, 1, f);
+	fread(&tail, 1, 1, f);
+	fread(&key_down, sizeof(key_down), 1, f);
+	fread(&last_key, 1, 1, f);
+	fread(&keyboard_repeat_delay, 1, 1, f);
+	fread(&keyboard_repeat_speed, 1, 1, f);
+	fread(&keyboard_repeat_counter, 1, 1, f);
+	fread(&keyboard_repeat_current_max, 1, 1, f);
+	fread(registers, 1, 256, f);
+}
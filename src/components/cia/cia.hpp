@@ -36,6 +36,7 @@
  */
 
 #include <cstdint>
+#include <cstdio>
 
 #ifndef cia_hpp
 #define cia_hpp
@@ -120,6 +121,12 @@ enum scancodes
 
 class cia_ic {
 private:
+	/*
+	 * Points to the current state (0 or 1) of 128 keys, provided by
+	 * the owner of this ic
+	 */
+	uint8_t     *key_states;
+	
 	uint32_t    cycle_counter;
 	uint32_t    cycles_per_interval;
     
@@ -142,14 +149,9 @@ private:
 	uint8_t keyboard_repeat_speed;      // multiples of 10ms between repeats (5x = 50ms -> 20Hz, or 4s to fill up screenline @ 80 columns)
 	uint8_t keyboard_repeat_counter;
 	uint8_t keyboard_repeat_current_max;
-    
-	inline bool events_waiting()
-	{
-		return (head == tail) ? false : true;
-	}
 
 public:
-	cia_ic();
+	cia_ic(uint8_t *keys);
     
 	/*
 	 * Reset, also called by constructor
@@ -160,6 +162,17 @@ public:
     
 	/*  Run a number of cycles */
 	void run(int no_of_cycles);
+	
+	/*
+	 * Clock speed of the cycles that are run (cpu clock)
+	 */
+	void set_clock_speed(uint32_t hz);
+	
+	/* Cycles until the next keyboard scan */
+	inline uint32_t cycles_to_next_event()
+	{
+		return (cycle_counter >= cycles_per_interval) ? 0 : cycles_per_interval - cycle_counter;
+	}
     
 	/*
 	 * Register access functions
@@ -167,12 +180,27 @@ public:
 	uint8_t io_read_8(uint8_t address);
 	void io_write_8(uint8_t address, uint8_t byte);
 	
+	/*
+	 * If not, reading register 0x04 returns SCANCODE_EMPTY and has no
+	 * side effects
+	 */
+	inline bool events_waiting()
+	{
+		return (head == tail) ? false : true;
+	}
+	
 	/*
 	 * Convenience functions
 	 */
 	void set_keyboard_repeat_delay(uint8_t delay);
 	void set_keyboard_repeat_speed(uint8_t speed);
 	void generate_key_events();
+	
+	/*
+	 * Key states are owned by the machine and not included
+	 */
+	void save_state(FILE *f);
+	void load_state(FILE *f);
 };
 
 }
@@ -52,6 +52,18 @@ public:
 		return (uint32_t)result;
 	}
 	
+	inline void reset()
+	{
+		mod = 0;
+	}
+	
+	/*
+	 * Save states need the modulo to continue exactly where they
+	 * left off
+	 */
+	inline uint64_t get_mod() { return mod; }
+	inline void set_mod(uint64_t m) { mod = m; }
+	
 	inline void adjust_frequencies(uint32_t base_clock_f, uint32_t target_clock_f)
 	{
 		base_clock_freq = base_clock_f;
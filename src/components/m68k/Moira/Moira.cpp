@@ -8,18 +8,25 @@
 #include "MoiraConfig.h"
 #include "Moira.h"
 #include "MoiraMacros.h"
+#include "softfloat/softfloat.h"
 
 #include <cstdio>
+#include <cstring>
+#include <limits>
 #include <algorithm>
 #include <cmath>
 #include <bit>
 #include <vector>
 #include <stdexcept>
 
+// Client api, bound at compile time (VIRTUAL_API is false)
+#include "m68k_api.hpp"
+
 namespace moira {
 
 #include "MoiraInit_cpp.h"
 #include "MoiraALU_cpp.h"
+#include "MoiraFPU_cpp.h"
 #include "MoiraDataflow_cpp.h"
 #include "MoiraExceptions_cpp.h"
 #include "MoiraExec_cpp.h"
@@ -29,7 +36,11 @@ namespace moira {
 Moira::Moira()
 {
     if (BUILD_INSTR_INFO_TABLE) info = new InstrInfo[65536];
-    if (ENABLE_DASM) dasm = new DasmPtr[65536];
+    if (BUILD_68010_CORE) loop = new u16[65536];
+    if (ENABLE_DASM) {
+        dasm = new u16[65536];
+        dasmHandlers = new DasmPtr[MAX_DASM_HANDLERS];
+    }
 
     createJumpTable(cpuModel, dasmModel);
 }
@@ -37,7 +48,9 @@ Moira::Moira()
 Moira::~Moira()
 {
     if (info) delete [] info;
+    if (loop) delete [] loop;
     if (dasm) delete [] dasm;
+    if (dasmHandlers) delete [] dasmHandlers;
 }
 
 void
@@ -121,10 +134,21 @@ Moira::hasFPU()
             return true;
 
         default:
-            return false;
+            return fpuAttached;
     }
 }
 
+void
+Moira::setFPU(bool value)
+{
+    // Only proceed if the configuration changes
+    if (fpuAttached == value) return;
+
+    fpuAttached = value;
+    createJumpTable(cpuModel, dasmModel);
+    if (fpuAttached) fpuReset();
+}
+
 u32
 Moira::cacrMask() const
 {
@@ -183,6 +207,7 @@ Moira::reset()
     fcSource = 0;
 
     fpu = { };
+    if (fpuAttached) fpuReset();
 
     SYNC(16);
 
@@ -229,7 +254,7 @@ Moira::execute()
 
         reg.pc += 2;
         try {
-            (this->*exec[queue.ird])(queue.ird);
+            (this->*execHandlers[exec[queue.ird]])(queue.ird);
         } catch (const std::exception &exc) {
             processException(exc);
         }
@@ -297,13 +322,13 @@ Moira::execute()
 
         if (flags & CPU_IS_LOOPING) {
 
-            assert(loop[queue.ird]);
-            (this->*loop[queue.ird])(queue.ird);
+            assert(loop && loop[queue.ird]);
+            (this->*execHandlers[loop[queue.ird]])(queue.ird);
 
         } else {
 
             try {
-                (this->*exec[queue.ird])(queue.ird);
+                (this->*execHandlers[exec[queue.ird]])(queue.ird);
             } catch (const std::exception &exc) {
                 processException(exc);
             }
@@ -314,6 +339,9 @@ Moira::execute()
         // Check if a breakpoint has been reached
         if (flags & CPU_CHECK_BP) {
 
+            // Don't break twice at a software trap, but at its original instruction
+            if (swTrapResolved) { swTrapResolved = false; return; }
+
             // Don't break if the instruction won't be executed due to tracing
             if (flags & CPU_TRACE_EXCEPTION) return;
 
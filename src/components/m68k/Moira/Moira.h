@@ -27,11 +27,21 @@ class Moira {
 
 protected:
 
+    // (E64: both default to the oldest model with a built core)
+    static constexpr Model defaultModel =
+        BUILD_68000_CORE ? M68000 : BUILD_68010_CORE ? M68010 : M68EC020;
+
     // Emulated CPU model
-    Model cpuModel = M68000;
+    Model cpuModel = defaultModel;
 
     // Instruction set used by the disassembler
-    Model dasmModel = M68000;
+    Model dasmModel = defaultModel;
+
+    // Indicates if a 68881 coprocessor is attached (E64)
+    bool fpuAttached = false;
+
+    // Arithmetic mode of the attached coprocessor (E64)
+    FPUAccuracy fpuAccuracy = FPU_FAST;
 
     // Disassembler styleh
     DasmStyle style = {
@@ -92,6 +102,9 @@ protected:
     // Controls exact timing of instructions running in loop mode
     int loopModeDelay = 2;
 
+    // Set when a software trap hands back to its original instruction (E64)
+    bool swTrapResolved = false;
+
     // Read and write buffers (appear in 68010 exception frames)
     u16 readBuffer;
     u16 writeBuffer;
@@ -104,18 +117,35 @@ protected:
     // Lookup tables
     //
 
-private:
+protected:
+
+    // (E64: protected so that a client can cache handlers, see m68k_ic)
+
+    // (E64: the jump tables hold 16 bit indices into dense handler arrays,
+    // which keeps them small enough to stay in the cache)
 
     // Jump table holding the instruction handlers
     typedef void (Moira::*ExecPtr)(u16);
-    ExecPtr exec[65536];
+    u16 exec[65536];
+
+    // Jump table holding the loop mode instruction handlers (68010 only,
+    // index 0 if an opcode has none)
+    u16 *loop = nullptr;
 
-    // Jump table holding the loop mode instruction handlers (68010 only)
-    ExecPtr loop[65536];
+    // All registered instruction handlers (index 0 is unused)
+    ExecPtr execHandlers[MAX_EXEC_HANDLERS];
+    int execHandlerCount = 1;
 
     // Jump table holding the disassebler handlers
     typedef void (Moira::*DasmPtr)(StrWriter&, u32&, u16) const;
-    DasmPtr *dasm = nullptr;
+    u16 *dasm = nullptr;
+
+    // All registered disassembler handlers
+    DasmPtr *dasmHandlers = nullptr;
+    int dasmHandlerCount = 0;
+
+    // Returns the instruction handler of an opcode
+    ExecPtr execHandler(u16 opcode) const { return execHandlers[exec[opcode]]; }
 
     // Table holding instruction infos
     InstrInfo *info = nullptr;
@@ -141,6 +171,10 @@ private:
     // The createJumpTable core routine
     template <Core C> void createJumpTable(Model model, bool registerDasm);
 
+    // Adds a handler to the dense handler arrays and returns its index
+    u16 registerExec(ExecPtr handler);
+    u16 registerDasm(DasmPtr handler);
+
 
     //
     // Configuring
@@ -174,6 +208,13 @@ public:
     // Checks if the emulated CPU model has a floating point unit
     bool hasFPU();
 
+    // Attaches or detaches a 68881 coprocessor (E64)
+    void setFPU(bool value);
+
+    // Selects how the attached coprocessor carries out arithmetic (E64)
+    void setFPUAccuracy(FPUAccuracy value) { fpuAccuracy = value; }
+    FPUAccuracy getFPUAccuracy() const { return fpuAccuracy; }
+
     // Returns the cache register mask (accessible CACR bits)
     u32 cacrMask() const;
 
@@ -201,10 +242,13 @@ public:
     // Returns true if the CPU is in HALT state
     bool isHalted() const { return flags & CPU_IS_HALTED; }
 
-private:
+protected:
 
     // Processes an exception that was catched in execute()
     void processException(const std::exception &exception);
+
+private:
+
     template <Core C> void processException(const std::exception &exception);
 
     // The reset core routine
@@ -263,6 +307,9 @@ protected:
     virtual u16 read16OnReset(u32 addr) const { return read16(addr); }
     virtual u16 read16Dasm(u32 addr) const { return read16(addr); }
 
+    // Special variant used for program space reads (E64)
+    virtual u16 read16Prog(u32 addr) const { return read16(addr); }
+
     // Writes a byte or word into memory
     virtual void write8(u32 addr, u8 val) const = 0;
     virtual void write16(u32 addr, u16 val) const = 0;
@@ -310,6 +357,9 @@ protected:
     u16 read16OnReset(u32 addr) const;
     u16 read16Dasm(u32 addr) const;
 
+    // Special variant used for program space reads (E64)
+    u16 read16Prog(u32 addr) const;
+
     // Writes a byte or word into memory
     void write8(u32 addr, u8 val) const;
     void write16(u32 addr, u16 val) const;
@@ -508,6 +558,7 @@ private:
 
 #include "MoiraInit.h"
 #include "MoiraALU.h"
+#include "MoiraFPU.h"
 #include "MoiraDataflow.h"
 #include "MoiraExceptions.h"
 #include "MoiraDasm.h"
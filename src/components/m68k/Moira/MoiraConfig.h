@@ -33,7 +33,19 @@
  *
  * Enable to follow the standard OOP paradigm, disable to gain speed.
  */
-#define VIRTUAL_API true
+#define VIRTUAL_API false
+
+/* Set to false to leave out a CPU core (E64).
+ *
+ * Each core (68000, 68010, 68020 and up) instantiates its own set of
+ * instruction handlers and only the handlers of built cores end up in the
+ * jump tables. Selecting a model whose core isn't built is an error.
+ *
+ * Disable unused cores to save space and build time.
+ */
+#define BUILD_68000_CORE false
+#define BUILD_68010_CORE false
+#define BUILD_68020_CORE true
 
 /* Set to true to enable address error checking.
  *
@@ -17,7 +17,7 @@ Moira::disassemble(u32 addr, char *str) const
 
     StrWriter writer(str, style);
 
-    (this->*dasm[opcode])(writer, pc, opcode);
+    (this->*dasmHandlers[dasm[opcode]])(writer, pc, opcode);
     writer << Finish{};
 
     // Post process disassembler output
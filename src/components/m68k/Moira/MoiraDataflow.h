@@ -85,6 +85,11 @@ template <Core C, Mode M, Size S, Flags F = 0> u32 readM(u32 addr);
 // Reads a value from a specific memory space
 template <Core C, MemSpace MS, Size S, Flags F = 0> u32 read(u32 addr);
 
+// Reads a word from a specific memory space (E64: program space has its own delegate)
+template <MemSpace MS> u16 readSpace16(u32 addr) const {
+    if constexpr (MS == MEM_PROG) return read16Prog(addr); else return read16(addr);
+}
+
 // Writes an operand to memory (without or with address error checking)
 template <Core C, Mode M, Size S, Flags F = 0> void writeM(u32 addr, u32 val);
 
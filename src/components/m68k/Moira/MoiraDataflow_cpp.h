@@ -350,16 +350,16 @@ Moira::read(u32 addr)
     if constexpr (S == Word) {
 
         if (F & POLL) POLL_IPL;
-        result = read16(addr & addrMask<C>());
+        result = readSpace16<MS>(addr & addrMask<C>());
         SYNC(2);
     }
 
     if constexpr (S == Long) {
 
-        result = read16(addr & addrMask<C>()) << 16;
+        result = readSpace16<MS>(addr & addrMask<C>()) << 16;
         SYNC(4);
         if (F & POLL) POLL_IPL;
-        result |= read16((addr + 2) & addrMask<C>());
+        result |= readSpace16<MS>((addr + 2) & addrMask<C>());
         SYNC(2);
     }
 
@@ -52,11 +52,10 @@ Guards::guardNr(long nr)const
 Guard *
 Guards::guardAt(u32 addr) const
 {
-    for (int i = 0; i < count; i++) {
-        if (guards[i].addr == addr) return &guards[i];
-    }
+    if (!onPage(addr)) return nullptr;
 
-    return nullptr;
+    auto it = index.find(addr);
+    return it != index.end() ? &guards[it->second] : nullptr;
 }
 
 std::optional<u32>
@@ -80,7 +79,12 @@ Guards::setAt(u32 addr)
         capacity *= 2;
     }
 
-    guards[count++].addr = addr;
+    guards[count] = Guard { .addr = addr };
+    index[addr] = count++;
+
+    u32 page = (addr >> 8) & 0xFFFF;
+    pages[page >> 6] |= u64(1) << (page & 63);
+
     setNeedsCheck(true);
 }
 
@@ -102,6 +106,7 @@ Guards::removeAt(u32 addr)
             break;
         }
     }
+    reindex();
     setNeedsCheck(count != 0);
 }
 
@@ -111,6 +116,33 @@ Guards::replace(long nr, u32 addr)
     if (nr >= count || isSetAt(addr)) return;
 
     guards[nr].addr = addr;
+    reindex();
+}
+
+void
+Guards::reindex()
+{
+    index.clear();
+    for (u32 i = 0; i < 1024; i++) pages[i] = 0;
+
+    for (long i = 0; i < count; i++) {
+
+        u32 page = (guards[i].addr >> 8) & 0xFFFF;
+        index[guards[i].addr] = i;
+        pages[page >> 6] |= u64(1) << (page & 63);
+    }
+}
+
+bool
+Guards::onPages(u32 addr, u32 size) const
+{
+    if (size == 0) return false;
+    if (size >= 0x1000000) return count != 0;
+
+    for (u32 page = addr >> 8; page <= (addr + size - 1) >> 8; page++) {
+        if (onPage(page << 8)) return true;
+    }
+    return false;
 }
 
 bool
@@ -163,13 +195,14 @@ Guards::ignore(long nr, long count)
 }
 
 bool
-Guards::eval(u32 addr, Size S)
+Guards::evalAt(u32 addr, Size S)
 {
-    for (int i = 0; i < count; i++) {
+    for (u32 i = 0; i < u32(S); i++) {
 
-        if (guards[i].eval(addr, S)) {
+        auto it = index.find(addr + i);
+        if (it != index.end() && guards[it->second].eval(addr, S)) {
 
-            hit = guards[i];
+            hit = guards[it->second];
             return true;
         }
     }
@@ -268,18 +301,6 @@ Debugger::softstopMatches(u32 addr)
     return false;
 }
 
-bool
-Debugger::breakpointMatches(u32 addr)
-{
-    return breakpoints.eval(addr);
-}
-
-bool
-Debugger::watchpointMatches(u32 addr, Size S)
-{
-    return watchpoints.eval(addr, S);
-}
-
 bool
 Debugger::catchpointMatches(u32 vectorNr)
 {
@@ -12,6 +12,7 @@
 #include "MoiraTypes.h"
 #include "StrWriter.h"
 #include <map>
+#include <unordered_map>
 
 namespace moira {
 
@@ -57,6 +58,12 @@ protected:
     // Number of currently stored guards
     long count = 0;
 
+    // Pages of 256 bytes (24 bit address space) holding at least one guard
+    u64 pages[1024] = { };
+
+    // Position of each observed address in the guards array
+    std::unordered_map<u32, long> index;
+
 public:
 
     // A copy of the latest match
@@ -94,7 +101,7 @@ public:
 
     void remove(long nr);
     void removeAt(u32 addr);
-    void removeAll() { count = 0; setNeedsCheck(false); }
+    void removeAll() { count = 0; reindex(); setNeedsCheck(false); }
 
     void replace(long nr, u32 addr);
 
@@ -125,8 +132,27 @@ public:
     // Indicates if guard checking is necessary
     virtual void setNeedsCheck(bool value) = 0;
 
-    // Evaluates all guards
-    bool eval(u32 addr, Size S = Byte);
+    // Indicates if a page may hold a guard
+    bool onPage(u32 addr) const {
+        u32 page = (addr >> 8) & 0xFFFF;
+        return pages[page >> 6] & (u64(1) << (page & 63));
+    }
+
+    // Indicates if any page of a range may hold a guard
+    bool onPages(u32 addr, u32 size) const;
+
+    // Evaluates all guards, pages without any are passed in constant time
+    bool eval(u32 addr, Size S = Byte) {
+        return (onPage(addr) || onPage(addr + u32(S) - 1)) && evalAt(addr, S);
+    }
+
+private:
+
+    // Evaluates the guards on the observed addresses
+    bool evalAt(u32 addr, Size S);
+
+    // Rebuilds the page bitmap and the address index
+    void reindex();
 };
 
 class Breakpoints : public Guards {
@@ -254,8 +280,8 @@ public:
 
     // Checks whether a debug events should be triggered
     bool softstopMatches(u32 addr);
-    bool breakpointMatches(u32 addr);
-    bool watchpointMatches(u32 addr, Size S);
+    bool breakpointMatches(u32 addr) { return breakpoints.eval(addr); }
+    bool watchpointMatches(u32 addr, Size S) { return watchpoints.eval(addr, S); }
     bool catchpointMatches(u32 vectorNr);
 
 
@@ -120,48 +120,408 @@ Moira::isValidExtFPU(Instr I, Mode M, u16 op, u32 ext) const
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFBcc(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+
+    u32 oldpc = reg.pc;
+    u32 disp = queue.irc;
+
+    if constexpr (S == Long) {
+
+        readExt<C>();
+        disp = disp << 16 | queue.irc;
+    }
+
+    if (fpuCond(opcode & 0x3F)) {
+
+        u32 newpc = U32_ADD(oldpc, SEXT<S>(disp));
+
+        // Check for address error
+        if (misaligned<C>(newpc)) {
+            throw AddressError(makeFrame(newpc));
+        }
+
+        // Take branch
+        reg.pc = newpc;
+        fullPrefetch<C, POLL>();
+
+        CYCLES_68020(S == Long ? 14 : 12)
+
+    } else {
+
+        // Fall through to next instruction
+        readExt<C>();
+        prefetch<C, POLL>();
+
+        CYCLES_68020(S == Long ? 10 : 8)
+    }
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFDbcc(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+
+    int dn = _____________xxx(opcode);
+    int predicate = readI<C, Word>() & 0x3F;
+
+    if (!fpuCond(predicate)) {
+
+        u32 newpc = U32_ADD(reg.pc, (i16)queue.irc);
+
+        // Decrement loop counter
+        writeD<Word>(dn, U32_SUB(readD<Word>(dn), 1));
+
+        // Branch
+        if (readD<Word>(dn) != 0xFFFF) {
+
+            // Check for address error
+            if (misaligned<C>(newpc)) {
+                throw AddressError(makeFrame(newpc));
+            }
+
+            reg.pc = newpc;
+            fullPrefetch<C, POLL>();
+            CYCLES_68020(14);
+
+            FINALIZE
+            return;
+        }
+    }
+
+    readExt<C>();
+    prefetch<C, POLL>();
+    CYCLES_68020(12);
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFGen(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+
+    int n = _____________xxx(opcode);
+
+    u16 ext  = queue.irc;
+    auto cod = xxx_____________ (ext);
+    auto fmt = ___xxx__________ (ext);
+    auto lst = ___xxx__________ (ext);
+    auto dst = ______xxx_______ (ext);
+    auto cmd = _________xxxxxxx (ext);
+
+    bool memory = M != MODE_DN && M != MODE_AN;
+    bool writable = M != MODE_DIPC && M != MODE_IXPC && M != MODE_IM && M != MODE_IP;
+
+    // Reject everything the 68881 doesn't implement
+    switch (cod) {
+
+        case 0b000:
+
+            if (cmd < 0x40) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        case 0b010:
+
+            if (fmt == 0b111) break;
+            if (cmd < 0x40 && fmt != 0b011 && M != MODE_AN && M != MODE_IP &&
+                (memory || fpuFormatSize(fmt) <= 4)) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        case 0b011:
+
+            if (fmt != 0b011 && fmt != 0b111 && M != MODE_AN && writable &&
+                (memory || fpuFormatSize(fmt) <= 4)) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        case 0b100:
+
+            if (M != MODE_IP && (memory || std::popcount(lst) == 1) &&
+                (M != MODE_AN || lst == 0b001)) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        case 0b101:
+
+            if (writable && (memory || std::popcount(lst) == 1) &&
+                (M != MODE_AN || lst == 0b001)) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        case 0b110:
+
+            if (memory && M != MODE_IM && M != MODE_IP && M != MODE_PD) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        case 0b111:
+
+            if (memory && writable && M != MODE_PI) break;
+            execLineF<C, I, M, S>(opcode);
+            return;
+
+        default:
+
+            execLineF<C, I, M, S>(opcode);
+            return;
+    }
+
+    readExt<C>();
+
+    switch (cod) {
+
+        case 0b000: // FPm,FPn
+        case 0b010: // <ea>,FPn
+        {
+            Float80 src;
+            u32 data[3] = { };
+            int cycles = 0;
+
+            if (cod == 0b000) {
+
+                src = fpu.fpr[fmt];
+
+            } else if (fmt == 0b111) {
+
+                // FMOVECR reads from the constant ROM
+                fpu.fpr[dst] = fpuConstant(cmd);
+                fpuSetCC(fpu.fpr[dst]);
+
+                prefetch<C, POLL>();
+                CYCLES_68020(29);
+
+                FINALIZE
+                return;
+
+            } else {
+
+                fpuReadOp<C, M>(n, fmt, data);
+                src = fpuFromFormat(fmt, data);
+                cycles += memory ? 16 : 4;
+            }
+
+            fpu.fpiar = reg.pc0;
+            fpuArithmetic(cmd, src, dst);
+            cycles += fpuCycles(cmd);
+
+            prefetch<C, POLL>();
+            CYCLES_68020(cycles);
+            break;
+        }
+        case 0b011: // FPn,<ea>
+        {
+            u32 data[3] = { };
+
+            softfloat::float_exception_flags = 0;
+            fpuToFormat(fmt, fpu.fpr[dst], data);
+            fpu.fpsr = fpuAccrue(fpu.fpsr & ~0xFF00, fpuSoftfloatExceptions());
+            fpu.fpiar = reg.pc0;
+
+            fpuWriteOp<C, M>(n, fmt, data);
+
+            prefetch<C, POLL>();
+            CYCLES_68020(memory ? 38 : 30);
+            break;
+        }
+        case 0b100: // <ea>,FPcr
+        case 0b101: // FPcr,<ea>
+        {
+            u32 *regs[3] = { &fpu.fpcr, &fpu.fpsr, &fpu.fpiar };
+            int count = std::popcount(lst);
+            u32 ea = 0;
+
+            if (memory && M != MODE_IM) ea = fpuComputeEA<C, M>(n, 4 * count);
+
+            for (int i = 0; i < 3; i++) {
+
+                if (!(lst & (0b100 >> i))) continue;
+
+                if (cod == 0b100) {
+
+                    u32 value =
+                    M == MODE_DN ? readD(n) :
+                    M == MODE_AN ? readA(n) :
+                    M == MODE_IM ? readI<C, Long>() : readM<C, M, Long>(ea);
+
+                    // Unused bits read as zero
+                    *regs[i] = i == 0 ? value & 0xFFF0 : i == 1 ? value & 0x0FFFFFF8 : value;
+
+                } else {
+
+                    if (M == MODE_DN) writeD(n, *regs[i]);
+                    else if (M == MODE_AN) writeA(n, *regs[i]);
+                    else writeM<C, M, Long>(ea, *regs[i]);
+                }
+                ea += 4;
+            }
+
+            prefetch<C, POLL>();
+            CYCLES_68020(14 + 8 * count);
+            break;
+        }
+        case 0b110: // <ea>,<list>
+        case 0b111: // <list>,<ea>
+        {
+            int mode = (ext >> 11) & 0b11;
+            u8 list = (mode & 1) ? u8(readD((ext >> 4) & 0b111)) : u8(ext);
+
+            // In predecrement mode, bit 0 selects FP0, otherwise FP7
+            if (mode & 0b10) {
+
+                u8 reversed = 0;
+                for (int i = 0; i < 8; i++) if (list & (1 << i)) reversed |= 0x80 >> i;
+                list = reversed;
+            }
+
+            int count = std::popcount(list);
+            u32 ea = fpuComputeEA<C, M>(n, 12 * count);
+
+            for (int i = 0; i < 8; i++) {
+
+                if (!(list & (1 << i))) continue;
+
+                u32 data[3];
+
+                if (cod == 0b110) {
+
+                    for (int j = 0; j < 3; j++) data[j] = readM<C, M, Long>(ea + 4 * j);
+                    fpu.fpr[i] = fpuFromFormat(2, data);
+
+                } else {
+
+                    fpuToFormat(2, fpu.fpr[i], data);
+                    for (int j = 0; j < 3; j++) writeM<C, M, Long>(ea + 4 * j, data[j]);
+                }
+                ea += 12;
+            }
+
+            prefetch<C, POLL>();
+            CYCLES_68020(14 + 24 * count);
+            break;
+        }
+    }
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFNop(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+
+    readExt<C>();
+    prefetch<C, POLL>();
+
+    CYCLES_68020(8);
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFRestore(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+    SUPERVISOR_MODE_ONLY
+
+    int n = _____________xxx(opcode);
+    u32 ea = M == MODE_PI ? readA(n) : computeEA<C, M, Long>(n);
+    u32 header = readM<C, M, Long>(ea);
+
+    if ((header & 0xFF000000) == 0) {
+
+        // Null frame
+        fpuReset();
+        if (M == MODE_PI) writeA(n, ea + 4);
+
+    } else if ((header & 0xFFFF0000) == 0x1F180000) {
+
+        // Idle frame (the emulated FPU keeps no internal state)
+        if (M == MODE_PI) writeA(n, ea + 28);
+
+    } else {
+
+        reg.pc = reg.pc0 + 2;
+        execException<C>(EXC_FORMAT_ERROR);
+        CYCLES_68020(30);
+        return;
+    }
+
+    prefetch<C, POLL>();
+    CYCLES_68020(32);
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFSave(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+    SUPERVISOR_MODE_ONLY
+
+    int n = _____________xxx(opcode);
+    u32 ea = fpuComputeEA<C, M>(n, 28);
+
+    // Write an idle frame
+    writeM<C, M, Long>(ea, 0x1F180000);
+    for (int i = 1; i < 7; i++) writeM<C, M, Long>(ea + 4 * i, 0);
+
+    prefetch<C, POLL>();
+    CYCLES_68020(40);
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFScc(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
+    AVAILABILITY(C68020)
+
+    int n = _____________xxx(opcode);
+    int predicate = readI<C, Word>() & 0x3F;
+    u32 data = fpuCond(predicate) ? 0xFF : 0;
+
+    if constexpr (M == MODE_DN) {
+
+        writeD<Byte>(n, data);
+
+    } else {
+
+        u32 ea = fpuComputeEA<C, M>(n, 1);
+        writeM<C, M, Byte>(ea, data);
+    }
+
+    prefetch<C, POLL>();
+    CYCLES_68020(M == MODE_DN ? 10 : 14);
+
+    FINALIZE
 }
 
 template <Core C, Instr I, Mode M, Size S> void
 Moira::execFTrapcc(u16 opcode)
 {
-    execLineF<C, I, M, S>(opcode);
-}
+    AVAILABILITY(C68020)
+
+    int predicate = readI<C, Word>() & 0x3F;
+
+    switch (opcode & 0b111) {
 
+        case 0b010: (void)readI<C, Word>(); break;
+        case 0b011: (void)readI<C, Long>(); break;
+    }
+
+    if (fpuCond(predicate)) {
+
+        execException<C>(EXC_TRAPV);
+        CYCLES_68020(20);
+        return;
+    }
+
+    prefetch<C, POLL>();
+    CYCLES_68020(10);
+
+    FINALIZE
+}
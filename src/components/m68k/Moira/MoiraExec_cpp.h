@@ -45,7 +45,11 @@ Moira::execLineA(u16 opcode)
         prefetch<C>();
 
         // Inform the delegate
-        softwareTrapReached(reg.pc0);
+        u32 addr = reg.pc0;
+        softwareTrapReached(addr);
+
+        // Unless the delegate moved on, the original instruction runs next
+        swTrapResolved = (flags & CPU_CHECK_BP) && (reg.pc0 == addr);
         return;
     }
 
@@ -2184,7 +2188,7 @@ Moira::execDbcc(u16 opcode)
                 reg.pc = newpc;
                 fullPrefetch<C, POLL>();
 
-                if (loop[queue.ird] && disp == -4) {
+                if (loop && loop[queue.ird] && disp == -4) {
 
                     // Enter loop mode
                     flags |= CPU_IS_LOOPING;
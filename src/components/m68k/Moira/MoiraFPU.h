@@ -0,0 +1,53 @@
+// -----------------------------------------------------------------------------
+// This file is part of Moira - A Motorola 68k emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+//
+// Floating point unit (E64)
+//
+
+/* The FPU registers are kept in the 68881 extended format. Depending on the
+ * selected accuracy, arithmetic is carried out on host long doubles
+ * (FPU_FAST) or in softfloat (FPU_EXACT). Conversions between the register
+ * format and the memory formats always use softfloat. Transcendental
+ * functions always use the host's long double math.
+ */
+
+// Puts the FPU in its reset state
+void fpuReset();
+
+// Converts between the register format and host long doubles
+long double fpuToHost(const Float80 &value) const;
+Float80 fpuFromHost(long double value) const;
+
+// Returns the size in bytes of an operand in memory format fmt
+static int fpuFormatSize(int fmt);
+
+// Converts an operand in memory format fmt (packed decimal excluded)
+Float80 fpuFromFormat(int fmt, const u32 *data);
+void fpuToFormat(int fmt, const Float80 &value, u32 *data);
+
+// Returns a constant from the on-chip ROM (FMOVECR)
+Float80 fpuConstant(int offset) const;
+
+// Executes an arithmetic command, returns false if the command is unknown
+bool fpuArithmetic(int cmd, const Float80 &src, int dst);
+
+// Returns the number of 68881 clock cycles taken by an arithmetic command
+static int fpuCycles(int cmd);
+
+// Sets the condition codes according to a value
+void fpuSetCC(const Float80 &value);
+
+// Evaluates a conditional predicate (FBcc, FDBcc, FScc, FTRAPcc)
+bool fpuCond(int predicate);
+
+// Reads or writes an operand in memory format fmt
+template <Core C, Mode M> void fpuReadOp(int n, int fmt, u32 *data);
+template <Core C, Mode M> void fpuWriteOp(int n, int fmt, const u32 *data);
+
+// Computes the address of a multi word operand and updates An
+template <Core C, Mode M> u32 fpuComputeEA(int n, int bytes);
@@ -0,0 +1,642 @@
+// -----------------------------------------------------------------------------
+// This file is part of Moira - A Motorola 68k emulator
+//
+// Copyright (C) Dirk W. Hoffmann. www.dirkwhoffmann.de
+// Published under the terms of the MIT License
+// -----------------------------------------------------------------------------
+
+// The default NaN of the 68881 (softfloat and x87 have a negative one)
+static constexpr u16 FPU_NAN_HIGH = 0x7FFF;
+static constexpr u64 FPU_NAN_LOW  = 0xFFFFFFFFFFFFFFFF;
+
+static bool fpuIsNaN(const Float80 &value)
+{
+    return (value.raw.high & 0x7FFF) == 0x7FFF && (value.raw.low << 1) != 0;
+}
+
+static bool fpuIsInf(const Float80 &value)
+{
+    return (value.raw.high & 0x7FFF) == 0x7FFF && (value.raw.low << 1) == 0;
+}
+
+static bool fpuIsZero(const Float80 &value)
+{
+    return (value.raw.high & 0x7FFF) == 0 && value.raw.low == 0;
+}
+
+static bool fpuSign(const Float80 &value)
+{
+    return value.raw.high & 0x8000;
+}
+
+static Float80 fpuDefaultNaN()
+{
+    Float80 result;
+    result.raw.high = FPU_NAN_HIGH;
+    result.raw.low = FPU_NAN_LOW;
+    return result;
+}
+
+// Translates the softfloat exception flags to FPSR exception bits
+static u32 fpuSoftfloatExceptions()
+{
+    using namespace softfloat;
+
+    u32 result = 0;
+
+    if (float_exception_flags & float_flag_invalid) result |= FPSR_OPERR;
+    if (float_exception_flags & float_flag_divbyzero) result |= FPSR_DZ;
+    if (float_exception_flags & float_flag_overflow) result |= FPSR_OVFL;
+    if (float_exception_flags & float_flag_underflow) result |= FPSR_UNFL;
+    if (float_exception_flags & float_flag_inexact) result |= FPSR_INEX2;
+
+    return result;
+}
+
+// Sets exception bits and the accrued exception bits they imply
+static u32 fpuAccrue(u32 fpsr, u32 exceptions)
+{
+    fpsr |= exceptions;
+
+    if (exceptions & (FPSR_BSUN | FPSR_SNAN | FPSR_OPERR)) fpsr |= FPSR_IOP;
+    if (exceptions & FPSR_OVFL) fpsr |= FPSR_AOVFL;
+    if ((exceptions & FPSR_UNFL) && (exceptions & FPSR_INEX2)) fpsr |= FPSR_AUNFL;
+    if (exceptions & FPSR_DZ) fpsr |= FPSR_ADZ;
+    if (exceptions & (FPSR_OVFL | FPSR_INEX2 | FPSR_INEX1)) fpsr |= FPSR_INEX;
+
+    return fpsr;
+}
+
+void
+Moira::fpuReset()
+{
+    fpu.fpcr = 0;
+    fpu.fpsr = 0;
+    fpu.fpiar = 0;
+
+    for (int i = 0; i < 8; i++) fpu.fpr[i] = fpuDefaultNaN();
+}
+
+long double
+Moira::fpuToHost(const Float80 &value) const
+{
+    if constexpr (std::numeric_limits<long double>::digits == 64 &&
+                  std::endian::native == std::endian::little) {
+
+        // x87 extended precision, the same format in different byte order
+        long double result = 0;
+        memcpy((u8 *)&result, &value.raw.low, 8);
+        memcpy((u8 *)&result + 8, &value.raw.high, 2);
+        return result;
+
+    } else {
+
+        u64 bits = softfloat::floatx80_to_float64(value.raw);
+        double result;
+        memcpy(&result, &bits, 8);
+        return result;
+    }
+}
+
+Float80
+Moira::fpuFromHost(long double value) const
+{
+    Float80 result;
+
+    if constexpr (std::numeric_limits<long double>::digits == 64 &&
+                  std::endian::native == std::endian::little) {
+
+        memcpy(&result.raw.low, (u8 *)&value, 8);
+        memcpy(&result.raw.high, (u8 *)&value + 8, 2);
+
+    } else {
+
+        double d = (double)value;
+        u64 bits;
+        memcpy(&bits, &d, 8);
+        result.raw = softfloat::float64_to_floatx80(bits);
+    }
+
+    return result;
+}
+
+int
+Moira::fpuFormatSize(int fmt)
+{
+    //                   L  S   X   P  W  D  B   P
+    static const int size[8] = { 4, 4, 12, 12, 2, 8, 1, 12 };
+    return size[fmt & 7];
+}
+
+Float80
+Moira::fpuFromFormat(int fmt, const u32 *data)
+{
+    using namespace softfloat;
+
+    Float80 result;
+
+    switch (fmt) {
+
+        case 0: result.raw = int32_to_floatx80((i32)data[0]); break;
+        case 1: result.raw = float32_to_floatx80(data[0]); break;
+        case 4: result.raw = int32_to_floatx80((i16)data[0]); break;
+        case 5: result.raw = float64_to_floatx80((u64)data[0] << 32 | data[1]); break;
+        case 6: result.raw = int32_to_floatx80((i8)data[0]); break;
+
+        default:
+
+            result.raw.high = u16(data[0] >> 16);
+            result.raw.low = (u64)data[1] << 32 | data[2];
+            break;
+    }
+
+    return result;
+}
+
+void
+Moira::fpuToFormat(int fmt, const Float80 &value, u32 *data)
+{
+    using namespace softfloat;
+
+    float_rounding_mode = (fpu.fpcr >> 4) & 3;
+
+    switch (fmt) {
+
+        case 0: data[0] = (u32)floatx80_to_int32(value.raw); break;
+        case 1: data[0] = floatx80_to_float32(value.raw); break;
+
+        case 4:
+        case 6:
+        {
+            i32 limit = fmt == 4 ? 0x7FFF : 0x7F;
+            i32 result = floatx80_to_int32(value.raw);
+
+            if (result > limit || result < -limit - 1) {
+                float_raise(float_flag_invalid);
+                result = result > 0 ? limit : -limit - 1;
+            }
+            data[0] = (u32)result;
+            break;
+        }
+        case 5:
+        {
+            u64 result = floatx80_to_float64(value.raw);
+            data[0] = u32(result >> 32);
+            data[1] = u32(result);
+            break;
+        }
+        default:
+
+            data[0] = (u32)value.raw.high << 16;
+            data[1] = u32(value.raw.low >> 32);
+            data[2] = u32(value.raw.low);
+            break;
+    }
+}
+
+Float80
+Moira::fpuConstant(int offset) const
+{
+    static const struct { u8 offset; u16 high; u64 low; } rom[] = {
+
+        { 0x00, 0x4000, 0xC90FDAA22168C235 },   // Pi
+        { 0x0B, 0x3FFD, 0x9A209A84FBCFF798 },   // Log10(2)
+        { 0x0C, 0x4000, 0xADF85458A2BB4A9A },   // e
+        { 0x0D, 0x3FFF, 0xB8AA3B295C17F0BC },   // Log2(e)
+        { 0x0E, 0x3FFD, 0xDE5BD8A937287195 },   // Log10(e)
+        { 0x30, 0x3FFE, 0xB17217F7D1CF79AC },   // Ln(2)
+        { 0x31, 0x4000, 0x935D8DDDAAA8AC17 },   // Ln(10)
+        { 0x32, 0x3FFF, 0x8000000000000000 },   // 10^0
+        { 0x33, 0x4002, 0xA000000000000000 },   // 10^1
+        { 0x34, 0x4005, 0xC800000000000000 },   // 10^2
+        { 0x35, 0x400C, 0x9C40000000000000 },   // 10^4
+        { 0x36, 0x4019, 0xBEBC200000000000 },   // 10^8
+        { 0x37, 0x4034, 0x8E1BC9BF04000000 },   // 10^16
+        { 0x38, 0x4069, 0x9DC5ADA82B70B59E },   // 10^32
+        { 0x39, 0x40D3, 0xC2781F49FFCFA6D5 },   // 10^64
+        { 0x3A, 0x41A8, 0x93BA47C980E98CE0 },   // 10^128
+        { 0x3B, 0x4351, 0xAA7EEBFB9DF9DE8E },   // 10^256
+        { 0x3C, 0x46A3, 0xE319A0AEA60E91C7 },   // 10^512
+        { 0x3D, 0x4D48, 0xC976758681750C17 },   // 10^1024
+        { 0x3E, 0x5A92, 0x9E8B3B5DC53D5DE5 },   // 10^2048
+        { 0x3F, 0x7525, 0xC46052028A20979B }    // 10^4096
+    };
+
+    // All other offsets hold 0.0
+    Float80 result = { };
+
+    for (auto &entry : rom) {
+
+        if (entry.offset == offset) {
+
+            result.raw.high = entry.high;
+            result.raw.low = entry.low;
+        }
+    }
+
+    return result;
+}
+
+int
+Moira::fpuCycles(int cmd)
+{
+    // Register to register timing from the 68881 user's manual
+    switch (cmd) {
+
+        case 0x00: return 33;   // FMOVE
+        case 0x01: return 43;   // FINT
+        case 0x02: return 687;  // FSINH
+        case 0x03: return 43;   // FINTRZ
+        case 0x04: return 107;  // FSQRT
+        case 0x06: return 571;  // FLOGNP1
+        case 0x08: return 545;  // FETOXM1
+        case 0x09: return 661;  // FTANH
+        case 0x0A: return 403;  // FATAN
+        case 0x0C: return 581;  // FASIN
+        case 0x0D: return 693;  // FATANH
+        case 0x0E: return 391;  // FSIN
+        case 0x0F: return 473;  // FTAN
+        case 0x10: return 497;  // FETOX
+        case 0x11: return 567;  // FTWOTOX
+        case 0x12: return 567;  // FTENTOX
+        case 0x14: return 525;  // FLOGN
+        case 0x15: return 581;  // FLOG10
+        case 0x16: return 581;  // FLOG2
+        case 0x18: return 35;   // FABS
+        case 0x19: return 607;  // FCOSH
+        case 0x1A: return 35;   // FNEG
+        case 0x1C: return 625;  // FACOS
+        case 0x1D: return 391;  // FCOS
+        case 0x1E: return 45;   // FGETEXP
+        case 0x1F: return 31;   // FGETMAN
+        case 0x20: return 103;  // FDIV
+        case 0x21: return 70;   // FMOD
+        case 0x22: return 51;   // FADD
+        case 0x23: return 71;   // FMUL
+        case 0x24: return 69;   // FSGLDIV
+        case 0x25: return 100;  // FREM
+        case 0x26: return 41;   // FSCALE
+        case 0x27: return 59;   // FSGLMUL
+        case 0x28: return 51;   // FSUB
+        case 0x38: return 33;   // FCMP
+        case 0x3A: return 33;   // FTST
+
+        default:
+            return (cmd & 0x78) == 0x30 ? 451 : 33;    // FSINCOS
+    }
+}
+
+void
+Moira::fpuSetCC(const Float80 &value)
+{
+    u32 cc = 0;
+
+    if (fpuSign(value)) cc |= FPSR_N;
+
+    if (fpuIsNaN(value)) {
+        cc |= FPSR_NAN;
+    } else if (fpuIsInf(value)) {
+        cc |= FPSR_I;
+    } else if (fpuIsZero(value)) {
+        cc |= FPSR_Z;
+    }
+
+    fpu.fpsr = (fpu.fpsr & ~FPSR_CC) | cc;
+}
+
+bool
+Moira::fpuCond(int predicate)
+{
+    bool n = fpu.fpsr & FPSR_N;
+    bool z = fpu.fpsr & FPSR_Z;
+    bool nan = fpu.fpsr & FPSR_NAN;
+
+    // The second half of the predicates signals BSUN on unordered operands
+    if ((predicate & 0x10) && nan) fpu.fpsr = fpuAccrue(fpu.fpsr, FPSR_BSUN);
+
+    switch (predicate & 0x0F) {
+
+        case 0x00: return false;                    // F,   SF
+        case 0x01: return z;                        // EQ,  SEQ
+        case 0x02: return !(nan || z || n);         // OGT, GT
+        case 0x03: return z || !(nan || n);         // OGE, GE
+        case 0x04: return n && !(nan || z);         // OLT, LT
+        case 0x05: return z || (n && !nan);         // OLE, LE
+        case 0x06: return !(nan || z);              // OGL, GL
+        case 0x07: return !nan;                     // OR,  GLE
+        case 0x08: return nan;                      // UN,  NGLE
+        case 0x09: return nan || z;                 // UEQ, NGL
+        case 0x0A: return nan || !(n || z);         // UGT, NLE
+        case 0x0B: return nan || z || !n;           // UGE, NLT
+        case 0x0C: return nan || (n && !z);         // ULT, NGE
+        case 0x0D: return nan || z || n;            // ULE, NGT
+        case 0x0E: return !z;                       // NE,  SNE
+
+        default:
+            return true;                            // T,   ST
+    }
+}
+
+bool
+Moira::fpuArithmetic(int cmd, const Float80 &src, int dst)
+{
+    Float80 &fp = fpu.fpr[dst];
+    Float80 result = { };
+    u32 exceptions = 0;
+    long quotient = 0;
+    bool store = true;
+    bool done = false;
+
+    int mode = (fpu.fpcr >> 4) & 3;
+    int precision = (fpu.fpcr >> 6) & 3;
+
+    // FSGLDIV and FSGLMUL always round to single precision
+    if (cmd == 0x24 || cmd == 0x27) precision = 1;
+
+    //
+    // Exact path: basic arithmetic in softfloat
+    //
+
+    if (fpuAccuracy == FPU_EXACT) {
+
+        using namespace softfloat;
+
+        float_rounding_mode = mode;
+        floatx80_rounding_precision = precision == 1 ? 32 : precision == 2 ? 64 : 80;
+        float_exception_flags = 0;
+
+        auto round = [&](floatx80 value) {
+
+            int exp = value.high & 0x7FFF;
+            if (floatx80_rounding_precision == 80 || exp == 0 || exp == 0x7FFF) return value;
+            return roundAndPackFloatx80(floatx80_rounding_precision, value.high >> 15, exp, value.low, 0);
+        };
+
+        done = true;
+
+        switch (cmd) {
+
+            case 0x00: result.raw = round(src.raw); break;
+            case 0x01: result.raw = floatx80_round_to_int(src.raw); break;
+            case 0x03:
+
+                float_rounding_mode = float_round_to_zero;
+                result.raw = floatx80_round_to_int(src.raw);
+                break;
+
+            case 0x04: result.raw = floatx80_sqrt(src.raw); break;
+            case 0x18: result = src; result.raw.high &= 0x7FFF; result.raw = round(result.raw); break;
+            case 0x1A: result = src; result.raw.high ^= 0x8000; result.raw = round(result.raw); break;
+            case 0x20:
+            case 0x24: result.raw = floatx80_div(fp.raw, src.raw); break;
+            case 0x22: result.raw = floatx80_add(fp.raw, src.raw); break;
+            case 0x23:
+            case 0x27: result.raw = floatx80_mul(fp.raw, src.raw); break;
+            case 0x25:
+
+                result.raw = floatx80_rem(fp.raw, src.raw);
+                (void)remquol(fpuToHost(fp), fpuToHost(src), (int *)&quotient);
+                break;
+
+            case 0x28:
+            case 0x38: result.raw = floatx80_sub(fp.raw, src.raw); break;
+            case 0x3A: result = src; break;
+
+            default:
+                done = false;
+        }
+
+        if (done) {
+
+            exceptions = fpuSoftfloatExceptions();
+
+            // Division by zero isn't invalid on the 68881 (0 / 0 is)
+            if ((exceptions & FPSR_DZ) && fpuIsNaN(result)) exceptions &= ~FPSR_DZ;
+
+            // Don't inherit the negative default NaN of softfloat
+            if (fpuIsNaN(result) && !fpuIsNaN(src) && !fpuIsNaN(fp)) result = fpuDefaultNaN();
+        }
+    }
+
+    //
+    // Fast path: host long doubles
+    //
+
+    if (!done) {
+
+        long double a = fpuToHost(src);
+        long double b = fpuToHost(fp);
+        long double r;
+        bool binary = cmd >= 0x20 && cmd <= 0x38;
+
+        switch (cmd) {
+
+            case 0x00: r = a; break;
+            case 0x01:
+
+                r = mode == 0 ? nearbyintl(a) : mode == 1 ? truncl(a) : mode == 2 ? floorl(a) : ceill(a);
+                break;
+
+            case 0x02: r = sinhl(a); break;
+            case 0x03: r = truncl(a); break;
+            case 0x04: r = sqrtl(a); break;
+            case 0x06: r = log1pl(a); break;
+            case 0x08: r = expm1l(a); break;
+            case 0x09: r = tanhl(a); break;
+            case 0x0A: r = atanl(a); break;
+            case 0x0C: r = asinl(a); break;
+            case 0x0D: r = atanhl(a); break;
+            case 0x0E: r = sinl(a); break;
+            case 0x0F: r = tanl(a); break;
+            case 0x10: r = expl(a); break;
+            case 0x11: r = exp2l(a); break;
+            case 0x12: r = powl(10.0L, a); break;
+            case 0x14: r = logl(a); break;
+            case 0x15: r = log10l(a); break;
+            case 0x16: r = log2l(a); break;
+            case 0x18: r = fabsl(a); break;
+            case 0x19: r = coshl(a); break;
+            case 0x1A: r = -a; break;
+            case 0x1C: r = acosl(a); break;
+            case 0x1D: r = cosl(a); break;
+            case 0x1E:
+
+                r = (a == 0 || std::isnan(a)) ? a : std::isinf(a) ? NAN : (long double)ilogbl(a);
+                break;
+
+            case 0x1F:
+            {
+                int exp;
+                r = (a == 0 || std::isnan(a)) ? a : std::isinf(a) ? NAN : frexpl(a, &exp) * 2;
+                break;
+            }
+            case 0x20: r = b / a; break;
+            case 0x21:
+
+                r = fmodl(b, a);
+                quotient = (long)fmodl(truncl(b / a), 128.0L);
+                break;
+
+            case 0x22: r = b + a; break;
+            case 0x23: r = b * a; break;
+            case 0x24: r = b / a; break;
+            case 0x25:
+            {
+                int q;
+                r = remquol(b, a, &q);
+                quotient = q;
+                break;
+            }
+            case 0x26:
+            {
+                long double scale = truncl(a);
+                if (scale > 0x4000) scale = 0x4000;
+                if (scale < -0x4000) scale = -0x4000;
+                r = std::isnan(a) || std::isinf(a) ? NAN : ldexpl(b, (int)scale);
+                break;
+            }
+            case 0x27: r = b * a; break;
+            case 0x28: r = b - a; break;
+            case 0x38: r = b - a; break;
+            case 0x3A: r = a; break;
+
+            default:
+
+                // FSINCOS
+                if ((cmd & 0x78) != 0x30) return false;
+
+                r = sinl(a);
+                fpu.fpr[cmd & 7] = fpuFromHost(cosl(a));
+                break;
+        }
+
+        if (precision == 1) r = (float)r;
+        if (precision == 2) r = (double)r;
+
+        // Invalid operations, division by zero and overflows are reported
+        bool operandNaN = std::isnan(a) || (binary && std::isnan(b));
+        bool operandInf = std::isinf(a) || (binary && std::isinf(b));
+
+        if (std::isnan(r) && !operandNaN) {
+
+            exceptions |= FPSR_OPERR;
+            result = fpuDefaultNaN();
+
+        } else {
+
+            if (std::isinf(r) && !operandInf) {
+                exceptions |= a == 0 ? FPSR_DZ : FPSR_OVFL | FPSR_INEX2;
+            }
+            result = fpuFromHost(r);
+        }
+    }
+
+    // FMOD and FREM report the lowest bits of the quotient
+    if (cmd == 0x21 || cmd == 0x25) {
+
+        u32 q = (u32)(quotient < 0 ? -quotient : quotient) & 0x7F;
+        if (fpuSign(src) != fpuSign(fp)) q |= 0x80;
+        fpu.fpsr = (fpu.fpsr & ~0xFF0000) | q << 16;
+    }
+
+    // FCMP and FTST only set the condition codes
+    if (cmd == 0x38 || cmd == 0x3A) {
+
+        store = false;
+
+        // Equal infinities compare as equal
+        if (cmd == 0x38 && fpuIsInf(src) && fpuIsInf(fp) && fpuSign(src) == fpuSign(fp)) {
+            result = { };
+            result.raw.high = fpuSign(fp) ? 0x8000 : 0;
+        }
+    }
+
+    fpu.fpsr = fpuAccrue(fpu.fpsr & ~0xFF00, exceptions);
+    fpuSetCC(result);
+    if (store) fp = result;
+
+    return true;
+}
+
+template <Core C, Mode M> u32
+Moira::fpuComputeEA(int n, int bytes)
+{
+    u32 ea;
+
+    switch (M) {
+
+        case MODE_PD:
+
+            ea = readA(n) - ((n == 7 && bytes == 1) ? 2 : bytes);
+            writeA(n, ea);
+            return ea;
+
+        case MODE_PI:
+
+            ea = readA(n);
+            writeA(n, ea + ((n == 7 && bytes == 1) ? 2 : bytes));
+            return ea;
+
+        default:
+
+            return computeEA<C, M, Long>(n);
+    }
+}
+
+template <Core C, Mode M> void
+Moira::fpuReadOp(int n, int fmt, u32 *data)
+{
+    int bytes = fpuFormatSize(fmt);
+
+    switch (M) {
+
+        case MODE_DN: data[0] = readD(n); return;
+        case MODE_AN: data[0] = readA(n); return;
+
+        case MODE_IM:
+
+            if (bytes == 1) { data[0] = readI<C, Byte>(); return; }
+            if (bytes == 2) { data[0] = readI<C, Word>(); return; }
+            for (int i = 0; i < bytes / 4; i++) data[i] = readI<C, Long>();
+            return;
+
+        default:
+        {
+            u32 ea = fpuComputeEA<C, M>(n, bytes);
+
+            if (bytes == 1) { data[0] = readM<C, M, Byte>(ea); return; }
+            if (bytes == 2) { data[0] = readM<C, M, Word>(ea); return; }
+            for (int i = 0; i < bytes / 4; i++) data[i] = readM<C, M, Long>(ea + 4 * i);
+        }
+    }
+}
+
+template <Core C, Mode M> void
+Moira::fpuWriteOp(int n, int fmt, const u32 *data)
+{
+    int bytes = fpuFormatSize(fmt);
+
+    switch (M) {
+
+        case MODE_DN:
+
+            if (bytes == 1) { writeD<Byte>(n, data[0]); return; }
+            if (bytes == 2) { writeD<Word>(n, data[0]); return; }
+            writeD(n, data[0]);
+            return;
+
+        case MODE_AN:
+
+            writeA(n, data[0]);
+            return;
+
+        default:
+        {
+            u32 ea = fpuComputeEA<C, M>(n, bytes);
+
+            if (bytes == 1) { writeM<C, M, Byte>(ea, data[0]); return; }
+            if (bytes == 2) { writeM<C, M, Word>(ea, data[0]); return; }
+            for (int i = 0; i < bytes / 4; i++) writeM<C, M, Long>(ea + 4 * i, data[i]);
+        }
+    }
+}
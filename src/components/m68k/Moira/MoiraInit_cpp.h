@@ -11,7 +11,7 @@
 
 // Registers an instruction handler
 #if ENABLE_DASM == true
-#define REGISTER_DASM(id,name,I,M,S) if (regDasm) dasm[id] = DASM_HANDLER(name,I,M,S);
+#define REGISTER_DASM(id,name,I,M,S) if (regDasm) dasm[id] = registerDasm(DASM_HANDLER(name,I,M,S));
 #else
 #define REGISTER_DASM(id,name,I,M,S) { }
 #endif
@@ -23,14 +23,16 @@
 #endif
 
 #define CIMS(id,name,I,M,S) { \
-exec[id] = EXEC_HANDLER(name,C,I,M,S); \
+exec[id] = registerExec(EXEC_HANDLER(name,C,I,M,S)); \
 REGISTER_DASM(id,name,I,M,S) \
 REGISTER_INFO(id,name,I,M,S) \
 }
 
 #define CIMSloop(id,name,I,M,S) { \
-assert(loop[id] == nullptr); \
-loop[id] = EXEC_HANDLER(name,C68010,I##_LOOP,M,S); \
+if constexpr (C == C68010) { \
+assert(loop[id] == 0); \
+loop[id] = registerExec(EXEC_HANDLER(name,C,I##_LOOP,M,S)); \
+} \
 }
 
 // Registers an instruction in one of the standard instruction formats:
@@ -160,21 +162,61 @@ Moira::createJumpTable(Model cpuModel, Model dasmModel)
         return model == M68000 ? C68000 : model == M68010 ? C68010 : C68020;
     };
 
-    Core cpuCore = core(cpuModel);
-    Core dasmCore = core(dasmModel);
+    // Only cores that are built have handlers (E64)
+    auto create = [&](Model model, bool regDasm) {
+
+        bool built = false;
+
+        if constexpr (BUILD_68000_CORE) {
+            if (core(model) == C68000) { createJumpTable<C68000>(model, regDasm); built = true; }
+        }
+        if constexpr (BUILD_68010_CORE) {
+            if (core(model) == C68010) { createJumpTable<C68010>(model, regDasm); built = true; }
+        }
+        if constexpr (BUILD_68020_CORE) {
+            if (core(model) == C68020) { createJumpTable<C68020>(model, regDasm); built = true; }
+        }
+
+        if (!built) throw std::runtime_error("The core of this model isn't built\n");
+    };
 
     // Register handlers based on the dasm model
-    if (dasmCore == C68000) createJumpTable<C68000>(dasmModel, true);
-    if (dasmCore == C68010) createJumpTable<C68010>(dasmModel, true);
-    if (dasmCore == C68020) createJumpTable<C68020>(dasmModel, true);
+    create(dasmModel, true);
 
     // If both models differ, overwrite the exec handlers
-    if (cpuModel != dasmModel) {
+    if (cpuModel != dasmModel) create(cpuModel, false);
+}
+
+u16
+Moira::registerExec(ExecPtr handler)
+{
+    // Most opcodes share their handler with one of the last few registered,
+    // the others are looked up in all of them
+    for (int i = execHandlerCount - 1; i > 0 && i >= execHandlerCount - 16; i--) {
+        if (execHandlers[i] == handler) return u16(i);
+    }
+    for (int i = execHandlerCount - 17; i > 0; i--) {
+        if (execHandlers[i] == handler) return u16(i);
+    }
+
+    assert(execHandlerCount < MAX_EXEC_HANDLERS);
+    execHandlers[execHandlerCount] = handler;
+    return u16(execHandlerCount++);
+}
 
-        if (cpuCore == C68000) createJumpTable<C68000>(cpuModel, false);
-        if (cpuCore == C68010) createJumpTable<C68010>(cpuModel, false);
-        if (cpuCore == C68020) createJumpTable<C68020>(cpuModel, false);
+u16
+Moira::registerDasm(DasmPtr handler)
+{
+    for (int i = dasmHandlerCount - 1; i >= 0 && i >= dasmHandlerCount - 16; i--) {
+        if (dasmHandlers[i] == handler) return u16(i);
+    }
+    for (int i = dasmHandlerCount - 17; i >= 0; i--) {
+        if (dasmHandlers[i] == handler) return u16(i);
     }
+
+    assert(dasmHandlerCount < MAX_DASM_HANDLERS);
+    dasmHandlers[dasmHandlerCount] = handler;
+    return u16(dasmHandlerCount++);
 }
 
 template <Core C> void
@@ -186,10 +228,15 @@ Moira::createJumpTable(Model model, bool regDasm)
     // Start with clean tables
     //
 
+    execHandlerCount = 1;
+    if (regDasm) dasmHandlerCount = 0;
+
     XXXXXXXXXXXXXXXX(ILLEGAL, MODE_IP, (Size)0, Illegal, CIMS)
 
-    for (int i = 0; i < 0x10000; i++) {
-        loop[i] = nullptr;
+    if (loop) {
+        for (int i = 0; i < 0x10000; i++) {
+            loop[i] = 0;
+        }
     }
 
 
@@ -1952,7 +1999,8 @@ Moira::createJumpTable(Model model, bool regDasm)
         // Floating point unit
         //
 
-        if (model == M68040) {
+        // (E64: the 68020 executes these with an attached 68881)
+        if (model == M68040 || fpuAttached) {
 
             opcode = parse("1111 0010 100- ----");
             ___________XXXXX(opcode, FBcc, MODE_IP, Word, FBcc, CIMS)
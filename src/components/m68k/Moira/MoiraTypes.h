@@ -47,6 +47,13 @@ typedef enum
 }
 Model;
 
+typedef enum
+{
+    FPU_FAST,               // Arithmetic on host long doubles (E64)
+    FPU_EXACT               // Extended precision arithmetic in softfloat (E64)
+}
+FPUAccuracy;
+
 typedef enum
 {
     C68000,                 // Used by M68000
@@ -441,6 +448,49 @@ static constexpr int CPU_CHECK_BP           = (1 << 15);
 static constexpr int CPU_CHECK_WP           = (1 << 16);
 static constexpr int CPU_CHECK_CP           = (1 << 17);
 
+/* FPU status register (E64)
+ *
+ * FPSR_N, FPSR_Z, FPSR_I, FPSR_NAN:
+ *     Floating point condition codes.
+ *
+ * FPSR_BSUN ... FPSR_INEX1:
+ *     Exception status of the last arithmetic instruction.
+ *
+ * FPSR_IOP ... FPSR_INEX:
+ *     Accrued exceptions.
+ */
+static constexpr u32 FPSR_N                 = (1 << 27);
+static constexpr u32 FPSR_Z                 = (1 << 26);
+static constexpr u32 FPSR_I                 = (1 << 25);
+static constexpr u32 FPSR_NAN               = (1 << 24);
+static constexpr u32 FPSR_CC                = FPSR_N | FPSR_Z | FPSR_I | FPSR_NAN;
+static constexpr u32 FPSR_BSUN              = (1 << 15);
+static constexpr u32 FPSR_SNAN              = (1 << 14);
+static constexpr u32 FPSR_OPERR             = (1 << 13);
+static constexpr u32 FPSR_OVFL              = (1 << 12);
+static constexpr u32 FPSR_UNFL              = (1 << 11);
+static constexpr u32 FPSR_DZ                = (1 << 10);
+static constexpr u32 FPSR_INEX2             = (1 << 9);
+static constexpr u32 FPSR_INEX1             = (1 << 8);
+static constexpr u32 FPSR_IOP               = (1 << 7);
+static constexpr u32 FPSR_AOVFL             = (1 << 6);
+static constexpr u32 FPSR_AUNFL             = (1 << 5);
+static constexpr u32 FPSR_ADZ               = (1 << 4);
+static constexpr u32 FPSR_INEX              = (1 << 3);
+
+/* Dense handler arrays (E64)
+ *
+ * MAX_EXEC_HANDLERS:
+ *     Capacity of the array holding the instruction handlers of a single
+ *     core. Each distinct (instruction, mode, size) combination needs a
+ *     slot.
+ *
+ * MAX_DASM_HANDLERS:
+ *     Capacity of the array holding the disassembler handlers.
+ */
+static constexpr int MAX_EXEC_HANDLERS      = 4096;
+static constexpr int MAX_DASM_HANDLERS      = 4096;
+
 /* Execution flags
  *
  * The M68k is a well organized processor that breaks down the execution of
@@ -6,32 +6,544 @@
  */
 
 #include "m68k.hpp"
-#include "common.hpp"
+#include "m68k_api.hpp"
+#include "blitter.hpp"
 
-u8 E64::m68k_ic::read8(u32 addr) const
+E64::m68k_ic::m68k_ic(mmu_ic *unit, bool coprocessor)
 {
-	return machine.mmu->read_memory_8(addr);
+	mmu = unit;
+	blitter = nullptr;
+	is_coprocessor = coprocessor;
+	breakpoint_reached = false;
+	for (int i=0; i<8; i++) interrupts[i] = 0;
+	trace_count = 0;
+	
+	blocks = nullptr;
+	current_block = nullptr;
+	current_instruction = 0;
+	block_cache_enabled = false;
+	blocks_built = 0;
+	
+	jit = nullptr;
+	jit_enabled = false;
+	pass_start_clock = 0;
+	blocks_translated = 0;
+	jit_flushes = 0;
+	loops_run = 0;
+	
+	hle_enabled = false;
+	hle_limit = 0;
+	host_calls = 0;
+}
+
+E64::m68k_ic::~m68k_ic()
+{
+	delete jit;
+	delete [] blocks;
+}
+
+void E64::m68k_ic::connect_blitter(blitter_ic *unit)
+{
+	blitter = unit;
+}
+
+void E64::m68k_ic::enable_block_cache(bool enable)
+{
+	if (enable && !blocks) blocks = new block_t[M68K_BLOCKS];
+	block_cache_enabled = enable;
+	flush_blocks();
+}
+
+void E64::m68k_ic::flush_blocks()
+{
+	current_block = nullptr;
+	if (blocks) {
+		for (int i=0; i<M68K_BLOCKS; i++) blocks[i].start = 1;
+	}
+	if (jit) jit->flush();
+}
+
+bool E64::m68k_ic::enable_jit(bool enable)
+{
+	if (enable && !jit) {
+		jit_layout_t layout;
+		u8 *base = (u8 *)&reg;
+		layout.r = (u8 *)&reg.r[0] - base;
+		layout.x = (u8 *)&reg.sr.x - base;
+		layout.n = (u8 *)&reg.sr.n - base;
+		layout.z = (u8 *)&reg.sr.z - base;
+		layout.v = (u8 *)&reg.sr.v - base;
+		layout.c = (u8 *)&reg.sr.c - base;
+		jit = new m68k_jit_t(layout);
+	}
+	jit_enabled = enable && jit->available();
+	flush_blocks();
+	return jit_enabled == enable;
+}
+
+void E64::m68k_ic::enable_fpu(bool enable)
+{
+	setFPU(enable);
+	
+	/*
+	 * Cached blocks hold handlers of the old jump table
+	 */
+	flush_blocks();
+}
+
+void E64::m68k_ic::set_fpu_accuracy(FPUAccuracy accuracy)
+{
+	setFPUAccuracy(accuracy);
+}
+
+void E64::m68k_ic::code_page_written(uint16_t page)
+{
+	if (current_block && ((current_block->start >> CODE_PAGE_SHIFT) == page)) {
+		current_block = nullptr;
+	}
+}
+
+/*
+ * Kernel ram, kernel rom and general ram. The blitter writes to its
+ * own ram areas without the mmu, so code there isn't cached.
+ */
+static inline bool cacheable(u32 pc)
+{
+	return ((pc >= 0x001000) && (pc < 0x010000)) || ((pc >= 0x020000) && (pc < 0x200000));
+}
+
+/*
+ * Instructions that (may) change the flow of control end a block
+ */
+static inline bool ends_block(u16 opcode)
+{
+	return	((opcode & 0xf000) == 0x6000) ||	// bra, bsr, bcc
+		((opcode & 0xf0f8) == 0x50c8) ||	// dbcc
+		((opcode & 0xf0f8) == 0x50f8) ||	// trapcc
+		((opcode & 0xff80) == 0x4e80) ||	// jsr, jmp
+		((opcode & 0xfff0) == 0x4e40) ||	// trap
+		((opcode & 0xfff8) == 0x4e70) ||	// reset, nop, stop, rte, rtd, rts, trapv, rtr
+		((opcode & 0xffc0) == 0x46c0) ||	// move to sr
+		(opcode == 0x007c) || (opcode == 0x027c) || (opcode == 0x0a7c) ||	// ori, andi, eori to sr
+		(opcode == 0x4afc) ||			// illegal
+		((opcode & 0xf000) == 0xa000) ||	// line a
+		(((opcode & 0xf000) == 0xf000) &&	// line f, except for
+		 ((opcode & 0xffc0) != 0xf200));	// fpu general instructions
+}
+
+/*
+ * Loop idioms, a store to (Ax)+ followed by a dbf back to it:
+ *
+ *	move.s	(Ay)+,(Ax)+	copy
+ *	move.s	Dy,(Ax)+	fill with Dy
+ *	clr.s	(Ax)+		fill with zeroes
+ *
+ * Returns the size of the elements, or 0 if the words don't start
+ * with one. The stack pointer, which moves by 2 on bytes, isn't used,
+ * neither are a copy onto itself and a fill with the loop counter.
+ */
+static int loop_idiom_size(const u16 *words)
+{
+	u16 opcode = words[0];
+	int dn = words[1] & 7;
+	
+	if (((words[1] & 0xfff8) != 0x51c8) || (words[2] != 0xfffc)) return 0;
+	
+	if ((opcode & 0xff38) == 0x4218) {
+		if ((opcode & 7) == 7) return 0;
+		switch (opcode & 0x00c0) {
+			case 0x0000: return 1;
+			case 0x0040: return 2;
+			case 0x0080: return 4;
+		}
+		return 0;
+	}
+	
+	int ax = (opcode >> 9) & 7;
+	int y = opcode & 7;
+	if ((opcode & 0xc1f8) == 0x00d8) {
+		if ((ax == 7) || (y == 7) || (ax == y)) return 0;
+	} else if ((opcode & 0xc1f8) == 0x00c0) {
+		if ((ax == 7) || (y == dn)) return 0;
+	} else {
+		return 0;
+	}
+	
+	switch (opcode & 0x3000) {
+		case 0x1000: return 1;
+		case 0x3000: return 2;
+		case 0x2000: return 4;
+	}
+	return 0;
+}
+
+E64::m68k_ic::block_t *E64::m68k_ic::find_block(u32 pc)
+{
+	if ((pc & 1) || !cacheable(pc)) return nullptr;
+	
+	block_t *block = &blocks[(pc >> 1) & (M68K_BLOCKS - 1)];
+	
+	if ((block->start == pc) && (block->generation == mmu->code_generation(pc))) return block;
+	
+	/*
+	 * Decode a new block, instruction lengths come from the
+	 * disassembler
+	 */
+	char text[256];
+	
+	block->start = pc;
+	block->size = (1 << CODE_PAGE_SHIFT) - (pc & ((1 << CODE_PAGE_SHIFT) - 1));
+	block->generation = mmu->code_generation(pc);
+	block->no_of_instructions = 0;
+	for (u32 i = 0; i < block->size; i += 2) block->words[i >> 1] = mmu->read_memory_16(pc + i);
+	
+	u32 offset = 0;
+	while ((block->no_of_instructions < M68K_BLOCK_INSTRUCTIONS) && (offset < block->size)) {
+		u16 opcode = block->words[offset >> 1];
+		u32 length = disassemble(pc + offset, text);
+		if (offset + length > block->size) break;
+		block->offsets[block->no_of_instructions] = offset;
+		block->handlers[block->no_of_instructions] = execHandler(opcode);
+		block->no_of_instructions++;
+		offset += length;
+		if (ends_block(opcode)) break;
+	}
+	
+	if (block->no_of_instructions == 0) {
+		block->start = 1;
+		return nullptr;
+	}
+	
+	/*
+	 * The last instruction is always left to the interpreter, it
+	 * marks the end of the head
+	 */
+	block->jit_instructions = 0;
+	block->jit_passes = 0;
+	block->jit_cycles = 0;
+	block->jit = nullptr;
+	if (jit_enabled) {
+		while ((block->jit_instructions < block->no_of_instructions - 1) &&
+		       m68k_jit_t::supported(block->words[block->offsets[block->jit_instructions] >> 1])) {
+			block->jit_instructions++;
+		}
+		if (block->jit_instructions < 2) block->jit_instructions = 0;
+	}
+	
+	block->loop_idiom = (block->no_of_instructions == 2) && (block->size >= 6) &&
+		loop_idiom_size(block->words);
+	
+	mmu->mark_code_page(pc);
+	blocks_built++;
+	return block;
+}
+
+/*
+ * Called when the interpreter reaches the end of the head of the
+ * current block, in an uninterrupted pass from its start
+ */
+void E64::m68k_ic::profile_block(i64 cycles)
+{
+	block_t *block = current_block;
+	
+	if (block->jit_passes && (cycles != block->jit_cycles)) {
+		block->jit_instructions = 0;
+		return;
+	}
+	
+	block->jit_cycles = cycles;
+	if (++block->jit_passes < M68K_JIT_THRESHOLD) return;
+	
+	u16 opcodes[M68K_BLOCK_INSTRUCTIONS];
+	for (int i = 0; i < block->jit_instructions; i++) {
+		opcodes[i] = block->words[block->offsets[i] >> 1];
+	}
+	
+	/*
+	 * Rebuilt blocks are translated again, so the buffer fills up
+	 * in the long run. Starting over keeps the jit going.
+	 */
+	if (jit->full(block->jit_instructions)) {
+		flush_translations();
+		jit_flushes++;
+	}
+	
+	block->jit = jit->translate(opcodes, block->jit_instructions);
+	if (block->jit) {
+		blocks_translated++;
+	} else {
+		block->jit_instructions = 0;
+	}
+}
+
+/*
+ * Drops all translated code, decoded blocks stay and are profiled
+ * again
+ */
+void E64::m68k_ic::flush_translations()
+{
+	for (int i=0; i<M68K_BLOCKS; i++) {
+		blocks[i].jit = nullptr;
+		blocks[i].jit_passes = 0;
+	}
+	jit->flush();
 }
 
-u16 E64::m68k_ic::read16(u32 addr) const
+/*
+ * Runs the translated head of the current block and leaves the cpu as
+ * the interpreter would: at the next instruction with a full prefetch
+ * queue
+ */
+int E64::m68k_ic::run_translated_block()
+{
+	block_t *block = current_block;
+	
+	block->jit(&reg);
+	clock += block->jit_cycles;
+	
+	u32 offset = block->offsets[block->jit_instructions];
+	reg.pc = reg.pc0 = block->start + offset;
+	queue.ird = block->words[offset >> 1];
+	queue.irc = (offset + 2 < block->size) ? block->words[(offset >> 1) + 1] : mmu->read_memory_16(reg.pc + 2);
+	readBuffer = queue.irc;
+	
+	current_instruction = block->jit_instructions;
+	return block->jit_instructions;
+}
+
+/*
+ * Video memory, both for reads and writes, without side effects (see
+ * m68k_api.hpp)
+ */
+static inline bool video_memory(u32 address, u32 size)
 {
-	return (machine.mmu->read_memory_8(addr) << 8) | machine.mmu->read_memory_8(addr+1);
+	return (address >= 0x060000) && (address < 0x1000000) && (address + size <= 0x1000000);
+}
+
+/*
+ * Runs as many passes of the loop idiom in the current block as fit
+ * before limit, with a bulk store to video memory. Registers, flags,
+ * clock and prefetch queue end up as with the interpreter. On the
+ * 68020, a move or clr from and to memory takes 8 cycles and a move
+ * from a data register 4. A dbf takes 6 cycles when it branches and 10
+ * when it expires. Returns the number of instructions executed, or 0
+ * to leave the loop to the interpreter.
+ */
+int E64::m68k_ic::run_loop_idiom(i64 limit)
+{
+	block_t *block = current_block;
+	u32 start = block->start;
+	u16 opcode = block->words[0];
+	u16 dbf = block->words[1];
+	int size = loop_idiom_size(block->words);
+	
+	bool clear = (opcode & 0xf000) == 0x4000;
+	bool copy = !clear && ((opcode & 0x0038) == 0x0018);
+	int ax = clear ? (opcode & 7) : ((opcode >> 9) & 7);
+	int y = opcode & 7;
+	int dn = dbf & 7;
+	i64 pass_cycles = (clear || copy) ? 8 + 6 : 4 + 6;
+	
+	/*
+	 * Counter plus one passes, the last one with an expiring dbf
+	 */
+	u32 counter = readD(dn) & 0xffff;
+	u32 passes = counter + 1;
+	i64 cycles = (i64)passes * pass_cycles + 4;
+	bool complete = (clock + cycles <= limit);
+	if (!complete) {
+		i64 fit = (limit - clock) / pass_cycles;
+		passes = (fit < counter) ? fit : counter;
+		if (passes == 0) return 0;
+		cycles = (i64)passes * pass_cycles;
+	}
+	
+	u32 dst = readA(ax);
+	u32 src = copy ? readA(y) : 0;
+	u32 bytes = passes * size;
+	
+	if (!video_memory(dst, bytes) || (copy && !video_memory(src, bytes))) return 0;
+	if (copy && (dst > src) && (dst < src + bytes)) return 0;
+	if ((flags & CPU_CHECK_WP) && (debugger.watchpoints.onPages(dst, bytes) ||
+				       (copy && debugger.watchpoints.onPages(src, bytes)))) return 0;
+	if ((dst < start + 6) && (dst + bytes > start)) return 0;
+	
+	for (u32 page = dst >> CODE_PAGE_SHIFT; page <= ((dst + bytes - 1) >> CODE_PAGE_SHIFT); page++) {
+		mmu->track_write(page << CODE_PAGE_SHIFT);
+	}
+	
+	u32 mask = (size == 4) ? 0xffffffff : (1 << (8 * size)) - 1;
+	u32 value = 0;
+	if (copy) {
+		blitter->video_memory_copy(dst, src, bytes);
+		for (int i = 0; i < size; i++) {
+			value = (value << 8) | blitter->video_memory_read_8(dst + bytes - size + i);
+		}
+		writeA(y, src + bytes);
+	} else {
+		value = clear ? 0 : readD(y) & mask;
+		blitter->video_memory_fill(dst, value, size, bytes);
+	}
+	writeA(ax, dst + bytes);
+	writeD(dn, (readD(dn) & 0xffff0000) | ((counter - passes) & 0xffff));
+	
+	reg.sr.n = value & (1 << ((8 * size) - 1));
+	reg.sr.z = (value == 0);
+	reg.sr.v = reg.sr.c = false;
+	writeBuffer = (size == 4) ? (value >> 16) : (value & 0xffff);
+	
+	clock += cycles;
+	
+	if (complete) {
+		reg.pc = reg.pc0 = start + 6;
+		queue.ird = mmu->read_memory_16(reg.pc);
+		queue.irc = mmu->read_memory_16(reg.pc + 2);
+		current_instruction = 2;
+	} else {
+		reg.pc = reg.pc0 = start;
+		queue.ird = opcode;
+		queue.irc = dbf;
+		current_instruction = 0;
+	}
+	readBuffer = queue.irc;
+	
+	loops_run++;
+	return 2 * passes;
 }
 
-void E64::m68k_ic::write8 (u32 addr, u8 val) const
+int E64::m68k_ic::execute_cached(i64 limit)
 {
-	machine.mmu->write_memory_8(addr, val);
+	hle_limit = limit;
+	
+	/*
+	 * Pending interrupts, tracing, stop, halt and logging all take
+	 * the slow path in execute(). Breakpoints and watchpoints don't,
+	 * their pages are looked up in constant time.
+	 */
+	if ((flags & ~(CPU_CHECK_BP | CPU_CHECK_WP)) || !block_cache_enabled) {
+		current_block = nullptr;
+		execute();
+		return 1;
+	}
+	
+	if (!current_block ||
+	    (current_instruction == current_block->no_of_instructions) ||
+	    (reg.pc != current_block->start + current_block->offsets[current_instruction])) {
+		current_block = find_block(reg.pc);
+		current_instruction = 0;
+		if (!current_block) {
+			execute();
+			return 1;
+		}
+	}
+	
+	/*
+	 * The prefetched opcode may predate a write to the code
+	 */
+	if (queue.ird != current_block->words[current_block->offsets[current_instruction] >> 1]) {
+		current_block = nullptr;
+		execute();
+		return 1;
+	}
+	
+	/*
+	 * Translated code doesn't poll the ipl lines, so it only runs if
+	 * polling wouldn't change anything. Events are only due at or
+	 * after limit, ending below it gives the same result as the
+	 * interpreter. Loop idioms don't poll either. Neither of them
+	 * runs on a code page with breakpoints.
+	 */
+	bool guarded = (flags & CPU_CHECK_BP) && debugger.breakpoints.onPage(current_block->start);
+	
+	if (current_block->loop_idiom && (current_instruction == 0) && (ipl == reg.ipl) && !guarded) {
+		int instructions = run_loop_idiom(limit);
+		if (instructions) {
+			check_breakpoints();
+			return instructions;
+		}
+	}
+	
+	if (current_block->jit_instructions) {
+		if (current_instruction == 0) {
+			if (current_block->jit && (ipl == reg.ipl) && !guarded &&
+			    (clock + current_block->jit_cycles < limit)) {
+				return run_translated_block();
+			}
+			pass_start_clock = clock;
+		} else if ((current_instruction == current_block->jit_instructions) && !current_block->jit) {
+			profile_block(clock - pass_start_clock);
+		}
+	}
+	
+	/*
+	 * Same as the fast path in execute()
+	 */
+	reg.pc += 2;
+	try {
+		(this->*current_block->handlers[current_instruction++])(queue.ird);
+	} catch (const std::exception &exc) {
+		processException(exc);
+	}
+	
+	check_breakpoints();
+	return 1;
 }
 
-void E64::m68k_ic::write16(u32 addr, u16 val) const
+void E64::m68k_ic::jump(u32 addr)
 {
-	machine.mmu->write_memory_8(addr, (val & 0xff00) >> 8);
-	machine.mmu->write_memory_8(addr + 1, val & 0x00ff);
+	reg.pc = reg.pc0 = addr;
+	queue.ird = mmu->read_memory_16(addr);
+	queue.irc = mmu->read_memory_16(addr + 2);
 }
 
-void E64::m68k_ic::breakpointReached(u32 addr)
+i64 E64::m68k_ic::fast_forward(i64 moment)
 {
-	breakpoint_reached = true;
+	i64 step;
+	
+	if (flags & CPU_IS_HALTED) {
+		step = 2;
+	} else if ((flags & CPU_IS_STOPPED) && reg.sr.s &&
+		   !(flags & (CPU_CHECK_IRQ | CPU_TRACE_EXCEPTION | CPU_TRACE_FLAG))) {
+		/*
+		 * Stopped with no interrupt pending, each poll of the
+		 * ipl lines takes 2 cycles
+		 */
+		step = 2;
+	} else if (!flags && (queue.ird == 0x60fe)) {
+		/*
+		 * bra.s to itself, 10 cycles per iteration on the 68020
+		 */
+		step = 10;
+	} else if (!flags && !is_coprocessor && (queue.ird == 0x1039) && (queue.irc == 0x0000) &&
+		   (read16(reg.pc + 4) == 0x0a04) && (read16(reg.pc + 6) == 0x67f8) &&
+		   !(readD(0) & 0xff) && ((getSR() & 0xf) == 0b0100) && !mmu->key_events_waiting()) {
+		/*
+		 * The kernel's prompt polling the cia for a key:
+		 *
+		 *	move.b	$00000a04,d0
+		 *	beq.s	*-6
+		 *
+		 * 12 cycles per iteration on the 68020. As long as no key
+		 * events are waiting, the read returns 0 without side
+		 * effects, and d0 and the flags don't change. The loop
+		 * has a boundary halfway, so only whole iterations before
+		 * moment are skipped, the last one is interpreted. That
+		 * way, interrupts are taken between the same instructions.
+		 */
+		if (clock >= moment) return 0;
+		
+		i64 skipped = ((moment - clock) / 12) * 12;
+		clock += skipped;
+		return skipped;
+	} else {
+		return 0;
+	}
+	
+	if (clock >= moment) return 0;
+	
+	i64 skipped = ((moment - clock + step - 1) / step) * step;
+	clock += skipped;
+	return skipped;
 }
 
 void E64::m68k_ic::status(char *text_buffer)
@@ -69,9 +581,49 @@ void E64::m68k_ic::stacks(char *text_buffer, int no)
 		uint32_t usp = (getUSP() + i) & 0xffffffff;
 		text_buffer += sprintf(text_buffer,
 				 "%08x %02x  %08x %02x  %08x %02x\n",
-				 isp, machine.mmu->read_memory_8(isp),
-				 msp, machine.mmu->read_memory_8(msp),
-				 usp, machine.mmu->read_memory_8(usp));
+				 isp, mmu->read_memory_8(isp),
+				 msp, mmu->read_memory_8(msp),
+				 usp, mmu->read_memory_8(usp));
 	}
 	sprintf(text_buffer, "\n   ISP          MSP          USP");
 }
+
+void E64::m68k_ic::save_state(FILE *f)
+{
+	fwrite(&clock, sizeof(clock), 1, f);
+	fwrite(&reg, sizeof(reg), 1, f);
+	fwrite(&queue, sizeof(queue), 1, f);
+	fwrite(&fpu, sizeof(fpu), 1, f);
+	fwrite(&ipl, sizeof(ipl), 1, f);
+	fwrite(&fcl, sizeof(fcl), 1, f);
+	fwrite(&fcSource, sizeof(fcSource), 1, f);
+	fwrite(&exception, sizeof(exception), 1, f);
+	fwrite(&cp, sizeof(cp), 1, f);
+	fwrite(&loopModeDelay, sizeof(loopModeDelay), 1, f);
+	fwrite(&readBuffer, sizeof(readBuffer), 1, f);
+	fwrite(&writeBuffer, sizeof(writeBuffer), 1, f);
+	fwrite(&flags, sizeof(flags), 1, f);
+}
+
+void E64::m68k_ic::load_state(FILE *f)
+{
+	fread(&clock, sizeof(clock), 1, f);
+	fread(&reg, sizeof(reg), 1, f);
+	fread(&queue, sizeof(queue), 1, f);
+	fread(&fpu, sizeof(fpu), 1, f);
+	fread(&ipl, sizeof(ipl), 1, f);
+	fread(&fcl, sizeof(fcl), 1, f);
+	fread(&fcSource, sizeof(fcSource), 1, f);
+	fread(&exception, sizeof(exception), 1, f);
+	fread(&cp, sizeof(cp), 1, f);
+	fread(&loopModeDelay, sizeof(loopModeDelay), 1, f);
+	fread(&readBuffer, sizeof(readBuffer), 1, f);
+	fread(&writeBuffer, sizeof(writeBuffer), 1, f);
+	fread(&flags, sizeof(flags), 1, f);
+	
+	/*
+	 * Blocks stay valid, but execution continues elsewhere
+	 */
+	current_block = nullptr;
+	breakpoint_reached = false;
+}
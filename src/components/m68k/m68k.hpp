@@ -8,24 +8,284 @@
 #ifndef M68K_HPP
 #define M68K_HPP
 
+#include <cstdio>
+#include <map>
 #include "Moira.h"
+#include "mmu.hpp"
+#include "m68k_jit.hpp"
+#include "m68k_condition.hpp"
 
 using namespace moira;
 
+/*
+ * Block cache, blocks never cross a code page (see mmu.hpp)
+ */
+#define M68K_BLOCKS			4096
+#define M68K_BLOCK_INSTRUCTIONS		32
+#define M68K_BLOCK_WORDS		((1 << CODE_PAGE_SHIFT) / 2)
+
+/*
+ * Uninterrupted passes through the head of a block, all taking the
+ * same number of cycles, before it's translated
+ */
+#define M68K_JIT_THRESHOLD		8
+
+/*
+ * Kernel routines run natively (see m68k_hle.cpp)
+ */
+#define HLE_ROUTINES			2
+
+/*
+ * Ring buffer of register sets logged by tracepoints
+ */
+#define M68K_TRACE_ENTRIES		256
+
 namespace E64
 {
 
+class blitter_ic;
+
+/*
+ * Moira is built with VIRTUAL_API false, its client api (memory bus and
+ * delegates) is bound at compile time in m68k_api.hpp
+ */
 class m68k_ic : public Moira {
-	u8   read8 (u32 addr) const override;
-	u16  read16(u32 addr) const override;
-	void write8 (u32 addr, u8  val) const override;
-	void write16(u32 addr, u16 val) const override;
-	void breakpointReached(u32 addr) override;
+	friend class moira::Moira;
+	
+	mmu_ic *mmu;
+	
+	/*
+	 * Ram is accessed directly, without a round trip through the mmu
+	 */
+	blitter_ic *blitter;
+	
+	/*
+	 * A coprocessor accesses memory through its own path in the mmu
+	 */
+	bool is_coprocessor;
+	
+	/*
+	 * A basic block, decoded once: the handler of each instruction
+	 * and a copy of the instruction stream up to the end of the code
+	 * page. While a block is current, program space reads inside it
+	 * come from words[] instead of the bus. Valid as long as its
+	 * generation matches the one of its page in the mmu.
+	 */
+	struct block_t {
+		u32 start;
+		u32 size;
+		u32 generation;
+		u16 no_of_instructions;
+		u16 offsets[M68K_BLOCK_INSTRUCTIONS];
+		ExecPtr handlers[M68K_BLOCK_INSTRUCTIONS];
+		u16 words[M68K_BLOCK_WORDS];
+		
+		/*
+		 * The head of the block (jit_instructions long) consists
+		 * of register instructions only, and always takes the
+		 * same number of cycles. Once measured a number of times,
+		 * it's translated to host code.
+		 */
+		u16 jit_instructions;
+		u16 jit_passes;
+		i64 jit_cycles;
+		jit_code_t jit;
+		
+		/*
+		 * A loop of one store to (An)+ and a dbf back to it, runs
+		 * in bulk (see run_loop_idiom())
+		 */
+		bool loop_idiom;
+	};
+	
+	block_t *blocks;
+	block_t *current_block;
+	u16 current_instruction;
+	bool block_cache_enabled;
+	
+	block_t *find_block(u32 pc);
+	
+	m68k_jit_t *jit;
+	bool jit_enabled;
+	i64 pass_start_clock;
+	void profile_block(i64 cycles);
+	void flush_translations();
+	int run_translated_block();
+	int run_loop_idiom(i64 limit);
+	
+	/*
+	 * Same check as at the end of Moira::execute(), for instructions
+	 * run from the block cache
+	 */
+	inline void check_breakpoints()
+	{
+		if (!(flags & CPU_CHECK_BP)) return;
+		if (swTrapResolved) {
+			swTrapResolved = false;
+		} else if (!(flags & CPU_TRACE_EXCEPTION)) {
+			if (debugger.softstopMatches(reg.pc0)) softstopReached(reg.pc0);
+			if (debugger.breakpointMatches(reg.pc0)) breakpointReached(reg.pc0);
+		}
+	}
+	
+	/*
+	 * High level emulation, a routine never runs past hle_limit.
+	 * Only execute_cached() sets it, so the coprocessor leaves all
+	 * routines to the interpreter.
+	 */
+	bool hle_enabled;
+	i64 hle_limit;
+	void host_call(u32 addr);
+	bool run_routine(int routine, bool resume);
+	
+	/*
+	 * Breakpoints in Moira's debugger with a condition, or acting as
+	 * a tracepoint. Breakpoints without an entry here always stop
+	 * the machine.
+	 */
+	struct breakpoint_t {
+		condition_t condition;
+		bool trace;
+	};
+	
+	std::map<u32, breakpoint_t> conditions;
+	void breakpoint_hit(u32 addr);
+	u32 evaluate(const condition_t &condition);
+	
+	/*
+	 * Memory as seen by conditions. The io range reads as zero, a
+	 * condition mustn't change the state of the machine.
+	 */
+	u8 peek8(u32 addr);
 public:
+	m68k_ic(mmu_ic *unit, bool coprocessor = false);
+	~m68k_ic();
+	void connect_blitter(blitter_ic *unit);
+	
+	/*
+	 * Executes one instruction, like execute(). With the block cache
+	 * enabled, handler and instruction stream come from a decoded
+	 * block whenever possible. Only for a cpu that writes through
+	 * the mmu (not the coprocessor).
+	 *
+	 * With the jit enabled as well, it may run the translated head
+	 * of a block instead, but only if the clock stays below limit.
+	 * Loop idioms run in bulk, up to limit. Returns the number of
+	 * instructions executed.
+	 */
+	int execute_cached(i64 limit);
+	
+	void enable_block_cache(bool enable);
+	inline bool block_cache() { return block_cache_enabled; }
+	void flush_blocks();
+	void code_page_written(uint16_t page);
+	
+	/*
+	 * Needs the block cache, returns false if the host has no jit
+	 */
+	bool enable_jit(bool enable);
+	inline bool jit_active() { return jit_enabled && block_cache_enabled; }
+	
+	/*
+	 * Attaches or detaches a 68881 and selects the way it computes,
+	 * host long doubles (fast) or softfloat (exact)
+	 */
+	void enable_fpu(bool enable);
+	void set_fpu_accuracy(FPUAccuracy accuracy);
+	
+	/*
+	 * Registers the software traps of the kernel routines, which
+	 * patch_rom() writes to the rom image shared by both cpu's
+	 */
+	void enable_hle(bool enable);
+	inline bool hle() { return hle_enabled; }
+	static void patch_rom(mmu_ic *mmu, bool enable);
+	
+	/*
+	 * Blocks decoded and translated, times the jit buffer filled up,
+	 * loops run in bulk and routines run natively, the owner may
+	 * reset them
+	 */
+	uint64_t blocks_built;
+	uint64_t blocks_translated;
+	uint64_t jit_flushes;
+	uint64_t loops_run;
+	uint64_t host_calls;
+	
 	void status(char *text_buffer);
 	void stacks(char *text_buffer, int no);
-	i64 old_clock;
+	
+	/*
+	 * If the cpu can't make any progress until an interrupt arrives
+	 * (STOP, halted, or a branch to itself), its clock is advanced to
+	 * the first instruction boundary at or after moment. The kernel's
+	 * prompt, polling an empty cia key queue, is advanced by whole
+	 * iterations up to moment. Returns the number of cycles skipped.
+	 */
+	i64 fast_forward(i64 moment);
+	
+	/*
+	 * Continues execution at addr, with a fresh prefetch queue
+	 */
+	void jump(u32 addr);
+	
+	/*
+	 * Registers, clock and internal state (no debugger settings)
+	 */
+	void save_state(FILE *f);
+	void load_state(FILE *f);
+	
 	bool breakpoint_reached;
+	
+	/*
+	 * Sets a breakpoint at addr, replacing the one already there. If
+	 * condition isn't empty, it only stops when the condition holds.
+	 * A tracepoint never stops, it logs the registers instead.
+	 * Returns false (error holds a message) if the condition doesn't
+	 * compile.
+	 */
+	bool set_breakpoint(u32 addr, const char *condition, bool trace, const char **error);
+	void remove_breakpoint(u32 addr);
+	void remove_all_breakpoints();
+	
+	/*
+	 * Text of the condition at addr, empty if there's none
+	 */
+	const char *breakpoint_condition(u32 addr, bool *trace);
+	
+	struct trace_entry_t {
+		i64 clock;
+		u32 pc;
+		u16 sr;
+		u32 d[8];
+		u32 a[8];
+	};
+	
+	/*
+	 * Entry n of the trace log, 0 being the latest one. Returns
+	 * nullptr if it's not there (anymore).
+	 */
+	const trace_entry_t *trace_entry(int n);
+	inline void clear_trace() { trace_count = 0; }
+	
+	/*
+	 * Copy of the trace log, so the owner can undo the hits of a run
+	 * that's rolled back. log holds M68K_TRACE_ENTRIES entries.
+	 */
+	void save_trace(trace_entry_t *log, uint64_t *count);
+	void restore_trace(const trace_entry_t *log, uint64_t count);
+	
+	/*
+	 * Number of tracepoint hits since the last clear
+	 */
+	uint64_t trace_count;
+	
+	/*
+	 * Interrupts taken per level, the owner may reset them
+	 */
+	uint32_t interrupts[8];
+private:
+	trace_entry_t trace_log[M68K_TRACE_ENTRIES];
 };
 
 }
@@ -0,0 +1,131 @@
+/*
+ * m68k_api.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Client api of Moira. With VIRTUAL_API false these are plain members
+ * of moira::Moira, defined here as inline functions. This file is only
+ * included by Moira.cpp, so the memory bus is inlined right into the
+ * instruction handlers, and by m68k.cpp, m68k_hle.cpp and
+ * m68k_condition.cpp. Every Moira in this program is an m68k_ic.
+ */
+
+#ifndef M68K_API_HPP
+#define M68K_API_HPP
+
+#include "m68k.hpp"
+#include "blitter.hpp"
+
+#define M68K_IC	static_cast<const E64::m68k_ic *>(this)
+
+namespace moira
+{
+
+/*
+ * For both cpu's, reads from $060000 and up and writes to $020000 and up
+ * always end in ram, and $020000-$02ffff reads the kernel rom (see
+ * mmu.hpp). The rest goes through the mmu.
+ */
+inline u8 Moira::read8(u32 addr) const
+{
+	if ((addr & 0xffffff) >= 0x060000) return M68K_IC->blitter->video_memory_read_8(addr & 0xffffff);
+	if ((addr & 0xff0000) == 0x020000) return M68K_IC->mmu->current_rom_image[addr & 0xffff];
+	return M68K_IC->is_coprocessor ?
+		M68K_IC->mmu->coprocessor_read_memory_8(addr) :
+		M68K_IC->mmu->read_memory_8(addr);
+}
+
+inline u16 Moira::read16(u32 addr) const
+{
+	return (read8(addr) << 8) | read8(addr + 1);
+}
+
+inline u16 Moira::read16OnReset(u32 addr) const { return read16(addr); }
+inline u16 Moira::read16Dasm(u32 addr) const { return read16(addr); }
+
+/*
+ * Opcodes and extension words inside the current block (if any) come
+ * from its decoded copy
+ */
+inline u16 Moira::read16Prog(u32 addr) const
+{
+	const E64::m68k_ic::block_t *block = M68K_IC->current_block;
+	if (block && ((addr - block->start) < block->size) && !(addr & 1)) {
+		return block->words[(addr - block->start) >> 1];
+	}
+	return read16(addr);
+}
+
+inline void Moira::write8(u32 addr, u8 val) const
+{
+	if ((addr & 0xffffff) >= 0x020000) {
+		if (M68K_IC->is_coprocessor) {
+			M68K_IC->blitter->video_memory_write_8_coprocessor(addr & 0xffffff, val);
+		} else {
+			M68K_IC->mmu->track_write(addr);
+			M68K_IC->blitter->video_memory_write_8(addr & 0xffffff, val);
+		}
+	} else if (M68K_IC->is_coprocessor) {
+		M68K_IC->mmu->coprocessor_write_memory_8(addr, val);
+	} else {
+		M68K_IC->mmu->write_memory_8(addr, val);
+	}
+}
+
+inline void Moira::write16(u32 addr, u16 val) const
+{
+	write8(addr, (val & 0xff00) >> 8);
+	write8(addr + 1, val & 0x00ff);
+}
+
+inline void Moira::sync(int cycles) { clock += cycles; }
+
+inline u16 Moira::readIrqUserVector(u8 level) const { return 0; }
+
+inline void Moira::didReset() { }
+inline void Moira::didHalt() { }
+
+inline void Moira::willExecute(const char *func, Instr I, Mode M, Size S, u16 opcode) { }
+inline void Moira::didExecute(const char *func, Instr I, Mode M, Size S, u16 opcode) { }
+
+inline void Moira::willExecute(ExceptionType exc, u16 vector) { }
+inline void Moira::didExecute(ExceptionType exc, u16 vector) { }
+
+inline void Moira::willInterrupt(u8 level)
+{
+	static_cast<E64::m68k_ic *>(this)->interrupts[level & 0b111]++;
+}
+
+inline void Moira::didJumpToVector(int nr, u32 addr) { }
+
+inline void Moira::didChangeCACR(u32 value) { }
+inline void Moira::didChangeCAAR(u32 value) { }
+
+inline void Moira::softstopReached(u32 addr) { }
+
+inline void Moira::breakpointReached(u32 addr)
+{
+	static_cast<E64::m68k_ic *>(this)->breakpoint_hit(addr);
+}
+
+/*
+ * A watchpoint stops the machine like a breakpoint, after the
+ * instruction that accessed it
+ */
+inline void Moira::watchpointReached(u32 addr)
+{
+	static_cast<E64::m68k_ic *>(this)->breakpoint_reached = true;
+}
+
+inline void Moira::catchpointReached(u8 vector) { }
+inline void Moira::softwareTrapReached(u32 addr)
+{
+	static_cast<E64::m68k_ic *>(this)->host_call(addr);
+}
+
+}
+
+#undef M68K_IC
+
+#endif
@@ -0,0 +1,383 @@
+/*
+ * m68k_condition.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Compiles conditions of breakpoints and tracepoints with a recursive
+ * descent parser, which emits the bytecode in postfix order. The cpu
+ * evaluates it on a small stack.
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "m68k.hpp"
+#include "m68k_api.hpp"
+
+/*
+ * Binary operators per level, from loosest to tightest binding. Longer
+ * tokens come first, single & and | never match && and ||.
+ */
+#define CONDITION_LEVELS	8
+
+static const struct {
+	const char *token;
+	E64::condition_op_t op;
+} binary_operators[CONDITION_LEVELS][4] = {
+	{ { "||", E64::COND_LOGICAL_OR } },
+	{ { "&&", E64::COND_LOGICAL_AND } },
+	{ { "==", E64::COND_EQ }, { "!=", E64::COND_NE } },
+	{ { "<=", E64::COND_LE }, { ">=", E64::COND_GE }, { "<", E64::COND_LT }, { ">", E64::COND_GT } },
+	{ { "|", E64::COND_OR } },
+	{ { "^", E64::COND_XOR } },
+	{ { "&", E64::COND_AND } },
+	{ { "+", E64::COND_ADD }, { "-", E64::COND_SUB } }
+};
+
+bool E64::condition_t::push(condition_op_t op, uint32_t value)
+{
+	if (depth == CONDITION_STACK_SIZE) {
+		message = "expression too complex";
+		return false;
+	}
+	code.push_back({ op, value });
+	depth++;
+	return true;
+}
+
+/*
+ * Operator taking n values from the stack, leaving one
+ */
+bool E64::condition_t::pop(int n, condition_op_t op)
+{
+	depth -= n;
+	return push(op);
+}
+
+void E64::condition_t::skip_spaces()
+{
+	while (isspace(*next)) next++;
+}
+
+bool E64::condition_t::match(const char *token)
+{
+	skip_spaces();
+	size_t length = strlen(token);
+	if (strncmp(next, token, length) != 0) return false;
+	if ((length == 1) && ((token[0] == '&') || (token[0] == '|')) && (next[1] == token[0])) return false;
+	next += length;
+	return true;
+}
+
+bool E64::condition_t::parse_size(uint32_t *mask)
+{
+	*mask = 0xffffffff;
+	if (next[0] != '.') return true;
+	switch (tolower(next[1])) {
+		case 'b': *mask = 0x000000ff; break;
+		case 'w': *mask = 0x0000ffff; break;
+		case 'l': *mask = 0xffffffff; break;
+		default:
+			message = "unknown size";
+			return false;
+	}
+	next += 2;
+	return true;
+}
+
+bool E64::condition_t::parse_primary()
+{
+	skip_spaces();
+	
+	if (match("(")) {
+		if (!parse_binary(0)) return false;
+		if (!match(")")) {
+			message = "missing )";
+			return false;
+		}
+		return true;
+	}
+	
+	if (match("[")) {
+		uint32_t mask;
+		if (!parse_binary(0)) return false;
+		if (!match("]")) {
+			message = "missing ]";
+			return false;
+		}
+		if (!parse_size(&mask)) return false;
+		return pop(1, (mask == 0xff) ? COND_READ_8 : (mask == 0xffff) ? COND_READ_16 : COND_READ_32);
+	}
+	
+	if ((next[0] == '$') || ((next[0] == '0') && (tolower(next[1]) == 'x')) || isdigit(next[0])) {
+		int base = 10;
+		if (next[0] == '$') {
+			next++;
+			base = 16;
+		} else if (tolower(next[1]) == 'x') {
+			next += 2;
+			base = 16;
+		}
+		if (!isxdigit(next[0])) {
+			message = "invalid number";
+			return false;
+		}
+		char *end;
+		uint32_t value = strtoul(next, &end, base);
+		next = end;
+		return push(COND_CONST, value);
+	}
+	
+	char name[3] = { (char)tolower(next[0]), next[0] ? (char)tolower(next[1]) : '\0', '\0' };
+	if (isalnum(next[0]) && isalnum(next[1]) && !isalnum(next[2])) {
+		condition_op_t op;
+		uint32_t number = 0;
+		if (((name[0] == 'd') || (name[0] == 'a')) && (name[1] >= '0') && (name[1] <= '7')) {
+			op = (name[0] == 'd') ? COND_D : COND_A;
+			number = name[1] - '0';
+		} else if (strcmp(name, "sp") == 0) {
+			op = COND_A;
+			number = 7;
+		} else if (strcmp(name, "pc") == 0) {
+			op = COND_PC;
+		} else if (strcmp(name, "sr") == 0) {
+			op = COND_SR;
+		} else {
+			message = "unknown register";
+			return false;
+		}
+		next += 2;
+		if (!push(op, number)) return false;
+		
+		uint32_t mask;
+		if (!parse_size(&mask)) return false;
+		if (mask != 0xffffffff) {
+			if (!pop(1, COND_MASK)) return false;
+			code.back().value = mask;
+		}
+		return true;
+	}
+	
+	message = *next ? "syntax error" : "unexpected end";
+	return false;
+}
+
+bool E64::condition_t::parse_unary()
+{
+	if (match("-")) {
+		return parse_unary() && pop(1, COND_NEG);
+	} else if (match("!")) {
+		return parse_unary() && pop(1, COND_NOT);
+	} else if (match("~")) {
+		return parse_unary() && pop(1, COND_COMPLEMENT);
+	}
+	return parse_primary();
+}
+
+bool E64::condition_t::parse_binary(int level)
+{
+	if (level == CONDITION_LEVELS) return parse_unary();
+	
+	if (!parse_binary(level + 1)) return false;
+	
+	for (;;) {
+		int i = 0;
+		while ((i < 4) && binary_operators[level][i].token && !match(binary_operators[level][i].token)) i++;
+		if ((i == 4) || !binary_operators[level][i].token) return true;
+		
+		if (!parse_binary(level + 1)) return false;
+		if (!pop(2, binary_operators[level][i].op)) return false;
+	}
+}
+
+bool E64::condition_t::compile(const char *source, const char **error)
+{
+	code.clear();
+	depth = 0;
+	message = nullptr;
+	next = source ? source : "";
+	snprintf(text, CONDITION_TEXT_SIZE, "%s", next);
+	
+	skip_spaces();
+	if (*next == '\0') return true;
+	
+	if (parse_binary(0)) {
+		skip_spaces();
+		if (*next == '\0') return true;
+		message = "syntax error";
+	}
+	
+	code.clear();
+	*error = message;
+	return false;
+}
+
+bool E64::m68k_ic::set_breakpoint(u32 addr, const char *condition, bool trace, const char **error)
+{
+	breakpoint_t breakpoint;
+	if (!breakpoint.condition.compile(condition, error)) return false;
+	breakpoint.trace = trace;
+	
+	if (breakpoint.condition.empty() && !trace) {
+		conditions.erase(addr);
+	} else {
+		conditions[addr] = breakpoint;
+	}
+	debugger.breakpoints.setAt(addr);
+	return true;
+}
+
+void E64::m68k_ic::remove_breakpoint(u32 addr)
+{
+	conditions.erase(addr);
+	debugger.breakpoints.removeAt(addr);
+}
+
+void E64::m68k_ic::remove_all_breakpoints()
+{
+	conditions.clear();
+	debugger.breakpoints.removeAll();
+}
+
+const char *E64::m68k_ic::breakpoint_condition(u32 addr, bool *trace)
+{
+	auto it = conditions.find(addr);
+	if (it == conditions.end()) {
+		*trace = false;
+		return "";
+	}
+	*trace = it->second.trace;
+	return it->second.condition.text;
+}
+
+/*
+ * Called at each breakpoint that's reached, before the instruction at
+ * addr runs. Unconditional breakpoints stop the machine right away.
+ */
+void E64::m68k_ic::breakpoint_hit(u32 addr)
+{
+	auto it = conditions.find(addr);
+	if (it == conditions.end()) {
+		breakpoint_reached = true;
+		return;
+	}
+	
+	const breakpoint_t &breakpoint = it->second;
+	if (!breakpoint.condition.empty() && !evaluate(breakpoint.condition)) return;
+	
+	if (breakpoint.trace) {
+		trace_entry_t *entry = &trace_log[trace_count % M68K_TRACE_ENTRIES];
+		entry->clock = clock;
+		entry->pc = addr;
+		entry->sr = getSR();
+		for (int i = 0; i < 8; i++) {
+			entry->d[i] = getD(i);
+			entry->a[i] = getA(i);
+		}
+		trace_count++;
+	} else {
+		breakpoint_reached = true;
+	}
+}
+
+const E64::m68k_ic::trace_entry_t *E64::m68k_ic::trace_entry(int n)
+{
+	if ((n < 0) || ((uint64_t)n >= trace_count) || (n >= M68K_TRACE_ENTRIES)) return nullptr;
+	return &trace_log[(trace_count - 1 - n) % M68K_TRACE_ENTRIES];
+}
+
+void E64::m68k_ic::save_trace(trace_entry_t *log, uint64_t *count)
+{
+	memcpy(log, trace_log, sizeof(trace_log));
+	*count = trace_count;
+}
+
+void E64::m68k_ic::restore_trace(const trace_entry_t *log, uint64_t count)
+{
+	memcpy(trace_log, log, sizeof(trace_log));
+	trace_count = count;
+}
+
+u8 E64::m68k_ic::peek8(u32 addr)
+{
+	addr &= 0xffffff;
+	if ((addr >= 0x000800) && (addr < 0x001000)) return 0;
+	return read8(addr);
+}
+
+u32 E64::m68k_ic::evaluate(const condition_t &condition)
+{
+	u32 stack[CONDITION_STACK_SIZE];
+	int sp = 0;
+	
+	for (const condition_instruction_t &i : condition.code) {
+		switch (i.op) {
+			case COND_CONST:
+				stack[sp++] = i.value;
+				break;
+			case COND_D:
+				stack[sp++] = getD(i.value);
+				break;
+			case COND_A:
+				stack[sp++] = getA(i.value);
+				break;
+			case COND_PC:
+				stack[sp++] = reg.pc0;
+				break;
+			case COND_SR:
+				stack[sp++] = getSR();
+				break;
+			case COND_READ_8:
+				stack[sp - 1] = peek8(stack[sp - 1]);
+				break;
+			case COND_READ_16:
+				stack[sp - 1] = (peek8(stack[sp - 1]) << 8) | peek8(stack[sp - 1] + 1);
+				break;
+			case COND_READ_32:
+				stack[sp - 1] = (peek8(stack[sp - 1]) << 24) | (peek8(stack[sp - 1] + 1) << 16) |
+					(peek8(stack[sp - 1] + 2) << 8) | peek8(stack[sp - 1] + 3);
+				break;
+			case COND_MASK:
+				stack[sp - 1] &= i.value;
+				break;
+			case COND_NEG:
+				stack[sp - 1] = -stack[sp - 1];
+				break;
+			case COND_NOT:
+				stack[sp - 1] = !stack[sp - 1];
+				break;
+			case COND_COMPLEMENT:
+				stack[sp - 1] = ~stack[sp - 1];
+				break;
+			default:
+				/*
+				 * Binary operators
+				 */
+				sp--;
+				u32 a = stack[sp - 1];
+				u32 b = stack[sp];
+				switch (i.op) {
+					case COND_ADD:		a = a + b; break;
+					case COND_SUB:		a = a - b; break;
+					case COND_AND:		a = a & b; break;
+					case COND_XOR:		a = a ^ b; break;
+					case COND_OR:		a = a | b; break;
+					case COND_LT:		a = a < b; break;
+					case COND_LE:		a = a <= b; break;
+					case COND_GT:		a = a > b; break;
+					case COND_GE:		a = a >= b; break;
+					case COND_EQ:		a = a == b; break;
+					case COND_NE:		a = a != b; break;
+					case COND_LOGICAL_AND:	a = a && b; break;
+					case COND_LOGICAL_OR:	a = a || b; break;
+					default:		break;
+				}
+				stack[sp - 1] = a;
+				break;
+		}
+	}
+	
+	return sp ? stack[sp - 1] : 1;
+}
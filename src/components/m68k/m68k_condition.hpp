@@ -0,0 +1,97 @@
+/*
+ * m68k_condition.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Conditions of breakpoints and tracepoints, e.g.
+ *
+ *	d0 == $10 && [a0].w > 5
+ *
+ * Registers d0-d7, a0-a7, sp, pc and sr, memory as [address] with an
+ * optional size (.b, .w or .l, default .l, also on data and address
+ * registers), numbers in hex ($ or 0x) or decimal. Operators, from
+ * tightest to loosest binding: unary - ! ~, then + -, &, ^, |,
+ * < <= > >=, == != and finally && and ||. Unlike in C, bitwise
+ * operators bind tighter than comparisons. All values are unsigned
+ * 32 bit. A condition is compiled once to a small stack based
+ * bytecode, evaluated by the cpu at each hit (see
+ * m68k_ic::breakpoint_hit()).
+ */
+
+#ifndef M68K_CONDITION_HPP
+#define M68K_CONDITION_HPP
+
+#include <cstdint>
+#include <vector>
+
+#define CONDITION_STACK_SIZE	16
+#define CONDITION_TEXT_SIZE	64
+
+namespace E64
+{
+
+enum condition_op_t : uint8_t {
+	COND_CONST,
+	COND_D,
+	COND_A,
+	COND_PC,
+	COND_SR,
+	COND_READ_8,
+	COND_READ_16,
+	COND_READ_32,
+	COND_MASK,
+	COND_NEG,
+	COND_NOT,
+	COND_COMPLEMENT,
+	COND_ADD,
+	COND_SUB,
+	COND_AND,
+	COND_XOR,
+	COND_OR,
+	COND_LT,
+	COND_LE,
+	COND_GT,
+	COND_GE,
+	COND_EQ,
+	COND_NE,
+	COND_LOGICAL_AND,
+	COND_LOGICAL_OR
+};
+
+struct condition_instruction_t {
+	condition_op_t op;
+	uint32_t value;
+};
+
+class condition_t {
+private:
+	const char *next;
+	const char *message;
+	int depth;
+	bool push(condition_op_t op, uint32_t value = 0);
+	bool pop(int n, condition_op_t op);
+	void skip_spaces();
+	bool match(const char *token);
+	bool parse_size(uint32_t *mask);
+	bool parse_primary();
+	bool parse_unary();
+	bool parse_binary(int level);
+public:
+	/*
+	 * Empty for an unconditional breakpoint or tracepoint
+	 */
+	std::vector<condition_instruction_t> code;
+	char text[CONDITION_TEXT_SIZE];
+
+	/*
+	 * Returns false if the text doesn't compile, error then holds
+	 * a message
+	 */
+	bool compile(const char *source, const char **error);
+	inline bool empty() const { return code.empty(); }
+};
+
+}
+
+#endif
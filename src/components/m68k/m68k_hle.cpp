@@ -0,0 +1,226 @@
+/*
+ * m68k_hle.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * High level emulation of kernel routines. The first opcode of each
+ * routine in the rom image is replaced by a software trap (a reserved
+ * line a opcode). Moira restores the original opcode when it executes
+ * the trap and calls softwareTrapReached(), which ends up here. A
+ * routine either runs natively, or is left to the interpreter.
+ */
+
+#include "m68k.hpp"
+#include "m68k_api.hpp"
+
+/*
+ * Both routines take their arguments from the stack (C calling
+ * convention) and copy or fill bytes in a loop counted with subq.w,
+ * so a count with a zero low word runs 65536 times. Next to the entry,
+ * the head of the loop gets a trap, there the routine continues from
+ * the registers. Cycles as taken by the interpreter: without any
+ * passes, from entry to the first pass of the loop, per pass, and from
+ * the last pass up to and including the rts.
+ */
+#define HLE_ROUTINE_WORDS	11
+
+struct hle_routine_t {
+	u32 address;
+	u32 loop;
+	u16 key;
+	u16 loop_key;
+	bool fill;
+	int empty_cycles;
+	int entry_cycles;
+	int loop_cycles;
+	int exit_cycles;
+	u16 words[HLE_ROUTINE_WORDS];
+};
+
+static const hle_routine_t hle_routines[HLE_ROUTINES] = {
+	{	// memcpy(void *dst, const void *src, uint32_t n)
+		0x0203cc, 0x0203da, 0xae64, 0xae65, false, 37, 25, 16, 8,
+		{ 0x226f, 0x0004, 0x206f, 0x0008, 0x202f, 0x000c, 0x6706, 0x12d8, 0x5340, 0x66fa, 0x4e75 }
+	},
+	{	// memset(void *dst, uint8_t value, uint32_t n)
+		0x0203e2, 0x0203f0, 0xae66, 0xae67, true, 37, 25, 12, 8,
+		{ 0x206f, 0x0004, 0x102f, 0x0008, 0x222f, 0x000a, 0x6706, 0x10c0, 0x5341, 0x66fa, 0x4e75 }
+	}
+};
+
+/*
+ * Io writes and reads may have side effects that depend on the clock,
+ * these ranges are left to the interpreter
+ */
+static inline bool plain_memory(u32 address, u32 size)
+{
+	return	(address < 0x1000000) && (address + size <= 0x1000000) &&
+		((address + size <= 0x000800) || (address >= 0x001000));
+}
+
+void E64::m68k_ic::patch_rom(mmu_ic *mmu, bool enable)
+{
+	for (int i = 0; i < HLE_ROUTINES; i++) {
+		const hle_routine_t *r = &hle_routines[i];
+		u8 *code = &mmu->current_rom_image[r->address & 0xffff];
+		int loop = (r->loop - r->address) / 2;
+		
+		/*
+		 * Only patch the routines of the built-in rom
+		 */
+		bool match = true;
+		for (int j = 1; j < HLE_ROUTINE_WORDS; j++) {
+			u16 word = (code[2 * j] << 8) | code[(2 * j) + 1];
+			if ((word != r->words[j]) && ((j != loop) || (word != r->loop_key))) match = false;
+		}
+		if (!match) continue;
+		
+		u16 entry = enable ? r->key : r->words[0];
+		u16 head = enable ? r->loop_key : r->words[loop];
+		code[0] = entry >> 8;
+		code[1] = entry & 0xff;
+		code[2 * loop] = head >> 8;
+		code[(2 * loop) + 1] = head & 0xff;
+	}
+}
+
+void E64::m68k_ic::enable_hle(bool enable)
+{
+	if (enable) {
+		for (int i = 0; i < HLE_ROUTINES; i++) {
+			const hle_routine_t *r = &hle_routines[i];
+			if (!debugger.swTraps.traps.contains(r->key)) {
+				debugger.swTraps.create(r->key, r->words[0]);
+				debugger.swTraps.create(r->loop_key, r->words[(r->loop - r->address) / 2]);
+			}
+		}
+	}
+	hle_enabled = enable;
+	flush_blocks();
+}
+
+void E64::m68k_ic::host_call(u32 addr)
+{
+	/*
+	 * Tracing and pending interrupts are checked per instruction, and
+	 * so are the ipl lines. Leave those to the interpreter, as well
+	 * as routines with breakpoints or watchpoints on their pages (see
+	 * run_routine()).
+	 */
+	if (!hle_enabled || (flags & ~(CPU_CHECK_BP | CPU_CHECK_WP)) || (ipl != reg.ipl)) return;
+	
+	for (int i = 0; i < HLE_ROUTINES; i++) {
+		if ((hle_routines[i].address == addr) || (hle_routines[i].loop == addr)) {
+			if (run_routine(i, hle_routines[i].loop == addr)) host_calls++;
+			return;
+		}
+	}
+}
+
+bool E64::m68k_ic::run_routine(int routine, bool resume)
+{
+	const hle_routine_t *r = &hle_routines[routine];
+	bool fill = r->fill;
+	
+	u32 sp = readA(7);
+	if ((sp & 1) || !plain_memory(sp, 16)) return false;
+	
+	u32 return_address = (read16(sp) << 16) | read16(sp + 2);
+	if (return_address & 1) return false;
+	
+	u32 dst, src, counter;
+	u8 value;
+	i64 overhead;
+	
+	if (resume) {
+		dst = fill ? readA(0) : readA(1);
+		src = fill ? 0 : readA(0);
+		value = readD(0) & 0xff;
+		counter = fill ? readD(1) : readD(0);
+		overhead = 0;
+	} else {
+		dst = (read16(sp + 4) << 16) | read16(sp + 6);
+		src = fill ? 0 : (read16(sp + 8) << 16) | read16(sp + 10);
+		value = fill ? read8(sp + 8) : 0;
+		counter = fill ? (read16(sp + 10) << 16) | read16(sp + 12) :
+			(read16(sp + 12) << 16) | read16(sp + 14);
+		overhead = r->entry_cycles;
+	}
+	
+	u32 count = (counter & 0xffff) ? (counter & 0xffff) : 0x10000;
+	if (!resume && (counter == 0)) count = 0;
+	
+	if (!plain_memory(dst, count) || (!fill && !plain_memory(src, count))) return false;
+	
+	if ((flags & CPU_CHECK_BP) && debugger.breakpoints.onPages(r->address, 2 * HLE_ROUTINE_WORDS)) return false;
+	if ((flags & CPU_CHECK_WP) && (debugger.watchpoints.onPages(sp, 16) ||
+				       debugger.watchpoints.onPages(dst, count) ||
+				       (!fill && debugger.watchpoints.onPages(src, count)))) return false;
+	
+	/*
+	 * Never run past the next event, the machine then sees exactly
+	 * the same state at the same clock as with the interpreter.
+	 * Otherwise, run as many passes as fit and hand the rest of the
+	 * loop to the interpreter.
+	 */
+	i64 budget = hle_limit - clock;
+	i64 cycles = count ?
+		overhead + (i64)count * r->loop_cycles + r->exit_cycles :
+		r->empty_cycles;
+	
+	u32 passes = count;
+	bool complete = (cycles <= budget);
+	if (!complete) {
+		i64 fit = (budget - overhead) / r->loop_cycles;
+		if (fit <= 0) return false;
+		passes = (fit < count) ? fit : count - 1;
+		if (passes == 0) return false;
+		cycles = overhead + (i64)passes * r->loop_cycles;
+	}
+	
+	for (u32 i = 0; i < passes; i++) {
+		write8(dst + i, fill ? value : read8(src + i));
+	}
+	
+	counter = (counter & 0xffff0000) | ((counter - passes) & 0xffff);
+	if (fill) {
+		writeD(0, (readD(0) & 0xffffff00) | value);
+		writeD(1, counter);
+		writeA(0, dst + passes);
+	} else {
+		writeD(0, counter);
+		writeA(1, dst + passes);
+		writeA(0, src + passes);
+	}
+	
+	u32 target;
+	if (complete) {
+		/*
+		 * Flags of the last subq.w or, without passes, of the
+		 * move.l of the count
+		 */
+		reg.sr.n = reg.sr.v = reg.sr.c = false;
+		reg.sr.z = true;
+		if (count) reg.sr.x = false;
+		
+		writeA(7, sp + 4);
+		target = return_address;
+	} else {
+		u16 before = (counter + 1) & 0xffff;
+		reg.sr.n = counter & 0x8000;
+		reg.sr.z = false;
+		reg.sr.v = (before == 0x8000);
+		reg.sr.c = reg.sr.x = (before == 0);
+		
+		target = r->loop;
+	}
+	
+	clock += cycles;
+	
+	reg.pc = reg.pc0 = target;
+	queue.ird = read16(target);
+	queue.irc = read16(target + 2);
+	
+	return true;
+}
@@ -0,0 +1,366 @@
+/*
+ * m68k_jit.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include <cstdio>
+#include "m68k_jit.hpp"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#define JIT_HOST
+#endif
+
+/*
+ * Translated forms, all on 32 bit operands
+ */
+enum jit_op_t {
+	JIT_NONE,
+	JIT_MOVEQ,
+	JIT_MOVE,		// move.l  Dm/Am, Dn
+	JIT_MOVEA,		// movea.l Dm/Am, An
+	JIT_ADD,		// add.l   Dm/Am, Dn
+	JIT_SUB,		// sub.l   Dm/Am, Dn
+	JIT_CMP,		// cmp.l   Dm/Am, Dn
+	JIT_ADDA,		// adda.l  Dm/Am, An
+	JIT_SUBA,		// suba.l  Dm/Am, An
+	JIT_AND,		// and.l   Dm, Dn
+	JIT_OR,			// or.l    Dm, Dn
+	JIT_EOR,		// eor.l   Dn, Dm
+	JIT_ADDQ,		// addq.l  #q, Dn
+	JIT_SUBQ,		// subq.l  #q, Dn
+	JIT_ADDQA,		// addq.l  #q, An
+	JIT_SUBQA,		// subq.l  #q, An
+	JIT_TST,		// tst.l   Dn
+	JIT_CLR,		// clr.l   Dn
+	JIT_NOT,		// not.l   Dn
+	JIT_NEG,		// neg.l   Dn
+	JIT_SWAP,		// swap    Dn
+	JIT_EXT,		// ext.l   Dn
+	JIT_LSL,		// lsl.l   #c, Dn
+	JIT_LSR,		// lsr.l   #c, Dn
+	JIT_ASR			// asr.l   #c, Dn
+};
+
+static enum jit_op_t decode(uint16_t opcode)
+{
+	if ((opcode & 0xf100) == 0x7000) return JIT_MOVEQ;
+
+	switch (opcode & 0xf1f0) {
+		case 0x2000: return JIT_MOVE;
+		case 0x2040: return JIT_MOVEA;
+		case 0xd080: return JIT_ADD;
+		case 0x9080: return JIT_SUB;
+		case 0xb080: return JIT_CMP;
+		case 0xd1c0: return JIT_ADDA;
+		case 0x91c0: return JIT_SUBA;
+	}
+
+	switch (opcode & 0xf1f8) {
+		case 0xc080: return JIT_AND;
+		case 0x8080: return JIT_OR;
+		case 0xb180: return JIT_EOR;
+		case 0x5080: return JIT_ADDQ;
+		case 0x5180: return JIT_SUBQ;
+		case 0x5088: return JIT_ADDQA;
+		case 0x5188: return JIT_SUBQA;
+		case 0xe188: return JIT_LSL;
+		case 0xe088: return JIT_LSR;
+		case 0xe080: return JIT_ASR;
+	}
+
+	switch (opcode & 0xfff8) {
+		case 0x4a80: return JIT_TST;
+		case 0x4280: return JIT_CLR;
+		case 0x4680: return JIT_NOT;
+		case 0x4480: return JIT_NEG;
+		case 0x4840: return JIT_SWAP;
+		case 0x48c0: return JIT_EXT;
+	}
+
+	return JIT_NONE;
+}
+
+/*
+ * x86-64 encodings used below, rdi holds the registers
+ */
+#define MODRM_EAX_RDI	0x87	// [rdi + disp32], eax
+#define MODRM_ECX_RDI	0x8f	// [rdi + disp32], ecx
+
+#define SETO	0x90
+#define SETC	0x92
+#define SETZ	0x94
+#define SETS	0x98
+
+E64::m68k_jit_t::m68k_jit_t(jit_layout_t registers)
+{
+	layout = registers;
+	buffer = nullptr;
+	used = 0;
+	p = nullptr;
+
+#ifdef JIT_HOST
+	void *memory = mmap(nullptr, M68K_JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		printf("[JIT] Error: can't allocate executable memory\n");
+	} else {
+		buffer = (uint8_t *)memory;
+	}
+#else
+	printf("[JIT] Not available on this host\n");
+#endif
+}
+
+E64::m68k_jit_t::~m68k_jit_t()
+{
+#ifdef JIT_HOST
+	if (buffer) munmap(buffer, M68K_JIT_BUFFER_SIZE);
+#endif
+}
+
+bool E64::m68k_jit_t::supported(uint16_t opcode)
+{
+	return decode(opcode) != JIT_NONE;
+}
+
+void E64::m68k_jit_t::flush()
+{
+	used = 0;
+}
+
+void E64::m68k_jit_t::emit_8(uint8_t byte)
+{
+	*p++ = byte;
+}
+
+void E64::m68k_jit_t::emit_32(uint32_t word)
+{
+	emit_8(word & 0xff);
+	emit_8((word >> 8) & 0xff);
+	emit_8((word >> 16) & 0xff);
+	emit_8(word >> 24);
+}
+
+void E64::m68k_jit_t::emit_disp(uint8_t opcode, uint8_t modrm, uint32_t offset)
+{
+	emit_8(opcode);
+	emit_8(modrm);
+	emit_32(offset);
+}
+
+/*
+ * mov eax/ecx, [rdi + r[r]]
+ */
+void E64::m68k_jit_t::load(uint8_t modrm, int r)
+{
+	emit_disp(0x8b, modrm, layout.r + 4 * r);
+}
+
+/*
+ * mov [rdi + r[r]], eax
+ */
+void E64::m68k_jit_t::store(int r)
+{
+	emit_disp(0x89, MODRM_EAX_RDI, layout.r + 4 * r);
+}
+
+/*
+ * setcc byte [rdi + flag]
+ */
+void E64::m68k_jit_t::set_flag(uint8_t condition, uint32_t flag)
+{
+	emit_8(0x0f);
+	emit_disp(condition, MODRM_EAX_RDI, flag);
+}
+
+/*
+ * mov byte [rdi + flag], value
+ */
+void E64::m68k_jit_t::clear_flag(uint32_t flag, bool value)
+{
+	emit_disp(0xc6, MODRM_EAX_RDI, flag);
+	emit_8(value ? 1 : 0);
+}
+
+/*
+ * N and Z from eax, V and C cleared, X unchanged
+ */
+void E64::m68k_jit_t::logic_flags()
+{
+	emit_8(0x85); emit_8(0xc0);		// test eax, eax
+	set_flag(SETS, layout.n);
+	set_flag(SETZ, layout.z);
+	clear_flag(layout.v);
+	clear_flag(layout.c);
+}
+
+/*
+ * All flags from the last x86 add, sub, cmp or neg. The x86 carry
+ * after a subtraction is a borrow, like on the 68k.
+ */
+void E64::m68k_jit_t::arithmetic_flags(bool extend)
+{
+	set_flag(SETS, layout.n);
+	set_flag(SETZ, layout.z);
+	set_flag(SETO, layout.v);
+	set_flag(SETC, layout.c);
+	if (extend) set_flag(SETC, layout.x);
+}
+
+bool E64::m68k_jit_t::emit(uint16_t opcode)
+{
+	int dn = (opcode >> 9) & 0b111;		// register in bits 11-9
+	int ea = opcode & 0b1111;		// Dm (0-7) or Am (8-15)
+	int rn = opcode & 0b111;		// register in bits 2-0
+	uint8_t quick = ((opcode >> 9) & 0b111) ? ((opcode >> 9) & 0b111) : 8;
+
+	switch (decode(opcode)) {
+		case JIT_MOVEQ:
+			{
+				int32_t value = (int8_t)(opcode & 0xff);
+				emit_disp(0xc7, MODRM_EAX_RDI, layout.r + 4 * dn);
+				emit_32((uint32_t)value);
+				clear_flag(layout.n, value < 0);
+				clear_flag(layout.z, value == 0);
+				clear_flag(layout.v);
+				clear_flag(layout.c);
+			}
+			break;
+		case JIT_MOVE:
+			load(MODRM_EAX_RDI, ea);
+			store(dn);
+			logic_flags();
+			break;
+		case JIT_MOVEA:
+			load(MODRM_EAX_RDI, ea);
+			store(8 + dn);
+			break;
+		case JIT_ADD:
+		case JIT_SUB:
+			load(MODRM_EAX_RDI, dn);
+			load(MODRM_ECX_RDI, ea);
+			emit_8(decode(opcode) == JIT_ADD ? 0x01 : 0x29); emit_8(0xc8);	// add/sub eax, ecx
+			store(dn);
+			arithmetic_flags(true);
+			break;
+		case JIT_CMP:
+			load(MODRM_EAX_RDI, dn);
+			load(MODRM_ECX_RDI, ea);
+			emit_8(0x39); emit_8(0xc8);		// cmp eax, ecx
+			arithmetic_flags(false);
+			break;
+		case JIT_ADDA:
+		case JIT_SUBA:
+			load(MODRM_EAX_RDI, 8 + dn);
+			load(MODRM_ECX_RDI, ea);
+			emit_8(decode(opcode) == JIT_ADDA ? 0x01 : 0x29); emit_8(0xc8);
+			store(8 + dn);
+			break;
+		case JIT_AND:
+		case JIT_OR:
+			load(MODRM_EAX_RDI, dn);
+			load(MODRM_ECX_RDI, rn);
+			emit_8(decode(opcode) == JIT_AND ? 0x21 : 0x09); emit_8(0xc8);
+			store(dn);
+			logic_flags();
+			break;
+		case JIT_EOR:
+			load(MODRM_EAX_RDI, rn);
+			load(MODRM_ECX_RDI, dn);
+			emit_8(0x31); emit_8(0xc8);		// xor eax, ecx
+			store(rn);
+			logic_flags();
+			break;
+		case JIT_ADDQ:
+		case JIT_SUBQ:
+			load(MODRM_EAX_RDI, rn);
+			emit_8(0x83); emit_8(decode(opcode) == JIT_ADDQ ? 0xc0 : 0xe8); emit_8(quick);
+			store(rn);
+			arithmetic_flags(true);
+			break;
+		case JIT_ADDQA:
+		case JIT_SUBQA:
+			load(MODRM_EAX_RDI, 8 + rn);
+			emit_8(0x83); emit_8(decode(opcode) == JIT_ADDQA ? 0xc0 : 0xe8); emit_8(quick);
+			store(8 + rn);
+			break;
+		case JIT_TST:
+			load(MODRM_EAX_RDI, rn);
+			logic_flags();
+			break;
+		case JIT_CLR:
+			emit_disp(0xc7, MODRM_EAX_RDI, layout.r + 4 * rn);
+			emit_32(0);
+			clear_flag(layout.n);
+			clear_flag(layout.z, true);
+			clear_flag(layout.v);
+			clear_flag(layout.c);
+			break;
+		case JIT_NOT:
+			load(MODRM_EAX_RDI, rn);
+			emit_8(0xf7); emit_8(0xd0);		// not eax
+			store(rn);
+			logic_flags();
+			break;
+		case JIT_NEG:
+			load(MODRM_EAX_RDI, rn);
+			emit_8(0xf7); emit_8(0xd8);		// neg eax
+			store(rn);
+			arithmetic_flags(true);
+			break;
+		case JIT_SWAP:
+			load(MODRM_EAX_RDI, rn);
+			emit_8(0xc1); emit_8(0xc0); emit_8(16);	// rol eax, 16
+			store(rn);
+			logic_flags();
+			break;
+		case JIT_EXT:
+			load(MODRM_EAX_RDI, rn);
+			emit_8(0x0f); emit_8(0xbf); emit_8(0xc0);	// movsx eax, ax
+			store(rn);
+			logic_flags();
+			break;
+		case JIT_LSL:
+		case JIT_LSR:
+		case JIT_ASR:
+			{
+				uint8_t modrm = (decode(opcode) == JIT_LSL) ? 0xe0 : (decode(opcode) == JIT_LSR) ? 0xe8 : 0xf8;
+				load(MODRM_EAX_RDI, rn);
+				emit_8(0xc1); emit_8(modrm); emit_8(quick);	// shl/shr/sar eax, count
+				store(rn);
+				set_flag(SETS, layout.n);
+				set_flag(SETZ, layout.z);
+				set_flag(SETC, layout.c);
+				set_flag(SETC, layout.x);
+				clear_flag(layout.v);
+			}
+			break;
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+E64::jit_code_t E64::m68k_jit_t::translate(const uint16_t *opcodes, int no_of_opcodes)
+{
+	/*
+	 * Worst case per instruction is well below 64 bytes
+	 */
+	if (!buffer || full(no_of_opcodes)) return nullptr;
+
+	uint8_t *start = buffer + used;
+	p = start;
+
+	for (int i = 0; i < no_of_opcodes; i++) {
+		if (!emit(opcodes[i])) return nullptr;
+	}
+	emit_8(0xc3);					// ret
+
+	used = p - buffer;
+
+	return (jit_code_t)start;
+}
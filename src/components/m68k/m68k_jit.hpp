@@ -0,0 +1,90 @@
+/*
+ * m68k_jit.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Translates straight line runs of 68020 register instructions to
+ * x86-64 host code. Only the registers and condition codes are touched
+ * by translated code, the clock, pc and prefetch queue are updated by
+ * the caller (see m68k_ic::execute_cached()). On other hosts, nothing
+ * is translated.
+ */
+
+#ifndef M68K_JIT_HPP
+#define M68K_JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#define M68K_JIT_BUFFER_SIZE	(4 * 1024 * 1024)
+
+namespace E64
+{
+
+/*
+ * Translated code is called with a pointer to moira::Registers
+ */
+typedef void (*jit_code_t)(void *registers);
+
+/*
+ * Offsets within moira::Registers of D0-D7 followed by A0-A7, and of
+ * the condition codes
+ */
+struct jit_layout_t {
+	uint32_t r;
+	uint32_t x;
+	uint32_t n;
+	uint32_t z;
+	uint32_t v;
+	uint32_t c;
+};
+
+class m68k_jit_t {
+private:
+	jit_layout_t layout;
+
+	uint8_t *buffer;
+	size_t used;
+	uint8_t *p;
+
+	void emit_8(uint8_t byte);
+	void emit_32(uint32_t word);
+	void emit_disp(uint8_t opcode, uint8_t modrm, uint32_t offset);
+	void load(uint8_t modrm, int r);
+	void store(int r);
+	void set_flag(uint8_t condition, uint32_t flag);
+	void clear_flag(uint32_t flag, bool value = false);
+	void logic_flags();
+	void arithmetic_flags(bool extend);
+	bool emit(uint16_t opcode);
+public:
+	m68k_jit_t(jit_layout_t registers);
+	~m68k_jit_t();
+
+	inline bool available() { return buffer != nullptr; }
+
+	/*
+	 * True if an opcode can be translated
+	 */
+	static bool supported(uint16_t opcode);
+
+	/*
+	 * True if there's no room left for a run of no_of_opcodes
+	 */
+	inline bool full(int no_of_opcodes)
+	{
+		return used + 64 * (no_of_opcodes + 1) > M68K_JIT_BUFFER_SIZE;
+	}
+
+	/*
+	 * Translates a run of supported opcodes. Returns nullptr when the
+	 * buffer is full, until the next flush().
+	 */
+	jit_code_t translate(const uint16_t *opcodes, int no_of_opcodes);
+	void flush();
+};
+
+}
+
+#endif
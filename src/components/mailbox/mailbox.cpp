@@ -0,0 +1,150 @@
+/*
+ * mailbox.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include "mailbox.hpp"
+
+E64::mailbox_ic::mailbox_ic(TTL74LS148_ic *main_unit, TTL74LS148_ic *coprocessor_unit)
+{
+	TTL74LS148[MAILBOX_MAIN] = main_unit;
+	TTL74LS148[MAILBOX_COPROCESSOR] = coprocessor_unit;
+	interrupt_device_no[MAILBOX_MAIN] = main_unit->connect_device(3);
+	interrupt_device_no[MAILBOX_COPROCESSOR] = coprocessor_unit->connect_device(3);
+	
+	coprocessor_present = false;
+	reset();
+}
+
+void E64::mailbox_ic::reset()
+{
+	for (int i=0; i<2; i++) {
+		doorbell[i] = false;
+		TTL74LS148[i]->release_line(interrupt_device_no[i]);
+	}
+	
+	coprocessor_running = false;
+	coprocessor_reset_pending = false;
+	for (int i=0; i<8; i++) vectors[i] = 0;
+	
+	for (int i=0; i<16; i++) semaphores[i] = 0x00;
+	for (int i=0; i<128; i++) messages[i] = 0x00;
+}
+
+uint8_t E64::mailbox_ic::io_read_8(enum mailbox_side_t side, uint8_t address)
+{
+	if (address & 0x80) return messages[address & 0x7f];
+	
+	if ((address & 0xf0) == 0x10) return semaphores[address & 0x0f].exchange(0x80);
+	
+	switch (address) {
+		case 0x00:
+			return doorbell[side] ? 0b00000001 : 0b00000000;
+		case 0x02:
+			return coprocessor_running ? 0b00000001 : 0b00000000;
+		case 0x03:
+			return side;
+		case 0x04:
+		case 0x05:
+		case 0x06:
+		case 0x07:
+		case 0x08:
+		case 0x09:
+		case 0x0a:
+		case 0x0b:
+			return vectors[address - 0x04];
+		default:
+			return 0x00;
+	}
+}
+
+void E64::mailbox_ic::io_write_8(enum mailbox_side_t side, uint8_t address, uint8_t byte)
+{
+	if (address & 0x80) {
+		messages[address & 0x7f] = byte;
+		return;
+	}
+	
+	if ((address & 0xf0) == 0x10) {
+		semaphores[address & 0x0f] = 0x00;
+		return;
+	}
+	
+	switch (address) {
+		case 0x00:
+			if (byte & 0b00000001) {
+				doorbell[side] = false;
+				TTL74LS148[side]->release_line(interrupt_device_no[side]);
+			}
+			break;
+		case 0x01:
+			doorbell[side == MAILBOX_MAIN ? MAILBOX_COPROCESSOR : MAILBOX_MAIN] = true;
+			break;
+		case 0x02:
+			if ((side == MAILBOX_MAIN) && coprocessor_present) {
+				if ((byte & 0b00000001) && !coprocessor_running) {
+					coprocessor_reset_pending = true;
+					coprocessor_running = true;
+				} else if (!(byte & 0b00000001)) {
+					coprocessor_running = false;
+				}
+			}
+			break;
+		case 0x04:
+		case 0x05:
+		case 0x06:
+		case 0x07:
+		case 0x08:
+		case 0x09:
+		case 0x0a:
+		case 0x0b:
+			if (side == MAILBOX_MAIN) vectors[address - 0x04] = byte;
+			break;
+		default:
+			break;
+	}
+}
+
+void E64::mailbox_ic::update_interrupt(enum mailbox_side_t side)
+{
+	if (doorbell[side]) TTL74LS148[side]->pull_line(interrupt_device_no[side]);
+}
+
+void E64::mailbox_ic::save_state(FILE *f)
+{
+	uint8_t state[4] = {
+		doorbell[MAILBOX_MAIN],
+		doorbell[MAILBOX_COPROCESSOR],
+		coprocessor_running,
+		coprocessor_reset_pending
+	};
+	fwrite(state, 1, 4, f);
+	
+	uint8_t bytes[128];
+	for (int i=0; i<8; i++) bytes[i] = vectors[i];
+	fwrite(bytes, 1, 8, f);
+	for (int i=0; i<16; i++) bytes[i] = semaphores[i];
+	fwrite(bytes, 1, 16, f);
+	for (int i=0; i<128; i++) bytes[i] = messages[i];
+	fwrite(bytes, 1, 128, f);
+}
+
+void E64::mailbox_ic::load_state(FILE *f)
+{
+	uint8_t state[4];
+	fread(state, 1, 4, f);
+	doorbell[MAILBOX_MAIN] = state[0];
+	doorbell[MAILBOX_COPROCESSOR] = state[1];
+	coprocessor_running = state[2];
+	coprocessor_reset_pending = state[3];
+	
+	uint8_t bytes[128];
+	fread(bytes, 1, 8, f);
+	for (int i=0; i<8; i++) vectors[i] = bytes[i];
+	fread(bytes, 1, 16, f);
+	for (int i=0; i<16; i++) semaphores[i] = bytes[i];
+	fread(bytes, 1, 128, f);
+	for (int i=0; i<128; i++) messages[i] = bytes[i];
+}
@@ -0,0 +1,108 @@
+/*
+ * mailbox.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Mailbox and semaphores between the main cpu and the coprocessor.
+ * Both see the same io page, but some registers depend on the side
+ * that accesses them. The two cpu's run on different host threads,
+ * so all state that's shared is atomic.
+ *
+ *  Register 0x00 - Status Register (of the accessing side)
+ *
+ *  7 6 5 4 3 2 1 0
+ *                |
+ *                +-- Doorbell interrupt pending (1) (READ), write 1 to acknowledge
+ *
+ *  Register 0x01 - Doorbell, writing any value interrupts the other side (WRITE ONLY)
+ *
+ *  Register 0x02 - Coprocessor Control Register
+ *
+ *  7 6 5 4 3 2 1 0
+ *                |
+ *                +-- Coprocessor halted (0) / running (1) (READ/WRITE, main cpu only)
+ *
+ *  Writing 1 while halted resets the coprocessor, it starts with the
+ *  vectors in registers 0x04-0x0b. Reads 0 without a coprocessor.
+ *
+ *  Register 0x03 - Side, 0 for the main cpu, 1 for the coprocessor (READ ONLY)
+ *
+ *  Registers 0x04-0x07 - Initial stack pointer of the coprocessor (big endian)
+ *  Registers 0x08-0x0b - Initial program counter of the coprocessor (big endian)
+ *
+ *  Registers 0x10-0x1f - Semaphores
+ *  Reading returns the old state (0x00 free, 0x80 taken) and takes the
+ *  semaphore. Writing any value frees it.
+ *
+ *  Registers 0x80-0xff - Message bytes (READ/WRITE, both sides)
+ */
+
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include "TTL74LS148.hpp"
+
+namespace E64
+{
+
+enum mailbox_side_t {
+	MAILBOX_MAIN,
+	MAILBOX_COPROCESSOR
+};
+
+class mailbox_ic {
+private:
+	TTL74LS148_ic *TTL74LS148[2];
+	uint8_t interrupt_device_no[2];
+	
+	/*
+	 * Doorbell raised for a side, only that side's thread pulls or
+	 * releases its own interrupt line
+	 */
+	std::atomic<bool> doorbell[2];
+	
+	std::atomic<bool> coprocessor_running;
+	std::atomic<bool> coprocessor_reset_pending;
+	std::atomic<uint8_t> vectors[8];
+	
+	std::atomic<uint8_t> semaphores[16];
+	std::atomic<uint8_t> messages[128];
+public:
+	mailbox_ic(TTL74LS148_ic *main_unit, TTL74LS148_ic *coprocessor_unit);
+	void reset();
+	
+	/*
+	 * Only with a coprocessor, the control register has effect
+	 */
+	bool coprocessor_present;
+	
+	uint8_t io_read_8(enum mailbox_side_t side, uint8_t address);
+	void io_write_8(enum mailbox_side_t side, uint8_t address, uint8_t byte);
+	
+	/*
+	 * The first 8 bytes of the coprocessor's address space
+	 */
+	inline uint8_t vector_read_8(uint8_t address) { return vectors[address & 0x07]; }
+	
+	/*
+	 * To be called by the thread of a side, pulls its interrupt line
+	 * if the other side rang the doorbell
+	 */
+	void update_interrupt(enum mailbox_side_t side);
+	
+	inline bool coprocessor_is_running() { return coprocessor_running; }
+	inline bool coprocessor_reset_requested() { return coprocessor_reset_pending.exchange(false); }
+	
+	void save_state(FILE *f);
+	void load_state(FILE *f);
+};
+
+}
+
+#endif
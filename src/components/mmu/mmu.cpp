@@ -6,13 +6,23 @@
  */
 
 #include "mmu.hpp"
-#include "common.hpp"
+#include "definitions.hpp"
+#include "machine.hpp"
 #include "rom.hpp"
 
+E64::mmu_ic::mmu_ic(machine_t *owner)
+{
+	machine = owner;
+	custom_rom_path = nullptr;
+	
+	for (int i=0; i<CODE_PAGES/64; i++) code_pages[i] = 0;
+	for (int i=0; i<CODE_PAGES; i++) code_generations[i] = 0;
+}
+
 void E64::mmu_ic::reset()
 {
 	// if desired & available, update rom image
-	if (host.settings->use_custom_rom) {
+	if (custom_rom_path) {
 		printf("[MMU] Trying to use custom rom\n");
 		update_rom_image();
 	} else {
@@ -37,22 +47,24 @@ uint8_t E64::mmu_ic::read_memory_8(uint32_t address)
 		switch (page) {
 			// $0800 - $0fff io range
 			case IO_BLITTER:
-				return machine.blitter->io_read_8(address & 0xff);
+				return machine->blitter->io_read_8(address & 0xff);
 			case IO_TIMER_PAGE:
-				return machine.timer->io_read_8(address & 0xff);
+				return machine->timer->io_read_8(address & 0xff);
 			case IO_CIA_PAGE:
-				return machine.cia->io_read_8(address & 0xff);
+				return machine->cia->io_read_8(address & 0xff);
+			case IO_MAILBOX_PAGE:
+				return machine->mailbox->io_read_8(MAILBOX_MAIN, address & 0xff);
 			case IO_SID_PAGE:
 			case IO_ANALOG_PAGE:
 			case IO_MIXER_PAGE:
-				return machine.sound->read_byte(address & 0x3ff);
+				return machine->sound->read_byte(address & 0x3ff);
 			default:
-				return machine.blitter->video_memory_read_8(address & 0xffffff);
+				return machine->blitter->video_memory_read_8(address & 0xffffff);
 		}
 	} else if ((page & 0xff00) == 0x0100) {
 		// $10000 - $1ffff io blit registers (64kb)
 		// for now:
-		return machine.blitter->io_blit_contexts_read_8(address & 0xffff);
+		return machine->blitter->io_blit_contexts_read_8(address & 0xffff);
 	} else if ((page & 0xff00) == 0x0200) {
 		// $10000 - $1ffff 64kb rom
 		return current_rom_image[address & 0xffff];
@@ -60,9 +72,9 @@ uint8_t E64::mmu_ic::read_memory_8(uint32_t address)
 		// c64 charrom
 		switch (address & 0b1) {
 			case 0b0:
-				return machine.blitter->cbm_font[((address >> 1) & 0x3fff)] >> 8;
+				return machine->blitter->cbm_font[((address >> 1) & 0x3fff)] >> 8;
 			case 0b1:
-				return machine.blitter->cbm_font[((address >> 1) & 0x3fff)] & 0xff;
+				return machine->blitter->cbm_font[((address >> 1) & 0x3fff)] & 0xff;
 			default:
 				return 0;
 		}
@@ -70,15 +82,15 @@ uint8_t E64::mmu_ic::read_memory_8(uint32_t address)
 		// amiga charrom
 		switch (address & 0b1) {
 			case 0b0:
-				return machine.blitter->amiga_font[((address >> 1) & 0x7fff)] >> 8;
+				return machine->blitter->amiga_font[((address >> 1) & 0x7fff)] >> 8;
 			case 0b1:
-				return machine.blitter->amiga_font[((address >> 1) & 0x7fff)] & 0xff;
+				return machine->blitter->amiga_font[((address >> 1) & 0x7fff)] & 0xff;
 			default:
 				return 0;
 		}
 	} else {
 		// use ram
-		return machine.blitter->video_memory_read_8(address & 0xffffff);
+		return machine->blitter->video_memory_read_8(address & 0xffffff);
 	}
 }
 
@@ -86,34 +98,45 @@ void E64::mmu_ic::write_memory_8(uint32_t address, uint8_t value)
 {
 	uint16_t page = (address & 0xffffff) >> 8;
 	
+	track_write(address);
+	
 	if ((page & 0xfff8) == 0x0008) {
 		switch (page) {
 			// $0800 - $0fff io range will ALWAYS be written to
 			case IO_BLITTER:
-				machine.blitter->io_write_8(address & 0xff, value);
+				machine->blitter->io_write_8(address & 0xff, value);
 				break;
 			case IO_TIMER_PAGE:
-				machine.timer->io_write_8(address & 0xff, value);
+				/*
+				 * Timer must be up to date before a register
+				 * write, and its next event may change after.
+				 */
+				machine->sync_timer();
+				machine->timer->io_write_8(address & 0xff, value);
+				machine->sync_timer();
 				break;
 			case IO_CIA_PAGE:
-				machine.cia->io_write_8(address & 0xff, value);
+				machine->cia->io_write_8(address & 0xff, value);
+				break;
+			case IO_MAILBOX_PAGE:
+				machine->mailbox->io_write_8(MAILBOX_MAIN, address & 0xff, value);
 				break;
 			case IO_SID_PAGE:
 			case IO_ANALOG_PAGE:
 			case IO_MIXER_PAGE:
-				machine.sound->write_byte(address & 0x3ff, value);
+				machine->sound->write_byte(address & 0x3ff, value);
 				break;
 			default:
 				// use ram
-				machine.blitter->video_memory_write_8(address & 0xffffff, value);
+				machine->blitter->video_memory_write_8(address & 0xffffff, value);
 				break;
 		}
 	} else if ((page & 0xff00) == 0x0100) {
 		// $10000 - $1ffff io blit registers (64kb)
-		machine.blitter->io_blit_contexts_write_8(address & 0xffff, value);
+		machine->blitter->io_blit_contexts_write_8(address & 0xffff, value);
 	} else {
 		// now it's ram
-		machine.blitter->video_memory_write_8(address & 0xffffff, value);
+		machine->blitter->video_memory_write_8(address & 0xffffff, value);
 	}
 }
 
@@ -128,18 +151,80 @@ void E64::mmu_ic::write_memory_16(uint32_t address, uint16_t value)
 	write_memory_8((address + 1) & 0xffffff, value & 0x00ff);
 }
 
+void E64::mmu_ic::code_page_written(uint16_t page)
+{
+	code_pages[page >> 6] &= ~((uint64_t)1 << (page & 63));
+	code_generations[page]++;
+	machine->m68k->code_page_written(page);
+}
+
+bool E64::mmu_ic::key_events_waiting()
+{
+	return machine->cia->events_waiting();
+}
+
+uint8_t E64::mmu_ic::coprocessor_read_memory_8(uint32_t address)
+{
+	uint16_t page = (address & 0xffffff) >> 8;
+	
+	if (!(address & 0xfffffff8)) {
+		return machine->mailbox->vector_read_8(address);
+	} else if ((page & 0xfff8) == 0x0008) {
+		switch (page) {
+			case IO_MAILBOX_PAGE:
+				return machine->mailbox->io_read_8(MAILBOX_COPROCESSOR, address & 0xff);
+			case IO_BLITTER:
+			case IO_TIMER_PAGE:
+			case IO_CIA_PAGE:
+			case IO_SID_PAGE:
+			case IO_ANALOG_PAGE:
+			case IO_MIXER_PAGE:
+				return 0;
+			default:
+				return machine->blitter->video_memory_read_8(address & 0xffffff);
+		}
+	} else if ((page & 0xff00) == 0x0100) {
+		return 0;
+	} else {
+		return read_memory_8(address);
+	}
+}
+
+void E64::mmu_ic::coprocessor_write_memory_8(uint32_t address, uint8_t value)
+{
+	uint16_t page = (address & 0xffffff) >> 8;
+	
+	if ((page & 0xfff8) == 0x0008) {
+		switch (page) {
+			case IO_MAILBOX_PAGE:
+				machine->mailbox->io_write_8(MAILBOX_COPROCESSOR, address & 0xff, value);
+				break;
+			case IO_BLITTER:
+			case IO_TIMER_PAGE:
+			case IO_CIA_PAGE:
+			case IO_SID_PAGE:
+			case IO_ANALOG_PAGE:
+			case IO_MIXER_PAGE:
+				break;
+			default:
+				machine->blitter->video_memory_write_8_coprocessor(address & 0xffffff, value);
+				break;
+		}
+	} else if ((page & 0xff00) != 0x0100) {
+		machine->blitter->video_memory_write_8_coprocessor(address & 0xffffff, value);
+	}
+}
+
 void E64::mmu_ic::update_rom_image()
 {
-	FILE *f = fopen(host.settings->rom_path, "r");
+	FILE *f = fopen(custom_rom_path, "r");
 	
 	if (f) {
-		printf("[MMU] Found 'rom.bin' in %s, using this image\n",
-		       host.settings->settings_dir);
+		printf("[MMU] Found %s, using this image\n", custom_rom_path);
 		fread(current_rom_image, 65536, 1, f);
 		fclose(f);
 	} else {
-		printf("[MMU] No 'rom.bin' in %s, using built-in rom\n",
-		       host.settings->settings_dir);
+		printf("[MMU] No %s, using built-in rom\n", custom_rom_path);
 		for(int i=0; i<65536; i++) current_rom_image[i] = rom[i];
 	}
 }
@@ -171,12 +256,6 @@ bool E64::mmu_ic::insert_binary(char *file)
 			write_memory_8(end_address++, byte);
 		}
 		fclose(f);
-		hud.show_notification("%s\n\n"
-				      "loading $%04x bytes from $%04x to $%04x",
-				      file,
-				      end_address - start_address,
-				      start_address,
-				      end_address);
 		printf("[MMU] %s\n"
 		       "[MMU] Loading $%04x bytes from $%04x to $%04x\n",
 		       file,
@@ -192,7 +271,7 @@ bool E64::mmu_ic::insert_binary(char *file)
 
 		return true;
 	} else {
-		hud.blitter->terminal_printf(hud.terminal->number, "[MMU] Error: can't open %s\n", file);
+		printf("[MMU] Error: can't open %s\n", file);
 		return false;
 	}
 }
@@ -35,15 +35,33 @@
 #define IO_BLITTER		0x0008
 #define IO_TIMER_PAGE		0x0009
 #define IO_CIA_PAGE		0x000a
+#define IO_MAILBOX_PAGE		0x000b
 #define IO_SID_PAGE		0x000c
 #define IO_ANALOG_PAGE		0x000d
 #define IO_MIXER_PAGE		0x000e
 
+#define CODE_PAGE_SHIFT		8
+#define CODE_PAGES		(1 << (24 - CODE_PAGE_SHIFT))
+
 namespace E64
 {
 
+class machine_t;
+
 class mmu_ic {
+private:
+	const char *custom_rom_path;
+	
+	/*
+	 * Owning machine, its ic's are mapped into the address space
+	 */
+	machine_t *machine;
+	
+	uint64_t code_pages[CODE_PAGES / 64];
+	uint32_t code_generations[CODE_PAGES];
+	void code_page_written(uint16_t page);
 public:
+	mmu_ic(machine_t *owner);
 	void reset();
 
 	uint8_t read_memory_8(uint32_t address);
@@ -52,8 +70,59 @@ public:
 	uint16_t read_memory_16(uint32_t address);
 	void     write_memory_16(uint32_t address, uint16_t value);
 	
+	/*
+	 * The coprocessor shares ram, rom and charroms, but the only io
+	 * it sees is the mailbox. Other io pages and the blit contexts
+	 * read 0 and ignore writes. Its reset vectors come from the
+	 * mailbox. Called from the coprocessor thread.
+	 */
+	uint8_t coprocessor_read_memory_8(uint32_t address);
+	void    coprocessor_write_memory_8(uint32_t address, uint8_t value);
+	
+	/*
+	 * Whether the cia has key events waiting, lets the cpu recognize
+	 * a prompt polling for keys without touching the cia
+	 */
+	bool key_events_waiting();
+	
 	uint8_t  current_rom_image[65536];
 	
+	/*
+	 * Write tracking for the block cache of the main cpu. Pages
+	 * holding cached code are marked. The first write to a marked
+	 * page unmarks it and bumps its generation, which makes the
+	 * blocks on it stale. All writes of the main cpu pass here.
+	 */
+	inline void mark_code_page(uint32_t address)
+	{
+		uint16_t page = (address & 0xffffff) >> CODE_PAGE_SHIFT;
+		code_pages[page >> 6] |= (uint64_t)1 << (page & 63);
+	}
+	inline uint32_t code_generation(uint32_t address)
+	{
+		return code_generations[(address & 0xffffff) >> CODE_PAGE_SHIFT];
+	}
+	inline void track_write(uint32_t address)
+	{
+		uint16_t page = (address & 0xffffff) >> CODE_PAGE_SHIFT;
+		if (code_pages[page >> 6] & ((uint64_t)1 << (page & 63))) code_page_written(page);
+	}
+	
+	/*
+	 * For memory that changed without passing here
+	 */
+	inline void track_writes(uint32_t address, uint32_t size)
+	{
+		for (uint32_t offset = 0; offset < size; offset += (1 << CODE_PAGE_SHIFT)) {
+			track_write(address + offset);
+		}
+	}
+	
+	/*
+	 * Use a rom image from file instead of the built-in one at next
+	 * reset, nullptr reverts to built-in rom
+	 */
+	inline void use_custom_rom(const char *path) { custom_rom_path = path; }
 	void update_rom_image();
 	
 	bool insert_binary(char *file);
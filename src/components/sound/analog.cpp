@@ -4,9 +4,10 @@
  * Copyright © 2021-2023 elmerucr. All rights reserved.
  */
 
-#include "common.hpp"
+#include "definitions.hpp"
 #include "analog.hpp"
 #include <cmath>
+#include <cstdio>
 
 E64::analog_ic::analog_ic(uint8_t no)
 {
@@ -460,3 +461,82 @@ uint8_t E64::rca::byte()
 uint32_t E64::rca::status() {
 	return stat;
 }
+
+/*
+ * Lookup tables are the same for every instance and not included
+ */
+void E64::analog_ic::save_state(FILE *f)
+{
+	uint32_t noise = uniform_white_noise.status();
+	
+	fwrite(&old_buffer, sizeof(old_buffer), 1, f);
+	fwrite(&gate_open, sizeof(gate_open), 1, f);
+	fwrite(&phase, sizeof(phase), 1, f);
+	fwrite(&phase_delta, sizeof(phase_delta), 1, f);
+	fwrite(&phase_remainder, sizeof(phase_remainder), 1, f);
+	fwrite(&frequency, sizeof(frequency), 1, f);
+	fwrite(&_frequency, sizeof(_frequency), 1, f);
+	fwrite(&waveform, sizeof(waveform), 1, f);
+	fwrite(&square_duty, sizeof(square_duty), 1, f);
+	fwrite(&digital_freq, sizeof(digital_freq), 1, f);
+	fwrite(&envelope_stage, sizeof(envelope_stage), 1, f);
+	fwrite(&envelope, sizeof(envelope), 1, f);
+	fwrite(&envelope_target, sizeof(envelope_target), 1, f);
+	fwrite(&stage_samples, sizeof(stage_samples), 1, f);
+	fwrite(&stage_samples_remaining, sizeof(stage_samples_remaining), 1, f);
+	fwrite(&envelope_phase, sizeof(envelope_phase), 1, f);
+	fwrite(&envelope_phase_delta, sizeof(envelope_phase_delta), 1, f);
+	fwrite(&envelope_change, sizeof(envelope_change), 1, f);
+	fwrite(&attack, sizeof(attack), 1, f);
+	fwrite(&decay, sizeof(decay), 1, f);
+	fwrite(&sustain, sizeof(sustain), 1, f);
+	fwrite(&release, sizeof(release), 1, f);
+	fwrite(&pitch_bend_duration, sizeof(pitch_bend_duration), 1, f);
+	fwrite(&pitch_bend_on, sizeof(pitch_bend_on), 1, f);
+	fwrite(&pitch_up, sizeof(pitch_up), 1, f);
+	fwrite(&pitch_factor, sizeof(pitch_factor), 1, f);
+	fwrite(&pitch_samples, sizeof(pitch_samples), 1, f);
+	fwrite(&pitch_samples_remaining, sizeof(pitch_samples_remaining), 1, f);
+	fwrite(&pitch_bend_phase, sizeof(pitch_bend_phase), 1, f);
+	fwrite(&pitch_bend_phase_delta, sizeof(pitch_bend_phase_delta), 1, f);
+	fwrite(&noise, sizeof(noise), 1, f);
+}
+
+void E64::analog_ic::load_state(FILE *f)
+{
+	uint32_t noise;
+	
+	fread(&old_buffer, sizeof(old_buffer), 1, f);
+	fread(&gate_open, sizeof(gate_open), 1, f);
+	fread(&phase, sizeof(phase), 1, f);
+	fread(&phase_delta, sizeof(phase_delta), 1, f);
+	fread(&phase_remainder, sizeof(phase_remainder), 1, f);
+	fread(&frequency, sizeof(frequency), 1, f);
+	fread(&_frequency, sizeof(_frequency), 1, f);
+	fread(&waveform, sizeof(waveform), 1, f);
+	fread(&square_duty, sizeof(square_duty), 1, f);
+	fread(&digital_freq, sizeof(digital_freq), 1, f);
+	fread(&envelope_stage, sizeof(envelope_stage), 1, f);
+	fread(&envelope, sizeof(envelope), 1, f);
+	fread(&envelope_target, sizeof(envelope_target), 1, f);
+	fread(&stage_samples, sizeof(stage_samples), 1, f);
+	fread(&stage_samples_remaining, sizeof(stage_samples_remaining), 1, f);
+	fread(&envelope_phase, sizeof(envelope_phase), 1, f);
+	fread(&envelope_phase_delta, sizeof(envelope_phase_delta), 1, f);
+	fread(&envelope_change, sizeof(envelope_change), 1, f);
+	fread(&attack, sizeof(attack), 1, f);
+	fread(&decay, sizeof(decay), 1, f);
+	fread(&sustain, sizeof(sustain), 1, f);
+	fread(&release, sizeof(release), 1, f);
+	fread(&pitch_bend_duration, sizeof(pitch_bend_duration), 1, f);
+	fread(&pitch_bend_on, sizeof(pitch_bend_on), 1, f);
+	fread(&pitch_up, sizeof(pitch_up), 1, f);
+	fread(&pitch_factor, sizeof(pitch_factor), 1, f);
+	fread(&pitch_samples, sizeof(pitch_samples), 1, f);
+	fread(&pitch_samples_remaining, sizeof(pitch_samples_remaining), 1, f);
+	fread(&pitch_bend_phase, sizeof(pitch_bend_phase), 1, f);
+	fread(&pitch_bend_phase_delta, sizeof(pitch_bend_phase_delta), 1, f);
+	fread(&noise, sizeof(noise), 1, f);
+	
+	uniform_white_noise = rca(noise);
+}
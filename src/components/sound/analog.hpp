@@ -37,6 +37,7 @@
 #define ANALOG_HPP
 
 #include <cstdint>
+#include <cstdio>
 
 /*
  * Maximum wavelength (in seconds) at full resolution. This results in
@@ -195,6 +196,9 @@ public:
 	void write_byte(uint8_t address, uint8_t byte);
 	
 	void run(uint16_t no_samples, int16_t *buffer);
+	
+	void save_state(FILE *f);
+	void load_state(FILE *f);
 };
 
 }
@@ -72,11 +72,29 @@ public:
     reg8 envelope_counter[3];
     EnvelopeGenerator::State envelope_state[3];
     bool hold_zero[3];
+
+    // (E64) Filters and resampler, so a restored SID continues with
+    // exactly the same output.
+    sound_sample filter_Vhp;
+    sound_sample filter_Vbp;
+    sound_sample filter_Vlp;
+    sound_sample filter_Vnf;
+    sound_sample extfilt_Vlp;
+    sound_sample extfilt_Vhp;
+    sound_sample extfilt_Vo;
+    cycle_count sample_offset;
+    int sample_index;
+    short sample_prev;
   };
     
   State read_state();
   void write_state(const State& state);
 
+  // (E64) Ring buffer of the resampling methods, RINGSIZE samples
+  // followed by a mirror of them. Size 0 with the other methods.
+  int resample_ring_size() { return sample ? RINGSIZE : 0; }
+  short* resample_ring() { return sample; }
+
   // 16-bit input (EXT IN).
   void input(int sample);
 
@@ -5,12 +5,14 @@
  * Copyright © 2019-2023 elmerucr. All rights reserved.
  */
 
+#include <cstring>
 #include "sound.hpp"
-#include "sdl2.hpp"
-#include "common.hpp"
+#include "definitions.hpp"
 
 E64::sound_ic::sound_ic() : analog0(0), analog1(1), analog2(2), analog3(3)
 {
+	cycles_run = 0;
+	
 	/*
 	 * Remapping SID registers, rewiring necessary to have big endian
 	 * support and even addresses for word access.
@@ -231,8 +233,14 @@ void E64::sound_ic::write_byte(uint16_t address, uint8_t byte)
 	}
 }
 
-void E64::sound_ic::run(uint32_t number_of_cycles)
+void E64::sound_ic::set_sampling_method(sampling_method method)
+{
+	for (int i=0; i<4; i++) sid[i].set_sampling_parameters(SID_CLOCK_SPEED, method, SAMPLE_RATE);
+}
+
+uint32_t E64::sound_ic::run(uint32_t number_of_cycles)
 {
+	cycles_run += number_of_cycles;
 	delta_t_sid0 += number_of_cycles;
 	delta_t_sid1 = delta_t_sid0;
 	delta_t_sid2 = delta_t_sid0;
@@ -303,7 +311,7 @@ void E64::sound_ic::run(uint32_t number_of_cycles)
 		record_buffer_push(sample_buffer_stereo[(2 * i) + 1]);
 	}
 
-	E64::sdl2_queue_audio((void *)sample_buffer_stereo, 2 * n * sdl2_bytes_per_sample());
+	return n;
 }
 
 void E64::sound_ic::reset()
@@ -320,3 +328,116 @@ void E64::sound_ic::clear_record_buffer()
 {
 	record_buffer_head = record_buffer_tail = 0;
 }
+
+void E64::sound_ic::save_state(FILE *f)
+{
+	/*
+	 * Per field, padding would make identical states differ
+	 */
+	for (int i=0; i<4; i++) {
+		SID::State state = sid[i].read_state();
+		fwrite(state.sid_register, 1, sizeof(state.sid_register), f);
+		fwrite(&state.bus_value, sizeof(state.bus_value), 1, f);
+		fwrite(&state.bus_value_ttl, sizeof(state.bus_value_ttl), 1, f);
+		fwrite(state.accumulator, sizeof(state.accumulator), 1, f);
+		fwrite(state.shift_register, sizeof(state.shift_register), 1, f);
+		fwrite(state.rate_counter, sizeof(state.rate_counter), 1, f);
+		fwrite(state.rate_counter_period, sizeof(state.rate_counter_period), 1, f);
+		fwrite(state.exponential_counter, sizeof(state.exponential_counter), 1, f);
+		fwrite(state.exponential_counter_period, sizeof(state.exponential_counter_period), 1, f);
+		fwrite(state.envelope_counter, sizeof(state.envelope_counter), 1, f);
+		fwrite(state.envelope_state, sizeof(state.envelope_state), 1, f);
+		fwrite(state.hold_zero, sizeof(state.hold_zero), 1, f);
+		fwrite(&state.filter_Vhp, sizeof(state.filter_Vhp), 1, f);
+		fwrite(&state.filter_Vbp, sizeof(state.filter_Vbp), 1, f);
+		fwrite(&state.filter_Vlp, sizeof(state.filter_Vlp), 1, f);
+		fwrite(&state.filter_Vnf, sizeof(state.filter_Vnf), 1, f);
+		fwrite(&state.extfilt_Vlp, sizeof(state.extfilt_Vlp), 1, f);
+		fwrite(&state.extfilt_Vhp, sizeof(state.extfilt_Vhp), 1, f);
+		fwrite(&state.extfilt_Vo, sizeof(state.extfilt_Vo), 1, f);
+		fwrite(&state.sample_offset, sizeof(state.sample_offset), 1, f);
+		fwrite(&state.sample_index, sizeof(state.sample_index), 1, f);
+		fwrite(&state.sample_prev, sizeof(state.sample_prev), 1, f);
+		
+		/*
+		 * Only the resampling methods have a ring buffer
+		 */
+		int32_t ring_size = sid[i].resample_ring_size();
+		fwrite(&ring_size, sizeof(ring_size), 1, f);
+		fwrite(sid[i].resample_ring(), sizeof(short), ring_size, f);
+	}
+	
+	/*
+	 * Cycles left over by the last run
+	 */
+	fwrite(&delta_t_sid0, sizeof(delta_t_sid0), 1, f);
+	fwrite(&delta_t_sid1, sizeof(delta_t_sid1), 1, f);
+	fwrite(&delta_t_sid2, sizeof(delta_t_sid2), 1, f);
+	fwrite(&delta_t_sid3, sizeof(delta_t_sid3), 1, f);
+	fwrite(sid_shadow, 1, 128, f);
+	
+	analog0.save_state(f);
+	analog1.save_state(f);
+	analog2.save_state(f);
+	analog3.save_state(f);
+	
+	fwrite(balance_registers, 1, 0x10, f);
+	fwrite(&sound_starting, sizeof(sound_starting), 1, f);
+}
+
+void E64::sound_ic::load_state(FILE *f)
+{
+	for (int i=0; i<4; i++) {
+		SID::State state;
+		fread(state.sid_register, 1, sizeof(state.sid_register), f);
+		fread(&state.bus_value, sizeof(state.bus_value), 1, f);
+		fread(&state.bus_value_ttl, sizeof(state.bus_value_ttl), 1, f);
+		fread(state.accumulator, sizeof(state.accumulator), 1, f);
+		fread(state.shift_register, sizeof(state.shift_register), 1, f);
+		fread(state.rate_counter, sizeof(state.rate_counter), 1, f);
+		fread(state.rate_counter_period, sizeof(state.rate_counter_period), 1, f);
+		fread(state.exponential_counter, sizeof(state.exponential_counter), 1, f);
+		fread(state.exponential_counter_period, sizeof(state.exponential_counter_period), 1, f);
+		fread(state.envelope_counter, sizeof(state.envelope_counter), 1, f);
+		fread(state.envelope_state, sizeof(state.envelope_state), 1, f);
+		fread(state.hold_zero, sizeof(state.hold_zero), 1, f);
+		fread(&state.filter_Vhp, sizeof(state.filter_Vhp), 1, f);
+		fread(&state.filter_Vbp, sizeof(state.filter_Vbp), 1, f);
+		fread(&state.filter_Vlp, sizeof(state.filter_Vlp), 1, f);
+		fread(&state.filter_Vnf, sizeof(state.filter_Vnf), 1, f);
+		fread(&state.extfilt_Vlp, sizeof(state.extfilt_Vlp), 1, f);
+		fread(&state.extfilt_Vhp, sizeof(state.extfilt_Vhp), 1, f);
+		fread(&state.extfilt_Vo, sizeof(state.extfilt_Vo), 1, f);
+		fread(&state.sample_offset, sizeof(state.sample_offset), 1, f);
+		fread(&state.sample_index, sizeof(state.sample_index), 1, f);
+		fread(&state.sample_prev, sizeof(state.sample_prev), 1, f);
+		sid[i].write_state(state);
+		
+		/*
+		 * A ring buffer saved with another sampling method than
+		 * the current one is skipped
+		 */
+		int32_t ring_size;
+		fread(&ring_size, sizeof(ring_size), 1, f);
+		if (ring_size == sid[i].resample_ring_size()) {
+			fread(sid[i].resample_ring(), sizeof(short), ring_size, f);
+			memcpy(sid[i].resample_ring() + ring_size, sid[i].resample_ring(), ring_size * sizeof(short));
+		} else {
+			fseek(f, ring_size * sizeof(short), SEEK_CUR);
+		}
+	}
+	
+	fread(&delta_t_sid0, sizeof(delta_t_sid0), 1, f);
+	fread(&delta_t_sid1, sizeof(delta_t_sid1), 1, f);
+	fread(&delta_t_sid2, sizeof(delta_t_sid2), 1, f);
+	fread(&delta_t_sid3, sizeof(delta_t_sid3), 1, f);
+	fread(sid_shadow, 1, 128, f);
+	
+	analog0.load_state(f);
+	analog1.load_state(f);
+	analog2.load_state(f);
+	analog3.load_state(f);
+	
+	fread(balance_registers, 1, 0x10, f);
+	fread(&sound_starting, sizeof(sound_starting), 1, f);
+}
@@ -72,13 +72,32 @@ public:
 	void write_byte(uint16_t address, uint8_t byte);
 	// run the no of cycles that need to be processed by the sid chips on the sound device
 	// and process all the accumulated cycles (flush into soundbuffer)
-	void run(uint32_t number_of_cycles);
+	// returns the number of stereo samples available in the soundbuffer
+	uint32_t run(uint32_t number_of_cycles);
+	inline float *samples() { return sample_buffer_stereo; }
+	
+	/*
+	 * Resampling method of the sids, SAMPLE_FAST by default. The
+	 * other methods sound better at a higher host cost.
+	 */
+	void set_sampling_method(sampling_method method);
+	
+	/*
+	 * Sid cycles run so far, the owner may reset it
+	 */
+	uint32_t cycles_run;
 	void reset();
 	
 	
 	
 	void clear_record_buffer();
 	
+	/*
+	 * Sids, analogs and mixer
+	 */
+	void save_state(FILE *f);
+	void load_state(FILE *f);
+	
 	inline void record_buffer_push(float sample)
 	{
 		record_buffer[record_buffer_head] = sample;
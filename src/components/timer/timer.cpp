@@ -6,11 +6,12 @@
  */
 
 #include "timer.hpp"
-#include "common.hpp"
+#include "definitions.hpp"
 
 E64::timer_ic::timer_ic(TTL74LS148_ic *unit)
 {
 	TTL74LS148 = unit;
+	clock_speed = CPU_CLOCK_SPEED;
 	/*
 	 * TODO
 	 */
@@ -51,9 +52,44 @@ void E64::timer_ic::run(uint32_t number_of_cycles)
 	}
 }
 
-uint32_t E64::timer_ic::bpm_to_clock_interval(uint16_t bpm)
+uint32_t E64::timer_ic::cycles_to_next_event()
 {
-	return (60.0 / bpm) * CPU_CLOCK_SPEED;
+	uint32_t result = UINT32_MAX;
+	
+	for (int i=0; i<8; i++) {
+		if (control_register & (0b1 << i)) {
+			uint64_t cycles = (timers[i].counter >= timers[i].clock_interval) ?
+				0 : timers[i].clock_interval - timers[i].counter;
+			if (cycles < result) result = cycles;
+		}
+	}
+	
+	return result;
+}
+
+void E64::timer_ic::set_clock_speed(uint32_t hz)
+{
+	/*
+	 * Intervals scale with the clock speed. Scaling the counter by
+	 * the clock speeds instead of the intervals can't overflow.
+	 */
+	for (int i=0; i<8; i++) {
+		timers[i].counter = (timers[i].counter * hz) / clock_speed;
+	}
+	
+	clock_speed = hz;
+	
+	for (int i=0; i<8; i++) {
+		timers[i].clock_interval = bpm_to_clock_interval(timers[i].bpm);
+		if (timers[i].counter >= timers[i].clock_interval) {
+			timers[i].counter = timers[i].clock_interval - 1;
+		}
+	}
+}
+
+uint64_t E64::timer_ic::bpm_to_clock_interval(uint16_t bpm)
+{
+	return (60.0 / bpm) * clock_speed;
 }
 
 uint8_t E64::timer_ic::io_read_8(uint8_t address)
@@ -245,11 +281,38 @@ void E64::timer_ic::status(char *buffer, int n)
 {
 	for (int timer_no=0; timer_no<8; timer_no++) {
 		buffer += snprintf(buffer, n,
-			 "\n%3x%4s %5u %8x:%8x",
+			 "\n%3x%4s %5u %8llx:%8llx",
 			 timer_no,
 			 control_register & (0b1 << timer_no) ? "on" : "off",
 			 timers[timer_no].bpm,
-			 timers[timer_no].counter,
-			 timers[timer_no].clock_interval);
+			 (unsigned long long)timers[timer_no].counter,
+			 (unsigned long long)timers[timer_no].clock_interval);
+	}
+}
+
+void E64::timer_ic::save_state(FILE *f)
+{
+	fwrite(&status_register, sizeof(status_register), 1, f);
+	fwrite(&control_register, sizeof(control_register), 1, f);
+	
+	/*
+	 * Per field, padding would make identical states differ
+	 */
+	for (int i=0; i<8; i++) {
+		fwrite(&timers[i].bpm, sizeof(timers[i].bpm), 1, f);
+		fwrite(&timers[i].clock_interval, sizeof(timers[i].clock_interval), 1, f);
+		fwrite(&timers[i].counter, sizeof(timers[i].counter), 1, f);
+	}
+}
+
+void E64::timer_ic::load_state(FILE *f)
+{
+	fread(&status_register, sizeof(status_register), 1, f);
+	fread(&control_register, sizeof(control_register), 1, f);
+	
+	for (int i=0; i<8; i++) {
+		fread(&timers[i].bpm, sizeof(timers[i].bpm), 1, f);
+		fread(&timers[i].clock_interval, sizeof(timers[i].clock_interval), 1, f);
+		fread(&timers[i].counter, sizeof(timers[i].counter), 1, f);
 	}
 }
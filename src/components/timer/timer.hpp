@@ -54,17 +54,19 @@
 #define timer_hpp
 
 #include <cstdint>
+#include <cstdio>
 #include "TTL74LS148.hpp"
 
 namespace E64
 {
 
+/*
+ * 64 bit, at 1 bpm and a fast cpu clock an interval doesn't fit in 32
+ */
 struct timer_unit {
 	uint16_t bpm;
-	uint32_t clock_interval;
-	
-	// NEEDS WORK? used to be 64 bit...
-	uint32_t counter;
+	uint64_t clock_interval;
+	uint64_t counter;
 };
 
 class timer_ic
@@ -74,8 +76,9 @@ private:
 	uint8_t control_register;
 	
 	struct timer_unit timers[8];
-
-	uint32_t bpm_to_clock_interval(uint16_t bpm);
+	
+	uint32_t clock_speed;
+	uint64_t bpm_to_clock_interval(uint16_t bpm);
 	
 	TTL74LS148_ic *TTL74LS148;
 public:
@@ -95,10 +98,22 @@ public:
 	// run cycles on this ic
 	void run(uint32_t number_of_cycles);
 	
+	/*
+	 * Clock speed of the cycles that are run (cpu clock), running
+	 * timers keep their position within the current interval
+	 */
+	void set_clock_speed(uint32_t hz);
+	
+	// cycles until the next enabled timer expires (at most UINT32_MAX)
+	uint32_t cycles_to_next_event();
+	
 	// convenience function (turning on specific timer + bpm)
 	void set(uint8_t timer_no, uint16_t bpm);
 	
 	void status(char *buffer, int n);
+	
+	void save_state(FILE *f);
+	void load_state(FILE *f);
 };
 
 }
@@ -0,0 +1,284 @@
+/*
+ * headless.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ *
+ * Runs the virtual machine without any host dependencies (no window,
+ * no audio device, no frame throttling) and prints its final state.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "definitions.hpp"
+#include "machine.hpp"
+
+#define	CYCLES_PER_STEP	4096
+
+/*
+ * Writes all samples as raw interleaved stereo floats (host byte order)
+ */
+class audio_file_t : public E64::audio_sink_t {
+private:
+	FILE *f;
+public:
+	audio_file_t(FILE *file) { f = file; }
+	void queue(float *samples, uint32_t no_of_frames) override
+	{
+		fwrite(samples, 2 * sizeof(float), no_of_frames, f);
+	}
+};
+
+static char text_buffer[2048];
+
+/*
+ * Wall clock time per frame, as measured from the end of the last one
+ */
+static std::chrono::time_point<std::chrono::steady_clock> frame_start = std::chrono::steady_clock::now();
+
+static void check_frame_time(E64::machine_t *machine, uint32_t budget)
+{
+	std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+	uint32_t frame_time = std::chrono::duration_cast<std::chrono::microseconds>(now - frame_start).count();
+	if (machine->slow_frame_logging() && (frame_time > budget)) machine->log_slow_frame(frame_time, budget);
+	frame_start = now;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options]\n"
+	       "  -f <frames>       run number of frames (default 60)\n"
+	       "  -c <cycles>       run number of cycles instead of frames\n"
+	       "  -u <multiplier>   run the cpu at a multiple of its clock speed\n"
+	       "  -o                enable the coprocessor\n"
+	       "  -t                enable the block cache\n"
+	       "  -j                enable the block cache and jit\n"
+	       "  -n <mode>         attach fpu (none, fast or exact)\n"
+	       "  -h                run kernel routines natively\n"
+	       "  -r <file>         use rom image from file instead of built-in rom\n"
+	       "  -b <file>         insert binary after reset\n"
+	       "  -l <file>         load state before running\n"
+	       "  -s <file>         save state at end of run\n"
+	       "  -p <file>         replay input log\n"
+	       "  -w <seconds>      keep a rewind buffer\n"
+	       "  -e <frames>       run ahead 0 to 2 frames after each frame\n"
+	       "  -k <frames>       draw only one in a number of frames\n"
+	       "  -x <file>         write state hashes per frame\n"
+	       "  -g <file> <us>    log frames that take longer than a number of microseconds\n"
+	       "  -a <file>         write audio to file (raw stereo floats)\n"
+	       "  -v <file>         write each frame to file (raw 16 bit pixels)\n"
+	       "  -m <start> <end>  dump memory range (hex) at end of run\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	E64::machine_t machine;
+	
+	uint64_t frames = 60;
+	uint64_t cycles = 0;
+	const char *rom_file = nullptr;
+	const char *binary_file = nullptr;
+	const char *input_file = nullptr;
+	const char *load_file = nullptr;
+	const char *save_file = nullptr;
+	const char *hashes_file = nullptr;
+	const char *slow_frames_file = nullptr;
+	uint32_t slow_frame_budget = 0;
+	FILE *audio_file = nullptr;
+	FILE *video_file = nullptr;
+	uint32_t rewind_seconds = 0;
+	unsigned long run_ahead_frames = 0;
+	uint16_t render_interval = 1;
+	unsigned long cpu_clock_multiplier = 1;
+	bool coprocessor = false;
+	bool block_cache = false;
+	bool jit = false;
+	enum E64::fpu_mode_t fpu_mode = E64::FPU_MODE_NONE;
+	bool hle = false;
+	bool dump_memory = false;
+	uint32_t dump_start = 0, dump_end = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc)) {
+			frames = strtoull(argv[++i], nullptr, 10);
+			cycles = 0;
+		} else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+			cycles = strtoull(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-u") == 0) && (i + 1 < argc)) {
+			cpu_clock_multiplier = strtoul(argv[++i], nullptr, 10);
+		} else if (strcmp(argv[i], "-o") == 0) {
+			coprocessor = true;
+		} else if (strcmp(argv[i], "-t") == 0) {
+			block_cache = true;
+		} else if (strcmp(argv[i], "-j") == 0) {
+			block_cache = jit = true;
+		} else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+			i++;
+			int mode = 0;
+			while ((mode < FPU_MODES) && strcmp(argv[i], E64::fpu_mode_names[mode])) mode++;
+			if (mode == FPU_MODES) {
+				usage(argv[0]);
+				return 1;
+			}
+			fpu_mode = (enum E64::fpu_mode_t)mode;
+		} else if (strcmp(argv[i], "-h") == 0) {
+			hle = true;
+		} else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+			rom_file = argv[++i];
+		} else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc)) {
+			binary_file = argv[++i];
+		} else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc)) {
+			load_file = argv[++i];
+		} else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+			save_file = argv[++i];
+		} else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) {
+			rewind_seconds = strtoul(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-e") == 0) && (i + 1 < argc)) {
+			run_ahead_frames = strtoul(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-k") == 0) && (i + 1 < argc)) {
+			render_interval = strtoul(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+			input_file = argv[++i];
+		} else if ((strcmp(argv[i], "-x") == 0) && (i + 1 < argc)) {
+			hashes_file = argv[++i];
+		} else if ((strcmp(argv[i], "-g") == 0) && (i + 2 < argc)) {
+			slow_frames_file = argv[++i];
+			slow_frame_budget = strtoul(argv[++i], nullptr, 10);
+		} else if ((strcmp(argv[i], "-a") == 0) && (i + 1 < argc)) {
+			if (!(audio_file = fopen(argv[++i], "wb"))) {
+				printf("[Headless] Error: can't open %s\n", argv[i]);
+				return 1;
+			}
+		} else if ((strcmp(argv[i], "-v") == 0) && (i + 1 < argc)) {
+			if (!(video_file = fopen(argv[++i], "wb"))) {
+				printf("[Headless] Error: can't open %s\n", argv[i]);
+				return 1;
+			}
+		} else if ((strcmp(argv[i], "-m") == 0) && (i + 2 < argc)) {
+			dump_memory = true;
+			dump_start = strtoul(argv[++i], nullptr, 16) & 0xffffff;
+			dump_end = strtoul(argv[++i], nullptr, 16) & 0xffffff;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	audio_file_t *audio = nullptr;
+	if (audio_file) {
+		audio = new audio_file_t(audio_file);
+		machine.connect_audio_sink(audio);
+	}
+
+	machine.enable_rewind(rewind_seconds);
+	machine.set_render_interval(render_interval);
+	machine.enable_coprocessor(coprocessor);
+	machine.enable_block_cache(block_cache);
+	machine.enable_jit(jit);
+	machine.set_fpu_mode(fpu_mode);
+	machine.enable_hle(hle);
+
+	if (rom_file) machine.mmu->use_custom_rom(rom_file);
+	machine.reset();
+	if (run_ahead_frames > RUN_AHEAD_MAX_FRAMES) {
+		printf("[Headless] Error: run-ahead must be 0 to %u frames\n", RUN_AHEAD_MAX_FRAMES);
+		return 1;
+	}
+	if ((cpu_clock_multiplier > CPU_CLOCK_MULTIPLIER_MAX) ||
+	    !machine.set_cpu_clock_multiplier(cpu_clock_multiplier)) {
+		printf("[Headless] Error: cpu clock multiplier must be 1 to %u\n", CPU_CLOCK_MULTIPLIER_MAX);
+		return 1;
+	}
+
+	if (load_file && !machine.load_state(load_file)) return 1;
+	if (input_file && !machine.start_input_replay(input_file)) return 1;
+
+	if (binary_file && !machine.mmu->insert_binary((char *)binary_file)) return 1;
+	
+	if (hashes_file && !machine.start_state_hashing(hashes_file)) return 1;
+	
+	if (slow_frames_file && !machine.start_slow_frame_log(slow_frames_file)) return 1;
+
+	uint64_t frames_done = 0;
+
+	uint64_t start_clock = machine.m68k->getClock();
+	uint64_t start_instructions = machine.instructions();
+	std::chrono::time_point<std::chrono::steady_clock> start_time = std::chrono::steady_clock::now();
+	frame_start = start_time;
+
+	if (cycles) {
+		while ((uint64_t)machine.m68k->getClock() - start_clock < cycles) {
+			uint64_t remaining = cycles - (machine.m68k->getClock() - start_clock);
+			machine.run(remaining < CYCLES_PER_STEP ? remaining : CYCLES_PER_STEP);
+			if (machine.frame_done()) {
+				frames_done++;
+				check_frame_time(&machine, slow_frame_budget);
+				machine.run_ahead(run_ahead_frames);
+				if (video_file) fwrite(machine.display_fb(), sizeof(uint16_t), VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES, video_file);
+			}
+		}
+	} else {
+		while (frames_done < frames) {
+			machine.run(CYCLES_PER_STEP);
+			if (machine.frame_done()) {
+				frames_done++;
+				check_frame_time(&machine, slow_frame_budget);
+				machine.run_ahead(run_ahead_frames);
+				if (video_file) fwrite(machine.display_fb(), sizeof(uint16_t), VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES, video_file);
+			}
+		}
+	}
+
+	printf("[Headless] Ran %lu frames, %lu cycles (%lu idle cycles skipped)\n",
+	       (unsigned long)frames_done,
+	       (unsigned long)(machine.m68k->getClock() - start_clock),
+	       (unsigned long)machine.idle_cycles());
+	
+	double seconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start_time).count() / 1000000;
+	uint64_t instructions = machine.instructions() - start_instructions;
+	printf("[Headless] %lu instructions in %.3f s, %.2f MIPS\n",
+	       (unsigned long)instructions, seconds, seconds > 0 ? instructions / seconds / 1000000 : 0.0);
+	if (machine.block_cache_active()) {
+		printf("[Headless] Block cache: %lu blocks decoded, %lu loops run in bulk\n",
+		       (unsigned long)machine.m68k->blocks_built,
+		       (unsigned long)machine.m68k->loops_run);
+	}
+	if (machine.jit_active()) {
+		printf("[Headless] JIT: %lu blocks translated, buffer full %lu times\n",
+		       (unsigned long)machine.m68k->blocks_translated,
+		       (unsigned long)machine.m68k->jit_flushes);
+	}
+	if (machine.hle_active()) {
+		printf("[Headless] HLE: %lu routines run natively\n", (unsigned long)machine.m68k->host_calls);
+	}
+
+	machine.m68k->status(text_buffer);
+	printf("%s\n\n", text_buffer);
+
+	printf("ram hash: %016lx\n", (unsigned long)machine.ram_hash());
+
+	if (save_file) machine.save_state(save_file);
+
+	if (dump_memory) {
+		for (uint32_t address = dump_start & 0xfffff0; address <= dump_end; address += 16) {
+			printf("%06x ", address);
+			for (int i = 0; i < 16; i++) {
+				printf(" %02x", machine.blitter->video_memory_read_8((address + i) & 0xffffff));
+			}
+			printf("\n");
+		}
+	}
+
+	machine.stop_state_hashing();
+	machine.stop_slow_frame_log();
+	machine.connect_audio_sink(nullptr);
+	delete audio;
+	if (audio_file) fclose(audio_file);
+	if (video_file) fclose(video_file);
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * audio.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include "audio.hpp"
+#include "common.hpp"
+#include "sdl2.hpp"
+
+void E64::audio_t::queue(float *samples, uint32_t no_of_frames)
+{
+	E64::sdl2_queue_audio((void *)samples, 2 * no_of_frames * sdl2_bytes_per_sample());
+}
+
+unsigned int E64::audio_t::queue_size()
+{
+	/*
+	 * Measured once per frame by stats
+	 */
+	return stats.current_audio_queue_size();
+}
+
+void E64::audio_t::start()
+{
+	E64::sdl2_start_audio();
+}
+
+void E64::audio_t::start_recording()
+{
+	host.settings->create_wav();
+}
+
+void E64::audio_t::record(float sample)
+{
+	host.settings->write_to_wav(sample);
+}
+
+void E64::audio_t::stop_recording()
+{
+	host.settings->finish_wav();
+}
@@ -0,0 +1,33 @@
+/*
+ * audio.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#ifndef AUDIO_HPP
+#define AUDIO_HPP
+
+#include "audio_sink.hpp"
+
+namespace E64 {
+
+/*
+ * Plays the sound of the machine through sdl2, recordings go to a wav
+ * file in the settings directory.
+ */
+class audio_t : public audio_sink_t {
+public:
+	void queue(float *samples, uint32_t no_of_frames) override;
+	bool real_time() override { return true; }
+	unsigned int queue_size() override;
+	void start() override;
+	
+	void start_recording() override;
+	void record(float sample) override;
+	void stop_recording() override;
+};
+
+}
+
+#endif
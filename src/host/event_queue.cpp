@@ -0,0 +1,32 @@
+/*
+ * event_queue.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include "event_queue.hpp"
+
+E64::event_queue_t::event_queue_t()
+{
+	head = 0;
+	tail = 0;
+}
+
+bool E64::event_queue_t::push(const struct host_event_t *event)
+{
+	uint32_t h = head.load(std::memory_order_relaxed);
+	if ((h - tail.load(std::memory_order_acquire)) == EVENT_QUEUE_SIZE) return false;
+	events[h & (EVENT_QUEUE_SIZE - 1)] = *event;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+bool E64::event_queue_t::pop(struct host_event_t *event)
+{
+	uint32_t t = tail.load(std::memory_order_relaxed);
+	if (t == head.load(std::memory_order_acquire)) return false;
+	*event = events[t & (EVENT_QUEUE_SIZE - 1)];
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
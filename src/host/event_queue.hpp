@@ -0,0 +1,59 @@
+/*
+ * event_queue.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Single producer, single consumer queue without locks. Carries host
+ * input and commands from the presentation thread (which owns all sdl
+ * event handling) to the emulation thread.
+ */
+
+#ifndef EVENT_QUEUE_HPP
+#define EVENT_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#define EVENT_QUEUE_SIZE	64	// must be a power of 2
+
+namespace E64
+{
+
+enum host_event_type_t {
+	HOST_EVENT_KEY_STATES,
+	HOST_EVENT_RESET,
+	HOST_EVENT_TOGGLE_RECORDING_SOUND,
+	HOST_EVENT_FLIP_MODES,
+	HOST_EVENT_TOGGLE_STATS,
+	HOST_EVENT_TOGGLE_TURBO,
+	HOST_EVENT_INSERT_BINARY,
+	HOST_EVENT_NOTIFICATION
+};
+
+struct host_event_t {
+	enum host_event_type_t type;
+	uint8_t key_states[128];
+	char text[512];		// file name or notification
+};
+
+class event_queue_t {
+private:
+	struct host_event_t events[EVENT_QUEUE_SIZE];
+	std::atomic<uint32_t> head;	// written by producer only
+	std::atomic<uint32_t> tail;	// written by consumer only
+public:
+	event_queue_t();
+	
+	/*
+	 * Both return false if the queue is full or empty respectively
+	 */
+	bool push(const struct host_event_t *event);
+	bool pop(struct host_event_t *event);
+};
+
+}
+
+#endif
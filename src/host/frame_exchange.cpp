@@ -0,0 +1,46 @@
+/*
+ * frame_exchange.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include "frame_exchange.hpp"
+#include "definitions.hpp"
+
+#define FRAME_FRESH	0b100
+#define FRAME_INDEX	0b011
+
+E64::frame_exchange_t::frame_exchange_t()
+{
+	for (int i=0; i<3; i++) {
+		frames[i].vm_fb = new uint16_t[VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES]();
+		frames[i].hud_fb = new uint16_t[HUD_PIXELS_PER_SCANLINE * HUD_SCANLINES]();
+		frames[i].screen_size = { 0, 0, VM_MAX_PIXELS_PER_SCANLINE, VM_MAX_SCANLINES };
+		frames[i].scanline_screen_size = { 0, 0, VM_MAX_PIXELS_PER_SCANLINE, 4 * VM_MAX_SCANLINES };
+		frames[i].mode = RUNNING;
+	}
+	back = 0;
+	middle = 1;
+	front = 2;
+}
+
+E64::frame_exchange_t::~frame_exchange_t()
+{
+	for (int i=0; i<3; i++) {
+		delete [] frames[i].hud_fb;
+		delete [] frames[i].vm_fb;
+	}
+}
+
+void E64::frame_exchange_t::publish()
+{
+	back = middle.exchange(back | FRAME_FRESH, std::memory_order_acq_rel) & FRAME_INDEX;
+}
+
+bool E64::frame_exchange_t::acquire()
+{
+	if (!(middle.load(std::memory_order_relaxed) & FRAME_FRESH)) return false;
+	front = middle.exchange(front, std::memory_order_acq_rel) & FRAME_INDEX;
+	return true;
+}
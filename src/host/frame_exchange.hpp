@@ -0,0 +1,65 @@
+/*
+ * frame_exchange.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Triple buffer for handing over completed frames from the emulation
+ * thread to the presentation thread. The producer always has a back
+ * frame to draw into and the consumer always has a front frame to
+ * show, neither of them ever waits for the other. A third frame sits
+ * in the middle and is swapped atomically by both sides.
+ */
+
+#ifndef FRAME_EXCHANGE_HPP
+#define FRAME_EXCHANGE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include "machine.hpp"
+
+namespace E64
+{
+
+struct frame_t {
+	uint16_t *vm_fb;
+	uint16_t *hud_fb;
+	struct rectangle screen_size;
+	struct rectangle scanline_screen_size;
+	enum mode_t mode;
+};
+
+class frame_exchange_t {
+private:
+	struct frame_t frames[3];
+	
+	/*
+	 * Index of the middle frame, with FRAME_FRESH set if it hasn't
+	 * been picked up by the consumer yet
+	 */
+	std::atomic<uint8_t> middle;
+	uint8_t back;
+	uint8_t front;
+public:
+	frame_exchange_t();
+	~frame_exchange_t();
+	
+	/*
+	 * Producer side (emulation thread)
+	 */
+	inline struct frame_t *back_frame() { return &frames[back]; }
+	void publish();
+	
+	/*
+	 * Consumer side (presentation thread), acquire() returns true if
+	 * a new frame became the front frame
+	 */
+	bool acquire();
+	inline struct frame_t *front_frame() { return &frames[front]; }
+};
+
+}
+
+#endif
@@ -5,6 +5,7 @@
  * Copyright © 2020-2023 elmerucr. All rights reserved.
  */
 
+#include <cstdarg>
 #include <cstdio>
 
 #include "host.hpp"
@@ -36,11 +37,23 @@ E64::host_t::host_t()
 	
 	settings = new settings_t();
 	video = new video_t();
+	audio = new audio_t();
+	
+	frames = new frame_exchange_t();
+	events = new event_queue_t();
+	
+	for (int i=0; i<128; i++) {
+		key_states[i] = 0;
+		key_masks[i] = false;
+	}
 }
 
 E64::host_t::~host_t()
 {
 	printf("[Host] closing E64\n");
+	delete events;
+	delete frames;
+	delete audio;
 	delete settings;
 	delete video;
 	
@@ -48,3 +61,36 @@ E64::host_t::~host_t()
 	
 	SDL_Quit();
 }
+
+void E64::host_t::post_notification(const char *format, ...)
+{
+	struct host_event_t event;
+	event.type = HOST_EVENT_NOTIFICATION;
+	
+	va_list args;
+	va_start(args, format);
+	vsnprintf(event.text, sizeof(event.text), format, args);
+	va_end(args);
+	
+	events->push(&event);
+}
+
+void E64::host_t::update_key_states(uint8_t *states)
+{
+	for (int i=0; i<128; i++) {
+		if (key_masks[i]) {
+			if (states[i] & 0b1) {
+				key_states[i] = 0;
+				continue;
+			}
+			key_masks[i] = false;
+		}
+		key_states[i] = states[i];
+	}
+}
+
+void E64::host_t::mask_key_until_released(uint8_t scancode)
+{
+	key_masks[scancode & 0x7f] = true;
+	key_states[scancode & 0x7f] = 0;
+}
@@ -10,6 +10,9 @@
 #ifndef HOST_HPP
 #define HOST_HPP
 
+#include "audio.hpp"
+#include "event_queue.hpp"
+#include "frame_exchange.hpp"
 #include "settings.hpp"
 #include "video.hpp"
 
@@ -25,6 +28,33 @@ public:
 	
 	settings_t *settings;
 	video_t *video;
+	audio_t *audio;
+	
+	/*
+	 * Emulation runs on its own thread. Completed frames go to the
+	 * presentation (main) thread, input and commands come back.
+	 */
+	frame_exchange_t *frames;
+	event_queue_t *events;
+	
+	/*
+	 * Presentation side, shows a notification in the hud
+	 */
+	void post_notification(const char *format, ...);
+	
+	/*
+	 * Emulation side, last known keyboard state of the host
+	 */
+	uint8_t key_states[128];
+	void update_key_states(uint8_t *states);
+	
+	/*
+	 * Emulation side, keeps a key released for the machine and hud
+	 * until it's actually released on the host
+	 */
+	void mask_key_until_released(uint8_t scancode);
+private:
+	bool key_masks[128];
 };
 
 }
@@ -6,6 +6,7 @@
  */
 
 #include <cstdio>
+#include <cstring>
 #include <thread>
 #include <chrono>
 #include <unistd.h>
@@ -21,15 +22,26 @@ double bytes_per_ms;
 const uint8_t *E64_sdl2_keyboard_state;
 
 
-uint8_t *E64::sdl2_keys_last_known_state;
+uint8_t E64::sdl2_keys_last_known_state[128];
+
+/*
+ * Key states are only sent to the emulation thread after a change
+ */
+static uint8_t keys_last_posted_state[128];
+static bool keys_post_pending = true;
+
+static void post_event(enum E64::host_event_type_t type, const char *text = nullptr)
+{
+	struct E64::host_event_t event;
+	event.type = type;
+	if (text) snprintf(event.text, sizeof(event.text), "%s", text);
+	if (!host.events->push(&event)) printf("[SDL] event queue full, dropping event\n");
+}
 
 uint8_t bytes_per_sample;
 
 void E64::sdl2_init()
 {
-	sdl2_keys_last_known_state = new uint8_t[128];
-	for (int i=0; i<128; i++) sdl2_keys_last_known_state[i] = 0;
-	
 	SDL_Init(SDL_INIT_AUDIO);
     
 	// each call to SDL_PollEvent invokes SDL_PumpEvents() that updates this array
@@ -114,9 +126,7 @@ enum E64::events_output_state E64::sdl2_process_events()
 					host.video->toggle_fullscreen();
 				} else if( (event.key.keysym.sym == SDLK_r) && alt_pressed ) {
 					E64::sdl2_wait_until_r_released();
-					machine.reset();
-					//hud.reset();
-					stats.reset();
+					post_event(HOST_EVENT_RESET);
 				} else if( (event.key.keysym.sym == SDLK_s) && alt_pressed ) {
 					//E64::sdl2_wait_until_s_released();
 					host.video->change_scanlines_intensity();
@@ -125,7 +135,7 @@ enum E64::events_output_state E64::sdl2_process_events()
 					return_value = QUIT_EVENT;
 				} else if ((event.key.keysym.sym == SDLK_w) && alt_pressed) {
 					// start/stop recording sound ('w' for wav)
-					machine.toggle_recording_sound();
+					post_event(HOST_EVENT_TOGGLE_RECORDING_SOUND);
 				} else if ((event.key.keysym.sym == SDLK_b) && alt_pressed) {
 					// toggle linear filtering vm hud
 					E64::sdl2_wait_until_b_released();
@@ -138,13 +148,16 @@ enum E64::events_output_state E64::sdl2_process_events()
 					// decrease screen size
 					E64::sdl2_wait_until_equals_released();
 					host.video->increase_window_size();
+				} else if ((event.key.keysym.sym == SDLK_t) && alt_pressed) {
+					// turbo mode on/off
+					E64::sdl2_wait_until_t_released();
+					post_event(HOST_EVENT_TOGGLE_TURBO);
 				} else if(event.key.keysym.sym == SDLK_F9) {
-					machine.flip_modes();
+					post_event(HOST_EVENT_FLIP_MODES);
 					//hud.overhead_visible = !hud.overhead_visible;
 					sdl2_wait_until_f9_released();
-					host.video->update_title();
 				} else if(event.key.keysym.sym == SDLK_F10) {
-					hud.toggle_stats();
+					post_event(HOST_EVENT_TOGGLE_STATS);
 					//hud.stats_visible = !hud.stats_visible;
 				}
 				break;
@@ -162,9 +175,9 @@ enum E64::events_output_state E64::sdl2_process_events()
 				 */
 				if (!chdir(event.drop.file)) {
 					strcpy(host.settings->working_dir, event.drop.file);
-					hud.show_notification("Working directory set to:\n%s", host.settings->working_dir);
+					host.post_notification("Working directory set to:\n%s", host.settings->working_dir);
 				} else {
-					machine.mmu->insert_binary(event.drop.file);
+					post_event(HOST_EVENT_INSERT_BINARY, event.drop.file);
 				}
 				SDL_free(event.drop.file);
 				break;
@@ -185,7 +198,7 @@ enum E64::events_output_state E64::sdl2_process_events()
 	    sdl2_keys_last_known_state[SCANCODE_F6] = E64_sdl2_keyboard_state[SDL_SCANCODE_F6] ? 0x01 : 0x00;
 	    sdl2_keys_last_known_state[SCANCODE_F7] = E64_sdl2_keyboard_state[SDL_SCANCODE_F7] ? 0x01 : 0x00;
 	    sdl2_keys_last_known_state[SCANCODE_F8] = E64_sdl2_keyboard_state[SDL_SCANCODE_F8] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_GRAVE] = (machine.cia->registers[SCANCODE_GRAVE] << 1) | (E64_sdl2_keyboard_state[SDL_SCANCODE_GRAVE] ? 0x01 : 0x00);
+	    sdl2_keys_last_known_state[SCANCODE_GRAVE] = E64_sdl2_keyboard_state[SDL_SCANCODE_GRAVE] ? 0x01 : 0x00;
 	    sdl2_keys_last_known_state[SCANCODE_1] = E64_sdl2_keyboard_state[SDL_SCANCODE_1] ? 0x01 : 0x00;
 	    sdl2_keys_last_known_state[SCANCODE_2] = E64_sdl2_keyboard_state[SDL_SCANCODE_2] ? 0x01 : 0x00;
 	    sdl2_keys_last_known_state[SCANCODE_3] = E64_sdl2_keyboard_state[SDL_SCANCODE_3] ? 0x01 : 0x00;
@@ -245,23 +258,20 @@ enum E64::events_output_state E64::sdl2_process_events()
 	    sdl2_keys_last_known_state[SCANCODE_DOWN] = E64_sdl2_keyboard_state[SDL_SCANCODE_DOWN] ? 0x01 : 0x00;
 	    sdl2_keys_last_known_state[SCANCODE_RIGHT] = E64_sdl2_keyboard_state[SDL_SCANCODE_RIGHT] ? 0x01 : 0x00;
 	}
+	
+	if (keys_post_pending || memcmp(keys_last_posted_state, sdl2_keys_last_known_state, 128)) {
+		struct host_event_t event;
+		event.type = HOST_EVENT_KEY_STATES;
+		memcpy(event.key_states, sdl2_keys_last_known_state, 128);
+		keys_post_pending = !host.events->push(&event);
+		memcpy(keys_last_posted_state, sdl2_keys_last_known_state, 128);
+	}
+	
 	if (return_value == QUIT_EVENT)
 		printf("[SDL] detected quit event\n");
 	return return_value;
 }
 
-void E64::sdl2_wait_until_enter_released()
-{
-	SDL_Event event;
-	bool wait = true;
-	while (wait) {
-		SDL_PollEvent(&event);
-		if ((event.type == SDL_KEYUP) && (event.key.keysym.sym == SDLK_RETURN))
-			wait = false;
-		std::this_thread::sleep_for(std::chrono::microseconds(40000));
-	}
-}
-
 void E64::sdl2_wait_until_f9_released()
 {
     SDL_Event event;
@@ -352,6 +362,17 @@ void E64::sdl2_wait_until_equals_released()
     }
 }
 
+void E64::sdl2_wait_until_t_released()
+{
+    SDL_Event event;
+    bool wait = true;
+    while(wait) {
+	SDL_PollEvent(&event);
+	if( (event.type == SDL_KEYUP) && (event.key.keysym.sym == SDLK_t) ) wait = false;
+	std::this_thread::sleep_for(std::chrono::microseconds(40000));
+    }
+}
+
 void E64::sdl2_queue_audio(void *buffer, unsigned size)
 {
     SDL_QueueAudio(E64_sdl2_audio_dev, buffer, size);
@@ -393,7 +414,6 @@ void E64::sdl2_cleanup()
 	E64::sdl2_stop_audio();
 	SDL_CloseAudioDevice(E64_sdl2_audio_dev);
 	//SDL_Quit();
-	delete sdl2_keys_last_known_state;
 }
 
 uint8_t E64::sdl2_bytes_per_sample()
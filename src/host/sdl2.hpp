@@ -22,11 +22,10 @@ void sdl2_init();
 void sdl2_cleanup();
 
 // key states
-extern uint8_t *sdl2_keys_last_known_state;
+extern uint8_t sdl2_keys_last_known_state[];
 
 // event related
 enum events_output_state sdl2_process_events();
-void sdl2_wait_until_enter_released();
 void sdl2_wait_until_f_released();
 void sdl2_wait_until_q_released();
 void sdl2_wait_until_f9_released();
@@ -35,6 +34,7 @@ void sdl2_wait_until_s_released();
 void sdl2_wait_until_b_released();
 void sdl2_wait_until_minus_released();
 void sdl2_wait_until_equals_released();
+void sdl2_wait_until_t_released();
 
 // audio related
 void		sdl2_start_audio();
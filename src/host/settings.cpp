@@ -13,9 +13,50 @@
 #include <unistd.h>
 #include "common.hpp"
 
+const char *E64::profile_preset_names[PROFILE_PRESETS] = {
+	"balanced", "low-latency", "throughput", "low-power"
+};
+
+static const char *profile_parameter_names[E64::PROFILE_PARAMETERS] = {
+	"cycles_per_step", "audio_buffer_size", "sid_sampling", "run_ahead", "frameskip", "present_poll_time"
+};
+
+static const char *sid_sampling_names[3] = { "fast", "interpolate", "resample" };
+
+/*
+ * Low latency polls input more often, keeps a small audio queue and
+ * runs one frame ahead. Throughput runs long steps and skips frames
+ * sooner. Low power runs long steps and lets the presentation thread
+ * sleep longer.
+ */
+static const uint32_t profile_presets[E64::PROFILE_PRESETS][E64::PROFILE_PARAMETERS] = {
+	{  511, 10000, 0, 0, FRAMESKIP_MAX,  1000 },	// balanced
+	{  128,  4000, 0, 1, FRAMESKIP_MAX,   250 },	// low-latency
+	{ 4096, 16000, 0, 0, 8,              1000 },	// throughput
+	{ 2048, 16000, 0, 0, FRAMESKIP_MAX,  4000 }	// low-power
+};
+
+static const uint32_t profile_minimum[E64::PROFILE_PARAMETERS] = {    16,  1000, 0, 0, 1, 0 };
+static const uint32_t profile_maximum[E64::PROFILE_PARAMETERS] = { 65535, 65536, 2, RUN_AHEAD_MAX_FRAMES, 64, 100000 };
+
 E64::settings_t::settings_t()
 {
 	use_custom_rom = false; // default setting
+	record_input_path = nullptr;
+	replay_input_path = nullptr;
+	load_state_path = nullptr;
+	state_hashes_path = nullptr;
+	rewind_seconds = REWIND_SECONDS;
+	run_ahead_frames = 0;
+	turbo = false;
+	turbo_render_interval = TURBO_RENDER_INTERVAL;
+	frameskip_max = FRAMESKIP_MAX;
+	coprocessor = false;
+	block_cache = false;
+	jit = false;
+	hle = false;
+	slow_frame_log_path = nullptr;
+	slow_frame_budget = SLOW_FRAME_BUDGET;
 	
 	snprintf(home_dir, 256, "%s", getenv("HOME"));
 	printf("[Settings] User home directory: %s\n", home_dir);
@@ -130,6 +171,35 @@ E64::settings_t::settings_t()
 //	}
 	scanlines_linear_filtering_at_init = true;	// always
 	
+	/*
+	 * Cpu clock as a multiple of the standard speed, or "unlimited"
+	 */
+	lua_getglobal(L, "cpu_clock");
+	if (lua_isinteger(L, -1) && (lua_tointeger(L, -1) >= 1) && (lua_tointeger(L, -1) <= CPU_CLOCK_MULTIPLIER_MAX)) {
+		cpu_clock_multiplier_at_init = lua_tointeger(L, -1);
+	} else if (lua_isstring(L, -1) && (strcmp(lua_tostring(L, -1), "unlimited") == 0)) {
+		cpu_clock_multiplier_at_init = CPU_CLOCK_MULTIPLIER_MAX;
+	} else {
+		cpu_clock_multiplier_at_init = 1;
+	}
+	
+	/*
+	 * Floating point unit, "none", "fast" or "exact"
+	 */
+	fpu_mode_at_init = FPU_MODE_NONE;
+	lua_getglobal(L, "fpu");
+	if (lua_isstring(L, -1)) {
+		for (int i = 0; i < FPU_MODES; i++) {
+			if (strcmp(lua_tostring(L, -1), fpu_mode_names[i]) == 0) fpu_mode_at_init = i;
+		}
+	}
+	
+	lua_getglobal(L, "coprocessor");
+	coprocessor_in_settings = lua_isboolean(L, -1) && lua_toboolean(L, -1);
+	coprocessor = coprocessor_in_settings;
+	
+	read_profile();
+	
 	lua_close(L);
 	
 	/*
@@ -163,11 +233,72 @@ E64::settings_t::~settings_t()
 
 void E64::settings_t::process_command_line_arguments(int argc, char **argv)
 {
+	/*
+	 * A profile first, other arguments override its parameters
+	 */
+	for (int i = 1; i < argc - 1; i++) {
+		if (strcmp(argv[i], "-profile") == 0) {
+			if (!select_profile(argv[i + 1]))
+				printf("[Settings] Unknown profile %s\n", argv[i + 1]);
+			apply_profile();
+		}
+	}
+	
 	if (argc > 1) {
 		// process arguments
 		for (int i = 1; i < argc; i++) {
 			if (strcmp(argv[i], "-cr") == 0) {
 				use_custom_rom = true;
+			} else if ((strcmp(argv[i], "-record") == 0) && (i + 1 < argc)) {
+				record_input_path = argv[++i];
+			} else if ((strcmp(argv[i], "-replay") == 0) && (i + 1 < argc)) {
+				replay_input_path = argv[++i];
+			} else if ((strcmp(argv[i], "-load") == 0) && (i + 1 < argc)) {
+				load_state_path = argv[++i];
+			} else if ((strcmp(argv[i], "-hashes") == 0) && (i + 1 < argc)) {
+				state_hashes_path = argv[++i];
+			} else if ((strcmp(argv[i], "-rewind") == 0) && (i + 1 < argc)) {
+				rewind_seconds = atoi(argv[++i]);
+			} else if ((strcmp(argv[i], "-runahead") == 0) && (i + 1 < argc)) {
+				int frames = atoi(argv[++i]);
+				if (frames < 0)
+					frames = 0;
+				if (frames > RUN_AHEAD_MAX_FRAMES)
+					frames = RUN_AHEAD_MAX_FRAMES;
+				run_ahead_frames = frames;
+			} else if ((strcmp(argv[i], "-turbo") == 0) && (i + 1 < argc)) {
+				turbo = true;
+				turbo_render_interval = atoi(argv[++i]);
+				if (turbo_render_interval == 0)
+					turbo_render_interval = 1;
+			} else if ((strcmp(argv[i], "-frameskip") == 0) && (i + 1 < argc)) {
+				frameskip_max = atoi(argv[++i]);
+				if (frameskip_max == 0)
+					frameskip_max = 1;
+			} else if (strcmp(argv[i], "-coprocessor") == 0) {
+				coprocessor = true;
+			} else if (strcmp(argv[i], "-blockcache") == 0) {
+				block_cache = true;
+			} else if (strcmp(argv[i], "-jit") == 0) {
+				block_cache = jit = true;
+			} else if (strcmp(argv[i], "-hle") == 0) {
+				hle = true;
+			} else if ((strcmp(argv[i], "-fpu") == 0) && (i + 1 < argc)) {
+				i++;
+				bool known = false;
+				for (int j = 0; j < FPU_MODES; j++) {
+					if (strcmp(argv[i], fpu_mode_names[j]) == 0) {
+						fpu_mode_at_init = j;
+						known = true;
+					}
+				}
+				if (!known) printf("[Settings] Unknown fpu mode %s\n", argv[i]);
+			} else if ((strcmp(argv[i], "-slowframes") == 0) && (i + 1 < argc)) {
+				slow_frame_log_path = argv[++i];
+			} else if ((strcmp(argv[i], "-slowbudget") == 0) && (i + 1 < argc)) {
+				slow_frame_budget = 1000 * atof(argv[++i]);
+			} else if ((strcmp(argv[i], "-profile") == 0) && (i + 1 < argc)) {
+				i++;
 			}
 		}
 	}
@@ -217,6 +348,21 @@ void E64::settings_t::write_settings()
 			fwrite("\nhud_linear_filtering = false", 1, 29, temp_file);
 		}
 		
+		if (machine.get_cpu_clock_multiplier() == CPU_CLOCK_MULTIPLIER_MAX) {
+			number_of_chars = snprintf(buffer, 64, "\ncpu_clock = \"unlimited\"");
+		} else {
+			number_of_chars = snprintf(buffer, 64, "\ncpu_clock = %u", machine.get_cpu_clock_multiplier());
+		}
+		fwrite(buffer, 1, number_of_chars, temp_file);
+		
+		number_of_chars = snprintf(buffer, 64, "\ncoprocessor = %s", coprocessor_in_settings ? "true" : "false");
+		fwrite(buffer, 1, number_of_chars, temp_file);
+		
+		number_of_chars = snprintf(buffer, 64, "\nfpu = \"%s\"", fpu_mode_names[machine.get_fpu_mode()]);
+		fwrite(buffer, 1, number_of_chars, temp_file);
+		
+		write_profile(temp_file);
+		
 		fclose(temp_file);
 	}
 }
@@ -267,3 +413,89 @@ void E64::settings_t::finish_wav()
 		fclose(wav_file);
 	}
 }
+
+bool E64::settings_t::select_profile(const char *name)
+{
+	for (int i = 0; i < PROFILE_PRESETS; i++) {
+		if (strcmp(name, profile_preset_names[i]) == 0) {
+			profile_preset = (enum profile_preset_t)i;
+			for (int j = 0; j < PROFILE_PARAMETERS; j++) {
+				if (!profile_overridden[j]) profile[j] = profile_presets[i][j];
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void E64::settings_t::apply_profile()
+{
+	cycles_per_step = profile[PROFILE_CYCLES_PER_STEP];
+	audio_buffer_size = profile[PROFILE_AUDIO_BUFFER_SIZE];
+	sid_sampling = profile[PROFILE_SID_SAMPLING];
+	run_ahead_frames = profile[PROFILE_RUN_AHEAD_FRAMES];
+	frameskip_max = profile[PROFILE_FRAMESKIP_MAX];
+	present_poll_time = profile[PROFILE_PRESENT_POLL_TIME];
+}
+
+bool E64::settings_t::profile_customized()
+{
+	uint32_t in_use[PROFILE_PARAMETERS] = {
+		cycles_per_step, audio_buffer_size, sid_sampling, run_ahead_frames, frameskip_max, present_poll_time
+	};
+	
+	for (int i = 0; i < PROFILE_PARAMETERS; i++) {
+		if (in_use[i] != profile_presets[profile_preset][i]) return true;
+	}
+	return false;
+}
+
+void E64::settings_t::read_profile()
+{
+	for (int i = 0; i < PROFILE_PARAMETERS; i++) profile_overridden[i] = false;
+	
+	profile_preset = PROFILE_BALANCED;
+	lua_getglobal(L, "profile");
+	if (lua_isstring(L, -1) && !select_profile(lua_tostring(L, -1))) {
+		printf("[Settings] Unknown profile %s, using %s\n", lua_tostring(L, -1), profile_preset_names[PROFILE_BALANCED]);
+	}
+	select_profile(profile_preset_names[profile_preset]);
+	
+	/*
+	 * Single parameters, out of range values are clamped
+	 */
+	for (int i = 0; i < PROFILE_PARAMETERS; i++) {
+		lua_getglobal(L, profile_parameter_names[i]);
+		if (lua_isinteger(L, -1)) {
+			int64_t value = lua_tointeger(L, -1);
+			if (value < profile_minimum[i]) value = profile_minimum[i];
+			if (value > profile_maximum[i]) value = profile_maximum[i];
+			profile[i] = value;
+			profile_overridden[i] = true;
+		} else if ((i == PROFILE_SID_SAMPLING) && lua_isstring(L, -1)) {
+			for (int j = 0; j < 3; j++) {
+				if (strcmp(lua_tostring(L, -1), sid_sampling_names[j]) == 0) {
+					profile[i] = j;
+					profile_overridden[i] = true;
+				}
+			}
+		}
+	}
+	
+	apply_profile();
+	printf("[Settings] Performance profile: %s%s\n", profile_preset_names[profile_preset], profile_customized() ? " (customized)" : "");
+}
+
+void E64::settings_t::write_profile(FILE *f)
+{
+	fprintf(f, "\nprofile = \"%s\"", profile_preset_names[profile_preset]);
+	
+	for (int i = 0; i < PROFILE_PARAMETERS; i++) {
+		if (!profile_overridden[i]) continue;
+		if (i == PROFILE_SID_SAMPLING) {
+			fprintf(f, "\n%s = \"%s\"", profile_parameter_names[i], sid_sampling_names[profile[i]]);
+		} else {
+			fprintf(f, "\n%s = %u", profile_parameter_names[i], profile[i]);
+		}
+	}
+}
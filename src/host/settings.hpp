@@ -15,6 +15,31 @@
 
 namespace E64 {
 
+/*
+ * Performance profile, a named preset of parameters that trade latency
+ * against throughput and host load. settings.lua selects a preset and
+ * may override single parameters.
+ */
+enum profile_parameter_t {
+	PROFILE_CYCLES_PER_STEP,	// cpu cycles between host input checks
+	PROFILE_AUDIO_BUFFER_SIZE,	// target size of the host audio queue
+	PROFILE_SID_SAMPLING,		// 0 fast, 1 interpolate, 2 resample
+	PROFILE_RUN_AHEAD_FRAMES,
+	PROFILE_FRAMESKIP_MAX,
+	PROFILE_PRESENT_POLL_TIME,	// microseconds the presentation thread sleeps without a new frame
+	PROFILE_PARAMETERS
+};
+
+enum profile_preset_t {
+	PROFILE_BALANCED,
+	PROFILE_LOW_LATENCY,
+	PROFILE_THROUGHPUT,
+	PROFILE_LOW_POWER,
+	PROFILE_PRESETS
+};
+
+extern const char *profile_preset_names[PROFILE_PRESETS];
+
 struct wav_header_t {
 	/*
 	 * The "RIFF" chunk descriptor (12 bytes)
@@ -55,6 +80,14 @@ private:
 	 * Lua virtual machine for reading settings file settings.lua
 	 */
 	lua_State *L;
+	
+	/*
+	 * Parameters given in settings.lua itself, these are written back
+	 */
+	bool profile_overridden[PROFILE_PARAMETERS];
+	bool coprocessor_in_settings;
+	void read_profile();
+	void write_profile(FILE *f);
 public:
 	settings_t();
 	~settings_t();
@@ -67,11 +100,45 @@ public:
 	
 	bool fullscreen_at_init;
 	bool use_custom_rom;
+	const char *record_input_path;
+	const char *replay_input_path;
+	const char *load_state_path;
+	const char *state_hashes_path;
+	uint32_t rewind_seconds;
+	uint8_t run_ahead_frames;
+	bool turbo;
+	uint16_t turbo_render_interval;
+	uint16_t frameskip_max;
+	bool coprocessor;
+	bool block_cache;
+	bool jit;
+	bool hle;
+	
+	/*
+	 * Active profile, parameters in profile[] as read from settings
+	 * and -profile. apply_profile() copies them to the fields that
+	 * are in use, where other command line arguments may still change
+	 * them. Customized means these differ from the preset.
+	 */
+	enum profile_preset_t profile_preset;
+	uint32_t profile[PROFILE_PARAMETERS];
+	bool select_profile(const char *name);
+	void apply_profile();
+	bool profile_customized();
+	
+	uint16_t cycles_per_step;
+	uint32_t audio_buffer_size;
+	uint8_t sid_sampling;
+	uint16_t present_poll_time;
+	const char *slow_frame_log_path;
+	uint32_t slow_frame_budget;
 	char working_dir[256];
 	bool vm_linear_filtering_at_init;
 	bool hud_linear_filtering_at_init;
 	bool scanlines_linear_filtering_at_init;
 	uint8_t scanlines_alpha_at_init;
+	uint8_t cpu_clock_multiplier_at_init;
+	uint8_t fpu_mode_at_init;	// see fpu_mode_t in machine.hpp
 	
 	bool create_wav();
 	
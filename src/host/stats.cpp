@@ -20,6 +20,9 @@ void E64::stats_t::reset()
 	total_vm_time = 0;
 	total_textures_time = 0;
 	total_idle_time = 0;
+	total_run_ahead_time = 0;
+	frame_vm_time = 0;
+	frame_run_ahead_time = 0;
 	
 	framecounter = 0;
 	framecounter_interval = 4;
@@ -34,9 +37,13 @@ void E64::stats_t::reset()
 	smoothed_cpu_mhz = CPU_CLOCK_SPEED/(1000*1000);
 	old_cpu_ticks = machine.m68k->getClock();
 	
+	idle_cycles_skipped = old_idle_cycles = machine.idle_cycles();
+	smoothed_idle_skipped_percentage = 0;
+	
 	smoothed_vm_per_frame = 1000000 / (FPS * 3);
 	smoothed_textures_per_frame = 1000000 / (FPS * 3);
 	smoothed_idle_per_frame = 1000000 / (FPS * 3);
+	smoothed_run_ahead_per_frame = 0;
 	
 	cpu_percentage = 100 * (smoothed_vm_per_frame + smoothed_textures_per_frame) / (1000000 / FPS);
     
@@ -44,6 +51,8 @@ void E64::stats_t::reset()
 	alpha_cpu = 0.50f;
 	
 	frametime = 1000000 / FPS;
+	
+	frameskip_interval = 1;
 
 	start_vm = start_vm_old = std::chrono::steady_clock::now();
 }
@@ -71,8 +80,20 @@ void E64::stats_t::process_parameters()
 		smoothed_cpu_mhz =
 			(alpha_cpu * smoothed_cpu_mhz) +
 			((1.0 - alpha_cpu) * cpu_mhz);
+		
+		/*
+		 * idle cycles skipped
+		 */
+		idle_cycles_skipped = machine.idle_cycles();
+		idle_skipped_percentage = delta_cpu_ticks ?
+			100.0 * (idle_cycles_skipped - old_idle_cycles) / delta_cpu_ticks : 0;
+		old_idle_cycles = idle_cycles_skipped;
+		smoothed_idle_skipped_percentage =
+			(alpha_cpu * smoothed_idle_skipped_percentage) +
+			((1.0 - alpha_cpu) * idle_skipped_percentage);
         
-		vm_per_frame = total_vm_time / framecounter_interval;
+		vm_per_frame = (total_vm_time - total_run_ahead_time) / framecounter_interval;
+		run_ahead_per_frame = total_run_ahead_time / framecounter_interval;
 		textures_per_frame = total_textures_time / framecounter_interval;
 		idle_per_frame = total_idle_time / framecounter_interval;
 		
@@ -88,9 +109,13 @@ void E64::stats_t::process_parameters()
 			(alpha * smoothed_idle_per_frame) +
 			((1.0 - alpha) * idle_per_frame);
 		
-		cpu_percentage = 100 * (smoothed_vm_per_frame + smoothed_textures_per_frame) / (smoothed_vm_per_frame + smoothed_textures_per_frame + smoothed_idle_per_frame);
+		smoothed_run_ahead_per_frame =
+			(alpha * smoothed_run_ahead_per_frame) +
+			((1.0 - alpha) * run_ahead_per_frame);
+		
+		cpu_percentage = 100 * (smoothed_vm_per_frame + smoothed_run_ahead_per_frame + smoothed_textures_per_frame) / (smoothed_vm_per_frame + smoothed_run_ahead_per_frame + smoothed_textures_per_frame + smoothed_idle_per_frame);
         
-		total_time = total_vm_time = total_textures_time = total_idle_time = 0;
+		total_time = total_vm_time = total_textures_time = total_idle_time = total_run_ahead_time = 0;
 	}
 
 	status_bar_framecounter++;
@@ -98,16 +123,65 @@ void E64::stats_t::process_parameters()
 	if (status_bar_framecounter == status_bar_framecounter_interval) {
 		status_bar_framecounter = 0;
 		
-		snprintf(statistics_string, 256, "         cpu speed: %6.2f MHz          vm/hud: %5.2f ms\n"
-						 "    screen refresh: %6.2f fps  texture update: %5.2f ms\n"
+		adapt_frameskip();
+		
+		/*
+		 * Speed relative to real time, and the fraction of frames
+		 * drawn (turbo mode or frame skipping)
+		 */
+		char drawn_string[8];
+		if (machine.get_render_interval() > 1) {
+			snprintf(drawn_string, 8, "1/%u", machine.get_render_interval());
+		} else {
+			snprintf(drawn_string, 8, "all");
+		}
+		
+		/*
+		 * Performance profile, marked when parameters differ from
+		 * its preset
+		 */
+		char profile_string[16];
+		snprintf(profile_string, 16, "%s%s", E64::profile_preset_names[host.settings->profile_preset],
+			 host.settings->profile_customized() ? "*" : "");
+		
+		snprintf(statistics_string, 512, "         cpu speed: %6.2f MHz          vm/hud: %5.2f ms\n"
+						 "    screen refresh: %6.2f fps   frame handoff: %5.2f ms\n"
 						 "       soundbuffer: %6.2f kb             idle: %5.2f ms\n"
-						 "          host cpu: %6.2f %%             total: %5.2f ms",
+						 "          host cpu: %6.2f %%             total: %5.2f ms\n"
+						 "      idle skipped: %6.2f %%         run-ahead: %5.2f ms\n"
+						 "             speed: %6.2f x      frames drawn: %5s\n"
+						 "           profile: %-12s  step %5u  audio %5u",
 						 smoothed_cpu_mhz, smoothed_vm_per_frame/1000,
 						 smoothed_framerate, smoothed_textures_per_frame/1000,
 						 audio_queue_size_bytes/1024, smoothed_idle_per_frame/1000,
 						 cpu_percentage,
-						 (smoothed_vm_per_frame+smoothed_textures_per_frame+smoothed_idle_per_frame)/1000);
+						 (smoothed_vm_per_frame+smoothed_run_ahead_per_frame+smoothed_textures_per_frame+smoothed_idle_per_frame)/1000,
+						 smoothed_idle_skipped_percentage, smoothed_run_ahead_per_frame/1000,
+						 smoothed_framerate / FPS, drawn_string,
+						 profile_string, host.settings->cycles_per_step, machine.get_audio_buffer_size());
 	}
 	
 	audio_queue_size_bytes = E64::sdl2_get_queued_audio_size_bytes();
 }
+
+void E64::stats_t::adapt_frameskip()
+{
+	/*
+	 * Only meaningful for a running machine that's throttled
+	 */
+	if ((machine.mode != E64::RUNNING) || host.settings->turbo) return;
+	
+	/*
+	 * Skip more frames when there's hardly any idle time left in
+	 * the frame budget, draw more when there's plenty. The margin
+	 * in between avoids flipping back and forth, as skipped frames
+	 * are cheaper.
+	 */
+	if ((smoothed_idle_per_frame < frametime / 16) && (frameskip_interval < host.settings->frameskip_max)) {
+		frameskip_interval++;
+	} else if ((smoothed_idle_per_frame > frametime / 3) && (frameskip_interval > 1)) {
+		frameskip_interval--;
+	}
+	
+	if (frameskip_interval > host.settings->frameskip_max) frameskip_interval = host.settings->frameskip_max;
+}
@@ -21,11 +21,19 @@ private:
 	std::chrono::time_point<std::chrono::steady_clock> start_vm_old;
 	std::chrono::time_point<std::chrono::steady_clock> start_update_textures;
 	std::chrono::time_point<std::chrono::steady_clock> start_idle;
+	std::chrono::time_point<std::chrono::steady_clock> start_run_ahead;
 	
 	int64_t total_time;
 	int64_t total_vm_time;
 	int64_t total_textures_time;
 	int64_t total_idle_time;
+	int64_t total_run_ahead_time;
+	
+	/*
+	 * Of the last frame only, in microseconds
+	 */
+	uint32_t frame_vm_time;
+	uint32_t frame_run_ahead_time;
 
 	uint8_t framecounter;               // keeps track of no of frames since last evaluation
 	uint8_t framecounter_interval;      // amount of frames between two evaluations
@@ -44,6 +52,14 @@ private:
 	uint64_t old_cpu_ticks;
 	uint64_t delta_cpu_ticks;
 	double smoothed_cpu_mhz;
+	
+	/*
+	 * Cycles the machine skipped while waiting for an interrupt
+	 */
+	uint64_t idle_cycles_skipped;
+	uint64_t old_idle_cycles;
+	double idle_skipped_percentage;
+	double smoothed_idle_skipped_percentage;
 
 	double audio_queue_size_bytes;
 	//double smoothed_audio_queue_size_bytes;
@@ -54,10 +70,19 @@ private:
 	double smoothed_textures_per_frame;
 	double idle_per_frame;
 	double smoothed_idle_per_frame;
+	double run_ahead_per_frame;
+	double smoothed_run_ahead_per_frame;
 	
 	double cpu_percentage;
+	
+	/*
+	 * Automatic frame skipping, only one in frameskip_interval
+	 * frames is drawn when the host can't keep up
+	 */
+	uint16_t frameskip_interval;
+	void adapt_frameskip();
     
-	char statistics_string[256];
+	char statistics_string[512];
     
 public:
 	void reset();
@@ -75,7 +100,24 @@ public:
 	inline void start_update_textures_time()
 	{
 		start_update_textures = std::chrono::steady_clock::now();
-		total_vm_time += std::chrono::duration_cast<std::chrono::microseconds>(start_update_textures - start_vm).count();
+		int64_t vm_time = std::chrono::duration_cast<std::chrono::microseconds>(start_update_textures - start_vm).count();
+		total_vm_time += vm_time;
+		frame_vm_time = vm_time - frame_run_ahead_time;
+	}
+	
+	/*
+	 * Running ahead happens within vm time, but is accounted for
+	 * separately
+	 */
+	inline void start_run_ahead_time()
+	{
+		start_run_ahead = std::chrono::steady_clock::now();
+	}
+	
+	inline void end_run_ahead_time()
+	{
+		frame_run_ahead_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_run_ahead).count();
+		total_run_ahead_time += frame_run_ahead_time;
 	}
 	
 	inline void start_idle_time()
@@ -91,6 +133,14 @@ public:
 	inline double current_smoothed_framerate() { return smoothed_framerate; }
 	inline double current_audio_queue_size()   { return audio_queue_size_bytes; }
 	inline char   *summary()                   { return statistics_string; }
+	inline uint64_t idle_cycles()              { return idle_cycles_skipped; }
+	inline uint16_t frameskip()                { return frameskip_interval; }
+	
+	/*
+	 * Vm time of the last frame without running ahead, valid after
+	 * start_update_textures_time()
+	 */
+	inline uint32_t last_frame_vm_time()       { return frame_vm_time; }
 };
 
 }
@@ -31,6 +31,10 @@ E64::video_t::video_t()
 	 * Start with windowed screen
 	 */
 	fullscreen = false;
+	
+	mode = RUNNING;
+	screen_size = { 0, 0, VM_MAX_PIXELS_PER_SCANLINE, VM_MAX_SCANLINES };
+	scanline_screen_size = { 0, 0, VM_MAX_PIXELS_PER_SCANLINE, 4 * VM_MAX_SCANLINES };
 
 	/*
 	 * Create window - title will be set later on by update_title()
@@ -207,10 +211,28 @@ void E64::video_t::create_scanlines_texture(bool linear_filtering)
 		VM_MAX_PIXELS_PER_SCANLINE * sizeof(uint16_t));
 }
 
-void E64::video_t::update_textures()
+void E64::video_t::update_textures(struct frame_t *frame)
 {
-	SDL_UpdateTexture(vm_texture, NULL, machine.blitter->fb, VM_MAX_PIXELS_PER_SCANLINE * sizeof(uint16_t));
-	SDL_UpdateTexture(hud_texture, NULL, hud.blitter->fb, HUD_PIXELS_PER_SCANLINE * sizeof(uint16_t));
+	SDL_UpdateTexture(vm_texture, NULL, frame->vm_fb, VM_MAX_PIXELS_PER_SCANLINE * sizeof(uint16_t));
+	SDL_UpdateTexture(hud_texture, NULL, frame->hud_fb, HUD_PIXELS_PER_SCANLINE * sizeof(uint16_t));
+	
+	screen_size = {
+		frame->screen_size.x,
+		frame->screen_size.y,
+		frame->screen_size.w,
+		frame->screen_size.h
+	};
+	scanline_screen_size = {
+		frame->scanline_screen_size.x,
+		frame->scanline_screen_size.y,
+		frame->scanline_screen_size.w,
+		frame->scanline_screen_size.h
+	};
+	
+	if (frame->mode != mode) {
+		mode = frame->mode;
+		update_title();
+	}
 }
 
 void E64::video_t::update_screen()
@@ -218,9 +240,9 @@ void E64::video_t::update_screen()
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 	SDL_RenderClear(renderer);
 	
-	SDL_RenderCopy(renderer, vm_texture, &machine.blitter->screen_size, NULL);
+	SDL_RenderCopy(renderer, vm_texture, &screen_size, NULL);
 	SDL_SetTextureAlphaMod(scanlines_texture, scanlines_alpha);
-	SDL_RenderCopy(renderer, scanlines_texture, &machine.blitter->scanline_screen_size, NULL);
+	SDL_RenderCopy(renderer, scanlines_texture, &scanline_screen_size, NULL);
 	
 	SDL_RenderCopy(renderer, hud_texture, NULL, NULL);
 
@@ -234,7 +256,7 @@ void E64::video_t::increase_window_size()
 			  window_sizes[current_window_size].y);
 	SDL_GetWindowSize(window, &window_width, &window_height);
 	SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
-	hud.show_notification("Set host window size to %ix%i", window_width, window_height);
+	host.post_notification("Set host window size to %ix%i", window_width, window_height);
 }
 
 void E64::video_t::decrease_window_size()
@@ -244,7 +266,7 @@ void E64::video_t::decrease_window_size()
 			  window_sizes[current_window_size].y);
 	SDL_GetWindowSize(window, &window_width, &window_height);
 	SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
-	hud.show_notification("Set host window size to %ix%i", window_width, window_height);
+	host.post_notification("Set host window size to %ix%i", window_width, window_height);
 }
 
 void E64::video_t::toggle_fullscreen()
@@ -256,7 +278,7 @@ void E64::video_t::toggle_fullscreen()
 		SDL_SetWindowFullscreen(window, SDL_WINDOW_RESIZABLE);
 	}
 	SDL_GetWindowSize(window, &window_width, &window_height);
-	hud.show_notification("Switched to %s mode with size %ix%i",
+	host.post_notification("Switched to %s mode with size %ix%i",
 			      fullscreen ? "fullscreen" : "window",
 			      window_width,
 			      window_height);
@@ -264,7 +286,7 @@ void E64::video_t::toggle_fullscreen()
 
 void E64::video_t::update_title()
 {
-	if (machine.mode == E64::PAUSED) {
+	if (mode == E64::PAUSED) {
 		SDL_SetWindowTitle(window, "E64 Debug Mode");
 		// TODO: ?
 		//SDL_SetWindowIcon(SDL_Window *window, SDL_Surface *icon);
@@ -288,21 +310,21 @@ void E64::video_t::change_scanlines_intensity()
 	} else {
 		scanlines_alpha = 0;
 	}
-	hud.show_notification("                 scanlines alpha = %3u/255", scanlines_alpha);
+	host.post_notification("                 scanlines alpha = %3u/255", scanlines_alpha);
 }
 
 void E64::video_t::toggle_linear_filtering()
 {
-	switch (machine.mode) {
+	switch (mode) {
 		case E64::RUNNING:
 			vm_linear_filtering = !vm_linear_filtering;
 			create_vm_texture(vm_linear_filtering);
-			hud.show_notification("                   vm linear filtering = %s", vm_linear_filtering ? "on" : "off");
+			host.post_notification("                   vm linear filtering = %s", vm_linear_filtering ? "on" : "off");
 			break;
 		case E64::PAUSED:
 			hud_linear_filtering = !hud_linear_filtering;
 			create_hud_texture(hud_linear_filtering);
-			hud.show_notification("                  hud linear filtering = %s", hud_linear_filtering ? "on" : "off");
+			host.post_notification("                  hud linear filtering = %s", hud_linear_filtering ? "on" : "off");
 			break;
 		default:
 			break;
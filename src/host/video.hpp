@@ -10,6 +10,8 @@
 #ifndef VIDEO_HPP
 #define VIDEO_HPP
 
+#include "frame_exchange.hpp"
+
 namespace E64 {
 
 struct window_size {
@@ -49,6 +51,13 @@ private:
 	
 	uint16_t *scanline_buffer;
 	
+	/*
+	 * Taken from the last frame handed over
+	 */
+	SDL_Rect screen_size;
+	SDL_Rect scanline_screen_size;
+	enum mode_t mode;
+	
 	void create_vm_texture(bool linear_filtering);
 	void create_hud_texture(bool linear_filtering);
 	void create_scanlines_texture(bool linear_filtering);
@@ -62,7 +71,7 @@ public:
 	video_t();
 	~video_t();
 	
-	void update_textures();
+	void update_textures(struct frame_t *frame);
 	void update_screen();
 	void update_title();
 	void increase_window_size();
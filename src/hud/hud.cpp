@@ -7,7 +7,6 @@
 
 #include "hud.hpp"
 #include "common.hpp"
-#include "sdl2.hpp"
 
 char text_buffer[2048];
 
@@ -50,11 +49,11 @@ E64::hud_t::hud_t()
 	printf("[HUD] heads up display constructor\n");
 	TTL74LS148 = new TTL74LS148_ic();
 	blitter = new blitter_ic(HUD_PIXELS_PER_SCANLINE, HUD_SCANLINES);
-	cia = new cia_ic();
+	cia = new cia_ic(host.key_states);
 	timer = new timer_ic(TTL74LS148);
 	
 	stats_view = &blitter->blit[0];
-	blitter->terminal_init(stats_view->number, 0x1a, 0x00, 1,1,60,4, GREEN_06,
+	blitter->terminal_init(stats_view->number, 0x1a, 0x00, 1,1,60,7, GREEN_06,
 				  (GREEN_01 & 0x0fff) | 0xa000);
 	
 	terminal = &blitter->blit[1];
@@ -166,11 +165,41 @@ void E64::hud_t::process_keypress()
 				blitter->terminal_cursor_right(terminal->number);
 				break;
 			case ASCII_CURSOR_UP:
-				blitter->terminal_cursor_up(terminal->number);
+			{
+				char address_string[7];
+				uint32_t address;
+				switch (blitter->terminal_cursor_up(terminal->number, address_string)) {
+					case E64::NOTHING:
+						break;
+					case E64::ASCII:
+						if (hex_string_to_int(address_string, &address))
+							memory_dump((address-8) & (RAM_SIZE_CPU_VISIBLE - 1), 1);
+						break;
+					case E64::MONITOR_WORD:
+						if (hex_string_to_int(address_string, &address))
+							memory_word_dump((address - 16) & 0xfffffe, 1);
+						break;
+				}
 				break;
+			}
 			case ASCII_CURSOR_DOWN:
-				blitter->terminal_cursor_down(terminal->number);
+			{
+				char address_string[7];
+				uint32_t address;
+				switch (blitter->terminal_cursor_down(terminal->number, address_string)) {
+					case E64::NOTHING:
+						break;
+					case E64::ASCII:
+						if (hex_string_to_int(address_string, &address))
+							memory_dump((address+8) & (RAM_SIZE_CPU_VISIBLE - 1), 1);
+						break;
+					case E64::MONITOR_WORD:
+						if (hex_string_to_int(address_string, &address))
+							memory_word_dump((address + 16) & 0xfffffe, 1);
+						break;
+				}
 				break;
+			}
 			case ASCII_BACKSPACE:
 				blitter->terminal_backspace(terminal->number);
 				break;
@@ -291,7 +320,7 @@ void E64::hud_t::update_views()
 				 machine.timer->io_read_8(0x00) & 0b00000100 ? '1' : '0',
 				 machine.timer->io_read_8(0x00) & 0b00000010 ? '1' : '0',
 				 machine.timer->io_read_8(0x00) & 0b00000001 ? '1' : '0',
-				 machine.frame_cycles(), CPU_CYCLES_PER_FRAME);
+				 machine.frame_cycles(), machine.cycles_per_frame());
 }
 
 void E64::hud_t::run(uint16_t cycles)
@@ -471,40 +500,109 @@ void E64::hud_t::process_command(char *buffer)
 	} else if (token0[0] == ';') {
 		have_prompt = false;
 		enter_monitor_word_line(buffer);
-	} else if (strcmp(token0, "b") == 0) {
+	} else if ((strcmp(token0, "b") == 0) || (strcmp(token0, "t") == 0)) {
+		bool trace = (token0[0] == 't');
 		token1 = strtok(NULL, " ");
+		char *condition = strtok(NULL, "");
 		blitter->terminal_putchar(terminal->number, '\n');
-		if (token1 == NULL) {
+		if ((token1 == NULL) && trace) {
+			/*
+			 * Latest entries of the trace log, three lines each
+			 */
+			int no_of_entries = terminal->terminal_lines_remaining() / 3;
+			if (no_of_entries == 0) no_of_entries = 1;
+			if (machine.m68k->trace_count == 0) {
+				blitter->terminal_printf(terminal->number, "trace log is empty");
+			}
+			for (int i=0; i<no_of_entries; i++) {
+				const m68k_ic::trace_entry_t *entry = machine.m68k->trace_entry(i);
+				if (entry == nullptr) break;
+				if (i) blitter->terminal_putchar(terminal->number, '\n');
+				blitter->terminal_printf(terminal->number, "%3u pc:$%06x sr:$%04x clock:%lli\n d:", i,
+					entry->pc, entry->sr, (long long)entry->clock);
+				for (int j=0; j<8; j++) blitter->terminal_printf(terminal->number, " %08x", entry->d[j]);
+				blitter->terminal_printf(terminal->number, "\n a:");
+				for (int j=0; j<8; j++) blitter->terminal_printf(terminal->number, " %08x", entry->a[j]);
+			}
+		} else if (token1 == NULL) {
 			unsigned int no_of_breakpoints = (unsigned int)machine.m68k->debugger.breakpoints.elements();
 			if (no_of_breakpoints == 0) {
 				blitter->terminal_printf(terminal->number, "currently no cpu breakpoints defined");
 			} else {
-				blitter->terminal_printf(terminal->number, "  # address active");
+				blitter->terminal_printf(terminal->number, "  # address active type  condition");
 				for (int i=0; i<no_of_breakpoints; i++) {
+					uint32_t address = *machine.m68k->debugger.breakpoints.guardAddr(i);
+					bool is_trace;
+					const char *text = machine.m68k->breakpoint_condition(address, &is_trace);
+					blitter->terminal_printf(terminal->number, "\n%3u $%06x  %-3s    %-5s %.45s", i, address,
+						 machine.m68k->debugger.breakpoints.isEnabled(i) ? "yes" : "no",
+						 is_trace ? "trace" : "break", text);
+				}
+			}
+		} else {
+			uint32_t temp_32bit;
+			if (hex_string_to_int(token1, &temp_32bit)) {
+				temp_32bit &= (RAM_SIZE_CPU_VISIBLE - 1);
+				bool is_trace;
+				machine.m68k->breakpoint_condition(temp_32bit, &is_trace);
+				const char *error;
+				if (condition == NULL && machine.m68k->debugger.breakpoints.isSetAt(temp_32bit) && (is_trace == trace)) {
+					/*
+					 * Toggle
+					 */
+					machine.m68k->remove_breakpoint(temp_32bit);
+					blitter->terminal_printf(terminal->number, "%s cleared at $%06x",
+						trace ? "tracepoint" : "breakpoint", temp_32bit);
+				} else if (machine.m68k->set_breakpoint(temp_32bit, condition, trace, &error)) {
+					blitter->terminal_printf(terminal->number, "%s set at $%06x",
+						trace ? "tracepoint" : "breakpoint", temp_32bit);
+				} else {
+					blitter->terminal_printf(terminal->number, "error: %s", error);
+				}
+			} else {
+				blitter->terminal_puts(terminal->number, "error: invalid address");
+			}
+		}
+	} else if (strcmp(token0, "bc") == 0 ) {
+		blitter->terminal_puts(terminal->number, "\nclearing all breakpoints and tracepoints");
+		machine.m68k->remove_all_breakpoints();
+	} else if (strcmp(token0, "tc") == 0 ) {
+		blitter->terminal_puts(terminal->number, "\nclearing trace log");
+		machine.m68k->clear_trace();
+	} else if (strcmp(token0, "w") == 0) {
+		token1 = strtok(NULL, " ");
+		blitter->terminal_putchar(terminal->number, '\n');
+		if (token1 == NULL) {
+			unsigned int no_of_watchpoints = (unsigned int)machine.m68k->debugger.watchpoints.elements();
+			if (no_of_watchpoints == 0) {
+				blitter->terminal_printf(terminal->number, "currently no cpu watchpoints defined");
+			} else {
+				blitter->terminal_printf(terminal->number, "  # address active");
+				for (int i=0; i<no_of_watchpoints; i++) {
 					blitter->terminal_printf(terminal->number, "\n%3u $%06x  %s", i,
-						 machine.m68k->debugger.breakpoints.guardAddr(i),
-						 machine.m68k->debugger.breakpoints.isEnabled(i) ? "yes" : "no");
+						 *machine.m68k->debugger.watchpoints.guardAddr(i),
+						 machine.m68k->debugger.watchpoints.isEnabled(i) ? "yes" : "no");
 				}
 			}
 		} else {
 			uint32_t temp_32bit;
 			if (hex_string_to_int(token1, &temp_32bit)) {
 				temp_32bit &= (RAM_SIZE_CPU_VISIBLE - 1);
-				if (machine.m68k->debugger.breakpoints.isSetAt(temp_32bit)) {
-					machine.m68k->debugger.breakpoints.removeAt(temp_32bit);
+				if (machine.m68k->debugger.watchpoints.isSetAt(temp_32bit)) {
+					machine.m68k->debugger.watchpoints.removeAt(temp_32bit);
 				} else {
-					machine.m68k->debugger.breakpoints.setAt(temp_32bit);
+					machine.m68k->debugger.watchpoints.setAt(temp_32bit);
 				}
-				blitter->terminal_printf(terminal->number, "breakpoint %s at $%06x",
-						machine.m68k->debugger.breakpoints.isSetAt(temp_32bit) ? "set" : "cleared",
+				blitter->terminal_printf(terminal->number, "watchpoint %s at $%06x",
+						machine.m68k->debugger.watchpoints.isSetAt(temp_32bit) ? "set" : "cleared",
 						temp_32bit);
 			} else {
 				blitter->terminal_puts(terminal->number, "error: invalid address");
 			}
 		}
-	} else if (strcmp(token0, "bc") == 0 ) {
-		blitter->terminal_puts(terminal->number, "\nclearing all breakpoints");
-		machine.m68k->debugger.breakpoints.removeAll();
+	} else if (strcmp(token0, "wc") == 0 ) {
+		blitter->terminal_puts(terminal->number, "\nclearing all watchpoints");
+		machine.m68k->debugger.watchpoints.removeAll();
 	} else if (strcmp(token0, "mw") == 0) {
 		have_prompt = false;
 		token1 = strtok(NULL, " ");
@@ -535,7 +633,7 @@ void E64::hud_t::process_command(char *buffer)
 		}
 	} else if (strcmp(token0, "c") == 0 ) {
 		have_prompt = false;
-		E64::sdl2_wait_until_enter_released();
+		host.mask_key_until_released(SCANCODE_RETURN);
 		blitter->terminal_putchar(terminal->number, '\n');
 		//terminal->terminal_putchar('\n');
 		machine.flip_modes();
@@ -544,14 +642,13 @@ void E64::hud_t::process_command(char *buffer)
 		 * This extra call ensures the keystates are nice when
 		 * entering the machine again
 		 */
-		sdl2_process_events();
+		machine.update_key_states(host.key_states);
 	} else if (strcmp(token0, "clear") == 0 ) {
 		have_prompt = false;
 		blitter->terminal_clear(terminal->number);
 		//terminal->terminal_clear();
 	} else if (strcmp(token0, "exit") == 0) {
 		have_prompt = false;
-		E64::sdl2_wait_until_enter_released();
 		app_running = false;
 	} else if (strcmp(token0, "m") == 0) {
 		have_prompt = false;
@@ -582,9 +679,82 @@ void E64::hud_t::process_command(char *buffer)
 			}
 		}
 	} else if (strcmp(token0, "reset") == 0) {
-		E64::sdl2_wait_until_enter_released();
+		host.mask_key_until_released(SCANCODE_RETURN);
 		machine.reset();
+	} else if ((strcmp(token0, "save") == 0) || (strcmp(token0, "load") == 0)) {
+		/*
+		 * Save states, default file in settings directory
+		 */
+		char path[512];
+		token1 = strtok(NULL, " ");
+		if (token1 == NULL) {
+			snprintf(path, 512, "%s/state.e64", host.settings->settings_dir);
+		} else {
+			snprintf(path, 512, "%s", token1);
+		}
+		blitter->terminal_putchar(terminal->number, '\n');
+		if (token0[0] == 's') {
+			blitter->terminal_printf(terminal->number, machine.save_state(path) ?
+				"state saved to %s" : "error: can't save state to %s", path);
+		} else {
+			blitter->terminal_printf(terminal->number, machine.load_state(path) ?
+				"state loaded from %s" : "error: can't load state from %s", path);
+		}
+	} else if (strcmp(token0, "rewind") == 0) {
+		uint32_t frames = 1;
+		token1 = strtok(NULL, " ");
+		if (token1) frames = atoi(token1);
+		blitter->terminal_putchar(terminal->number, '\n');
+		if (machine.rewind(frames)) {
+			blitter->terminal_printf(terminal->number, "rewound %u frame(s), %u available",
+				frames, machine.rewind_available());
+		} else {
+			blitter->terminal_printf(terminal->number, "error: %u frame(s) available",
+				machine.rewind_available());
+		}
+	} else if (strcmp(token0, "runahead") == 0) {
+		token1 = strtok(NULL, " ");
+		blitter->terminal_putchar(terminal->number, '\n');
+		if (token1) {
+			int frames = atoi(token1);
+			if (frames < 0) {
+				blitter->terminal_printf(terminal->number, "error: can't run '%s' frame(s) ahead\n", token1);
+			} else {
+				host.settings->run_ahead_frames = (frames > RUN_AHEAD_MAX_FRAMES) ? RUN_AHEAD_MAX_FRAMES : frames;
+			}
+		}
+		blitter->terminal_printf(terminal->number, "running %u frame(s) ahead", host.settings->run_ahead_frames);
+	} else if (strcmp(token0, "clock") == 0) {
+		token1 = strtok(NULL, " ");
+		blitter->terminal_putchar(terminal->number, '\n');
+		if (token1) {
+			int multiplier = (strcmp(token1, "unlimited") == 0) ? CPU_CLOCK_MULTIPLIER_MAX : atoi(token1);
+			if ((multiplier < 1) || (multiplier > CPU_CLOCK_MULTIPLIER_MAX) ||
+			    !machine.set_cpu_clock_multiplier(multiplier)) {
+				blitter->terminal_printf(terminal->number, "error: can't set clock to '%s'\n", token1);
+			}
+		}
+		blitter->terminal_printf(terminal->number, "cpu clock %.2f MHz (%ux)",
+			(double)CPU_CLOCK_SPEED * machine.get_cpu_clock_multiplier() / 1000000,
+			machine.get_cpu_clock_multiplier());
+	} else if (strcmp(token0, "fpu") == 0) {
+		token1 = strtok(NULL, " ");
+		blitter->terminal_putchar(terminal->number, '\n');
+		if (token1) {
+			bool known = false;
+			for (int i = 0; i < FPU_MODES; i++) {
+				if (strcmp(token1, E64::fpu_mode_names[i]) == 0) {
+					machine.set_fpu_mode((enum E64::fpu_mode_t)i);
+					known = true;
+				}
+			}
+			if (!known) {
+				blitter->terminal_printf(terminal->number, "error: unknown fpu mode '%s'\n", token1);
+			}
+		}
+		blitter->terminal_printf(terminal->number, "fpu %s", E64::fpu_mode_names[machine.get_fpu_mode()]);
 	} else if (strcmp(token0, "timer") == 0) {
+		machine.sync_timer();
 		machine.timer->status(text_buffer, 512);
 		blitter->terminal_printf(terminal->number, "%s", text_buffer);
 	} else if (strcmp(token0, "ver") == 0) {
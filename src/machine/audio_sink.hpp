@@ -0,0 +1,51 @@
+/*
+ * audio_sink.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Destination for the samples produced by the sound ic. This base class
+ * discards everything, a host derives from it to actually play or store
+ * the sound.
+ */
+
+#ifndef AUDIO_SINK_HPP
+#define AUDIO_SINK_HPP
+
+#include <cstdint>
+
+namespace E64
+{
+
+class audio_sink_t {
+public:
+	virtual ~audio_sink_t() {}
+	
+	/*
+	 * Interleaved stereo samples, two floats per frame
+	 */
+	virtual void queue(float *samples, uint32_t no_of_frames) {}
+	
+	/*
+	 * A sink that plays in real time reports the size of its queue
+	 * (bytes). The machine uses this to keep the sid in pace with the
+	 * host. A sink that doesn't play in real time gets samples for
+	 * exactly the number of cycles run by the cpu.
+	 */
+	virtual bool real_time() { return false; }
+	virtual unsigned int queue_size() { return 0; }
+	virtual void start() {}
+	
+	/*
+	 * Recording of sound (e.g. to a wav file)
+	 */
+	virtual void start_recording() {}
+	virtual void record(float sample) {}
+	virtual void stop_recording() {}
+};
+
+}
+
+#endif
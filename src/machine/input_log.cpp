@@ -0,0 +1,127 @@
+/*
+ * input_log.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include "input_log.hpp"
+
+E64::input_log_t::input_log_t()
+{
+	file = nullptr;
+	current_mode = INPUT_LIVE;
+	pending_valid = false;
+}
+
+E64::input_log_t::~input_log_t()
+{
+	stop();
+}
+
+bool E64::input_log_t::start_recording(const char *path)
+{
+	stop();
+	
+	file = fopen(path, "wb");
+	if (!file) {
+		printf("[Input] Error: can't open %s for writing\n", path);
+		return false;
+	}
+	
+	uint8_t header[8] = {
+		'E', '6', '4', 'I',
+		INPUT_LOG_VERSION & 0xff, (INPUT_LOG_VERSION >> 8) & 0xff,
+		(INPUT_LOG_VERSION >> 16) & 0xff, (INPUT_LOG_VERSION >> 24) & 0xff
+	};
+	fwrite(header, 1, 8, file);
+	
+	current_mode = INPUT_RECORDING;
+	printf("[Input] Recording to %s\n", path);
+	return true;
+}
+
+bool E64::input_log_t::start_replay(const char *path)
+{
+	stop();
+	
+	file = fopen(path, "rb");
+	if (!file) {
+		printf("[Input] Error: can't open %s\n", path);
+		return false;
+	}
+	
+	uint8_t header[8];
+	if ((fread(header, 1, 8, file) != 8) ||
+	    (header[0] != 'E') || (header[1] != '6') ||
+	    (header[2] != '4') || (header[3] != 'I')) {
+		printf("[Input] Error: %s is not an input log\n", path);
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+	
+	uint32_t version = header[4] | (header[5] << 8) | (header[6] << 16) | (header[7] << 24);
+	if (version != INPUT_LOG_VERSION) {
+		printf("[Input] Error: %s has version %u, expected %u\n", path, version, INPUT_LOG_VERSION);
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+	
+	current_mode = INPUT_REPLAYING;
+	read_next();
+	printf("[Input] Replaying %s\n", path);
+	return true;
+}
+
+void E64::input_log_t::stop()
+{
+	if (file) {
+		fclose(file);
+		file = nullptr;
+		printf("[Input] %s stopped\n", current_mode == INPUT_RECORDING ? "Recording" : "Replay");
+	}
+	current_mode = INPUT_LIVE;
+	pending_valid = false;
+}
+
+void E64::input_log_t::record(int64_t moment, uint8_t scancode, uint8_t state)
+{
+	if (current_mode != INPUT_RECORDING) return;
+	
+	uint8_t buffer[10];
+	for (int i=0; i<8; i++) buffer[i] = (moment >> (8 * i)) & 0xff;
+	buffer[8] = scancode;
+	buffer[9] = state;
+	fwrite(buffer, 1, 10, file);
+}
+
+void E64::input_log_t::read_next()
+{
+	uint8_t buffer[10];
+	
+	if (fread(buffer, 1, 10, file) == 10) {
+		pending.moment = 0;
+		for (int i=7; i>=0; i--) pending.moment = (pending.moment << 8) | buffer[i];
+		pending.scancode = buffer[8] & 0x7f;
+		pending.state = buffer[9];
+		pending_valid = true;
+	} else {
+		pending_valid = false;
+	}
+}
+
+int64_t E64::input_log_t::next_moment()
+{
+	return pending_valid ? pending.moment : INT64_MAX;
+}
+
+bool E64::input_log_t::pop(int64_t moment, struct input_event_t *event)
+{
+	if (!pending_valid || (pending.moment > moment)) return false;
+	
+	*event = pending;
+	read_next();
+	return true;
+}
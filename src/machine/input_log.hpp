@@ -0,0 +1,78 @@
+/*
+ * input_log.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Log of keyboard state changes, each one stamped with the cpu clock
+ * (cycles since reset) at which the machine saw it. Replaying a log
+ * from reset feeds the same changes to the cia at the same moments,
+ * so the guest runs bit identical every time.
+ *
+ * File layout: "E64I" plus version (32 bit little endian), followed
+ * by 10 byte records: moment (64 bit little endian), scancode, state.
+ */
+
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+#define INPUT_LOG_VERSION	1
+
+namespace E64
+{
+
+enum input_log_mode_t {
+	INPUT_LIVE,
+	INPUT_RECORDING,
+	INPUT_REPLAYING
+};
+
+struct input_event_t {
+	int64_t moment;
+	uint8_t scancode;
+	uint8_t state;
+};
+
+class input_log_t {
+private:
+	FILE *file;
+	enum input_log_mode_t current_mode;
+	
+	/*
+	 * When replaying, the event that is due next
+	 */
+	struct input_event_t pending;
+	bool pending_valid;
+	
+	void read_next();
+public:
+	input_log_t();
+	~input_log_t();
+	
+	bool start_recording(const char *path);
+	bool start_replay(const char *path);
+	void stop();
+	
+	inline enum input_log_mode_t mode() { return current_mode; }
+	
+	void record(int64_t moment, uint8_t scancode, uint8_t state);
+	
+	/*
+	 * Moment of the next event in replay, INT64_MAX if there's none
+	 */
+	int64_t next_moment();
+	
+	/*
+	 * Returns the next event if it's due at moment
+	 */
+	bool pop(int64_t moment, struct input_event_t *event);
+};
+
+}
+
+#endif
@@ -6,10 +6,13 @@
  */
 
 #include "machine.hpp"
-#include "sdl2.hpp"
-#include "common.hpp"
+#include "definitions.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <unistd.h>
 
 E64::machine_t::machine_t()
@@ -17,14 +20,14 @@ E64::machine_t::machine_t()
 	underruns = equalruns = overruns = 1;
 	under_lap = equal_lap = over_lap = 1;
 	
-	mmu = new mmu_ic();
+	mmu = new mmu_ic(this);
 	
 	/*
 	 * Create exception/priority handler + m68k cpu. Then connect
 	 * m68k to exception handler.
 	 */
 	TTL74LS148 = new TTL74LS148_ic();
-	m68k = new m68k_ic();
+	m68k = new m68k_ic(mmu);
 	m68k->setModel(M68EC020, M68EC020);
 	m68k->debugger.reset();
 	m68k->setDasmSyntax(DASM_MOIRA);
@@ -41,14 +44,75 @@ E64::machine_t::machine_t()
 	
 	sound = new sound_ic();
 	
-	cia = new cia_ic();
+	/*
+	 * Coprocessor with its own priority encoder, and the mailbox
+	 * connected to both encoders
+	 */
+	coprocessor_TTL74LS148 = new TTL74LS148_ic();
+	coprocessor = new m68k_ic(mmu, true);
+	coprocessor->setModel(M68EC020, M68EC020);
+	coprocessor->debugger.reset();
+	coprocessor_TTL74LS148->connect_m68k(coprocessor);
+	mailbox = new mailbox_ic(TTL74LS148, coprocessor_TTL74LS148);
+	
+	m68k->connect_blitter(blitter);
+	coprocessor->connect_blitter(blitter);
+	
+	coprocessor_enabled = false;
+	coprocessor_release_pending = false;
+	coprocessor_thread = nullptr;
+	coprocessor_busy = false;
+	coprocessor_quit = false;
+	coprocessor_target = 0;
+	
+	block_cache_requested = false;
+	jit_requested = false;
+	
+	fpu_mode = FPU_MODE_NONE;
+	
+	hle_requested = false;
+	
+	for (int i=0; i<128; i++) key_states[i] = 0;
+	cia = new cia_ic(key_states);
 	
 	/*
 	 * Init clocks (frequency dividers)
 	 */
 	cpu_to_sid = new clocks(CPU_CLOCK_SPEED, SID_CLOCK_SPEED);
+	cpu_clock_multiplier = 1;
+	cpu_cycles_per_frame = CPU_CYCLES_PER_FRAME;
+	
+	scheduler = new scheduler_t();
+	
+	input_log = new input_log_t();
+	
+	rewind_buffer = new rewind_buffer_t();
+	
+	state_hash_log = new state_hash_log_t();
+	
+	slow_frame_log = new slow_frame_log_t();
+	frame_profile = new frame_profile_t();
+	last_frame_profile = new frame_profile_t();
+	frame_profile->start(0, 0);
+	last_frame_profile->start(0, 0);
+	rewind_capture_pending = false;
+	
+	running_ahead = false;
+	run_ahead_frame_valid = false;
+	
+	run_ahead_fb = new uint16_t[VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES];
+	run_ahead_trace_log = new m68k_ic::trace_entry_t[M68K_TRACE_ENTRIES];
+	
+	render_interval = 1;
+	render_counter = 0;
+	last_frame_rendered = true;
 	
 	recording_sound = false;
+	audio = &default_audio_sink;
+	audio_buffer_size = AUDIO_BUFFER_SIZE;
+	
+	idle_cycles_skipped = 0;
+	instructions_executed = 0;
 }
 
 E64::machine_t::~machine_t()
@@ -64,11 +128,25 @@ E64::machine_t::~machine_t()
 	       (double)overruns*100/total);
 	
 	if (recording_sound) {
-		stop_recording_sound();
+		toggle_recording_sound();
 	}
 	
+	enable_coprocessor(false);
+	
+	delete [] run_ahead_fb;
+	delete [] run_ahead_trace_log;
+	delete last_frame_profile;
+	delete frame_profile;
+	delete slow_frame_log;
+	delete state_hash_log;
+	delete rewind_buffer;
+	delete input_log;
+	delete scheduler;
 	delete cpu_to_sid;
 	delete cia;
+	delete mailbox;
+	delete coprocessor;
+	delete coprocessor_TTL74LS148;
 	delete sound;
 	delete blitter;
 	delete timer;
@@ -81,27 +159,48 @@ bool E64::machine_t::run(uint16_t cycles)
 {
 	m68k_cycle_saldo += cycles;
 	
+	int64_t start_clock = m68k->getClock();
+	int64_t end_clock = start_clock + m68k_cycle_saldo;
+	
+	if (coprocessor_release_pending) release_coprocessor();
+	
 	/*
-	 * A fine grained cycles_step is needed to be able run the
-	 * proper amount of cycles on both cia and timer after each
-	 * cpu instruction. That way, there'll be a decent emulation
-	 * of interrupt triggering and acknowledgements.
+	 * Timer, cia, sound and screen refresh only need attention at
+	 * the moments they have registered with the scheduler. Up to the
+	 * next of those moments, the cpu runs in a tight loop.
+	 *
+	 * An instruction that writes to the timer may move its next
+	 * event forward. That's why the deadline is read from the
+	 * scheduler after each instruction. This way, interrupts are
+	 * triggered after exactly the same instruction as they would be
+	 * when stepping all ic's after each instruction.
 	 *
 	 * Note: This implies that cia and timer run at the same clock
 	 * speed as the cpu.
 	 */
-	uint8_t cycles_step;
-	
-	int32_t consumed_cycles = 0;
-	
 	do {
-		m68k->execute();
-		cycles_step = m68k->getClock() - m68k->old_clock;
-		m68k->old_clock += cycles_step;
-		cia->run(cycles_step);
-		timer->run(cycles_step);
-		consumed_cycles += cycles_step;
-	} while ((!m68k->breakpoint_reached) && (consumed_cycles < m68k_cycle_saldo));
+		/*
+		 * If the cpu is waiting for an interrupt, nothing changes
+		 * until the next event. Skip straight to it.
+		 */
+		int64_t skipped = m68k->fast_forward((scheduler->next_event() < end_clock) ?
+						     scheduler->next_event() : end_clock);
+		
+		if (skipped) {
+			idle_cycles_skipped += skipped;
+		} else {
+			int64_t limit;
+			do {
+				limit = (scheduler->next_event() < end_clock) ?
+					scheduler->next_event() : end_clock;
+				instructions_executed += m68k->execute_cached(limit);
+			} while ((m68k->getClock() < limit) &&
+				 (!m68k->breakpoint_reached));
+		}
+		process_events();
+		if (slow_frame_log->active() && !running_ahead) frame_profile->sample_pc(m68k->getPC());
+		if (coprocessor_enabled) mailbox->update_interrupt(MAILBOX_MAIN);
+	} while ((!m68k->breakpoint_reached) && (m68k->getClock() < end_clock));
 	
 	/*
 	 * After reaching a breakpoint, it can be expected that the full
@@ -109,12 +208,70 @@ bool E64::machine_t::run(uint16_t cycles)
 	 * the step function in debugger mode works correctly, empty any
 	 * remaining desired cycles by putting the cycle_saldo on 0.
 	 */
+	bool result = m68k->breakpoint_reached;
 	if (m68k->breakpoint_reached) {
 		m68k_cycle_saldo = 0;
+		m68k->breakpoint_reached = false;
 	} else {
-		m68k_cycle_saldo -= consumed_cycles;
+		m68k_cycle_saldo -= m68k->getClock() - start_clock;
+	}
+	
+	if (rewind_capture_pending) capture_rewind_snapshot();
+	
+	return result;
+}
+
+void E64::machine_t::process_events()
+{
+	int64_t now = m68k->getClock();
+	enum event_t event;
+	
+	while ((event = scheduler->pop(now)) != NO_OF_EVENTS) {
+		switch (event) {
+			case EVENT_TIMER:
+				sync_timer();
+				break;
+			case EVENT_CIA:
+				sync_cia();
+				break;
+			case EVENT_SOUND:
+				sync_sound();
+				break;
+			case EVENT_FRAME:
+				end_frame();
+				break;
+			case EVENT_INPUT:
+				replay_input();
+				break;
+			default:
+				break;
+		}
 	}
+}
 
+void E64::machine_t::sync_timer()
+{
+	int64_t now = m68k->getClock();
+	timer->run(now - timer_clock);
+	timer_clock = now;
+	scheduler->schedule(EVENT_TIMER, now + timer->cycles_to_next_event());
+}
+
+void E64::machine_t::sync_cia()
+{
+	int64_t now = m68k->getClock();
+	cia->run(now - cia_clock);
+	cia_clock = now;
+	scheduler->schedule(EVENT_CIA, now + cia->cycles_to_next_event());
+}
+
+void E64::machine_t::sync_sound()
+{
+	int64_t now = m68k->getClock();
+	uint32_t consumed_cycles = now - sound_clock;
+	sound_clock = now;
+	scheduler->schedule(EVENT_SOUND, now + (SOUND_SYNC_CYCLES * cpu_clock_multiplier));
+	
 	/*
 	 * Run cycles on sound device & start audio if buffer is large
 	 * enough. The aim is to have as much synchronization between
@@ -123,110 +280,345 @@ bool E64::machine_t::run(uint16_t cycles)
 	 * If buffer size deviates too much, an adjusted amount of cycles
 	 * will be run on sound.
 	 */
-	unsigned int audio_queue_size = stats.current_audio_queue_size();
-
-	if (!recording_sound) {
+	if (!audio->real_time() || (input_log->mode() != INPUT_LIVE)) {
+		/*
+		 * No need to keep pace with the host, or a fixed clock
+		 * is needed for reproducible runs
+		 */
+		audio->queue(sound->samples(), sound->run(cpu_to_sid->clock(consumed_cycles)));
+		
+		if (audio->queue_size() > (3*audio_buffer_size/4))
+			audio->start();
+	} else if (!recording_sound) {
 		/* not recording sound */
-		if (audio_queue_size < (0.5 * AUDIO_BUFFER_SIZE)) {
-			sound->run(cpu_to_sid->clock(1.05 * consumed_cycles));
+		unsigned int audio_queue_size = audio->queue_size();
+		
+		if (audio_queue_size < (0.5 * audio_buffer_size)) {
+			audio->queue(sound->samples(), sound->run(cpu_to_sid->clock(1.05 * consumed_cycles)));
 			underruns++;
-		} else if (audio_queue_size < 1.2 * AUDIO_BUFFER_SIZE) {
-			sound->run(cpu_to_sid->clock(consumed_cycles));
+		} else if (audio_queue_size < 1.2 * audio_buffer_size) {
+			audio->queue(sound->samples(), sound->run(cpu_to_sid->clock(consumed_cycles)));
 			equalruns++;
-		} else if (audio_queue_size < 2.0 * AUDIO_BUFFER_SIZE) {
-			sound->run(cpu_to_sid->clock(0.95 * consumed_cycles));
+		} else if (audio_queue_size < 2.0 * audio_buffer_size) {
+			audio->queue(sound->samples(), sound->run(cpu_to_sid->clock(0.95 * consumed_cycles)));
 			overruns++;
 		} else overruns++;
+		
+		if (audio_queue_size > (3*audio_buffer_size/4))
+			audio->start();
 	} else {
 		/* recording sound */
-		if (audio_queue_size < (0.5 * AUDIO_BUFFER_SIZE)) {
+		unsigned int audio_queue_size = audio->queue_size();
+		
+		if (audio_queue_size < (0.5 * audio_buffer_size)) {
 			underruns++;
-		} else if (audio_queue_size < 1.2 * AUDIO_BUFFER_SIZE) {
+		} else if (audio_queue_size < 1.2 * audio_buffer_size) {
 			equalruns++;
 		} else {
 			overruns++;
 		}
 		
-		sound->run(cpu_to_sid->clock(consumed_cycles));
+		audio->queue(sound->samples(), sound->run(cpu_to_sid->clock(consumed_cycles)));
 		
+		if (audio_queue_size > (3*audio_buffer_size/4))
+			audio->start();
+	}
+	
+	if (recording_sound) {
 		float sample;
 		
-		while (machine.sound->record_buffer_pop(&sample)) {
-			host.settings->write_to_wav(sample);
+		while (sound->record_buffer_pop(&sample)) {
+			audio->record(sample);
 		}
 	}
+}
+
+void E64::machine_t::end_frame()
+{
+	frame_clock += cpu_cycles_per_frame;
+	scheduler->schedule(EVENT_FRAME, frame_clock + cpu_cycles_per_frame);
+	frame_is_done = true;
 	
-	if (audio_queue_size > (3*AUDIO_BUFFER_SIZE/4))
-		E64::sdl2_start_audio();
+	if (rewind_buffer->capacity() && !running_ahead) rewind_capture_pending = true;
 	
-	frame_cycle_saldo += consumed_cycles;
+	/*
+	 * Barrier, the coprocessor must have finished this frame too.
+	 * It continues with the next one at the start of run().
+	 */
+	if (coprocessor_enabled) {
+		wait_for_coprocessor();
+		blitter->merge_coprocessor_dirty_pages();
+		coprocessor_release_pending = true;
+	}
 	
-	if (frame_cycle_saldo > CPU_CYCLES_PER_FRAME) {
-		frame_is_done = true;
-		
-		/*
-		 * Warn blitter for possible IRQ pull
-		 */
-		blitter->notify_screen_refreshed();
-		
-		
-		frame_cycle_saldo -= CPU_CYCLES_PER_FRAME;
-		
-		/*
-		 * Then run blitter
-		 */
+	/*
+	 * Warn blitter for possible IRQ pull
+	 */
+	blitter->notify_screen_refreshed();
+	
+	/*
+	 * Then run blitter, speculative frames are always drawn
+	 */
+	if (running_ahead) {
 		while (blitter->run_next_operation()) {}
+	} else if (++render_counter >= render_interval) {
+		render_counter = 0;
+		uint32_t operations = 0;
+		while (blitter->run_next_operation()) operations++;
+		frame_profile->blitter_operations = operations;
+		last_frame_rendered = true;
+	} else {
+		blitter->discard_operations();
+		last_frame_rendered = false;
 	}
 	
-	if (m68k->breakpoint_reached) {
-		m68k->breakpoint_reached = false;
-		return true;
-	} else {
-		return false;
+	if (slow_frame_log->active() && !running_ahead) finish_frame_profile();
+	
+	if (state_hash_log->active() && !running_ahead) log_state_hashes();
+}
+
+void E64::machine_t::set_render_interval(uint16_t frames)
+{
+	render_interval = frames ? frames : 1;
+	render_counter = 0;
+}
+
+bool E64::machine_t::start_slow_frame_log(const char *path)
+{
+	if (!slow_frame_log->start(path)) return false;
+	
+	frame_profile->start(frame_clock, idle_cycles_skipped);
+	blitter->pixels_drawn = 0;
+	sound->cycles_run = 0;
+	for (int i=0; i<8; i++) m68k->interrupts[i] = 0;
+	return true;
+}
+
+void E64::machine_t::stop_slow_frame_log()
+{
+	slow_frame_log->stop();
+}
+
+void E64::machine_t::finish_frame_profile()
+{
+	frame_profile->end_clock = frame_clock;
+	frame_profile->idle_cycles = idle_cycles_skipped - frame_profile->start_idle_cycles;
+	frame_profile->blitter_pixels = blitter->pixels_drawn;
+	frame_profile->sid_cycles = sound->cycles_run;
+	for (int i=0; i<8; i++) frame_profile->interrupts[i] = m68k->interrupts[i];
+	
+	blitter->pixels_drawn = 0;
+	sound->cycles_run = 0;
+	for (int i=0; i<8; i++) m68k->interrupts[i] = 0;
+	
+	std::swap(frame_profile, last_frame_profile);
+	frame_profile->start(frame_clock, idle_cycles_skipped);
+	slow_frame_log->frame_done();
+}
+
+void E64::machine_t::log_slow_frame(uint32_t vm_time, uint32_t budget)
+{
+	if (slow_frame_log->active()) slow_frame_log->write(last_frame_profile, vm_time, budget);
+}
+
+bool E64::machine_t::start_state_hashing(const char *path)
+{
+	return state_hash_log->start(path);
+}
+
+void E64::machine_t::stop_state_hashing()
+{
+	state_hash_log->stop();
+}
+
+void E64::machine_t::log_state_hashes()
+{
+	uint64_t hashes[STATE_HASH_SUBSYSTEMS];
+	
+	/*
+	 * The cpu by its registers. Timer and sound through their save
+	 * states, including the moment up to which they have run.
+	 */
+	uint32_t registers[25];
+	for (int i = 0; i < 8; i++) {
+		registers[i] = m68k->getD(i);
+		registers[8 + i] = m68k->getA(i);
+	}
+	registers[16] = m68k->getPC();
+	registers[17] = m68k->getSR();
+	registers[18] = m68k->getUSP();
+	registers[19] = m68k->getISP();
+	registers[20] = m68k->getMSP();
+	registers[21] = m68k->getVBR();
+	registers[22] = m68k->getSFC();
+	registers[23] = m68k->getDFC();
+	registers[24] = m68k->getIPL();
+	int64_t clock = m68k->getClock();
+	hashes[STATE_HASH_CPU] = state_hash_log_t::hash(registers, sizeof(registers),
+		state_hash_log_t::hash(&clock, sizeof(clock)));
+	
+	char *state;
+	size_t state_size;
+	long timer_end;
+	
+	FILE *f = open_memstream(&state, &state_size);
+	fwrite(&timer_clock, sizeof(timer_clock), 1, f);
+	timer->save_state(f);
+	timer_end = ftell(f);
+	fwrite(&sound_clock, sizeof(sound_clock), 1, f);
+	sound->save_state(f);
+	fclose(f);
+	
+	hashes[STATE_HASH_TIMER] = state_hash_log_t::hash(state, timer_end);
+	hashes[STATE_HASH_SOUND] = state_hash_log_t::hash(state + timer_end, state_size - timer_end);
+	free(state);
+	
+	hashes[STATE_HASH_RAM] = 0xcbf29ce484222325;
+	for (uint32_t page = 0; page < VIDEO_MEMORY_PAGES; page++) {
+		hashes[STATE_HASH_RAM] = state_hash_log_t::hash(blitter->video_memory_page(page), VIDEO_MEMORY_PAGE_SIZE, hashes[STATE_HASH_RAM]);
+	}
+	
+	hashes[STATE_HASH_FB] = state_hash_log_t::hash(blitter->fb, VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES * sizeof(uint16_t));
+	
+	state_hash_log->write(hashes);
+}
+
+int32_t E64::machine_t::frame_cycles()
+{
+	return m68k->getClock() - frame_clock;
+}
+
+uint64_t E64::machine_t::ram_hash()
+{
+	/*
+	 * Reading through the blitter avoids side effects of io reads
+	 */
+	uint64_t hash = 0xcbf29ce484222325;
+	for (uint32_t address = 0; address < 0x1000000; address++) {
+		hash ^= blitter->video_memory_read_8(address);
+		hash *= 0x100000001b3;
 	}
+	return hash;
 }
 
 void E64::machine_t::reset()
 {
 	printf("[Machine] System reset\n");
 	
+	/*
+	 * An input log is only valid from the reset it started with
+	 */
+	if (input_log->mode() != INPUT_LIVE) input_log->stop();
+	
 	m68k_cycle_saldo = 0;
-	frame_cycle_saldo = 0;
 	frame_is_done = false;
 	
 	mmu->reset();
+	m68k_ic::patch_rom(mmu, hle_requested);
 	sound->reset();
 	blitter->reset();
 	timer->reset();
 	cia->reset();
 	
 	m68k->reset();
-	m68k->old_clock = 0;
-	m68k->setClock(m68k->old_clock);
+	m68k->setClock(0);
+	m68k->flush_blocks();
+	
+	wait_for_coprocessor();
+	mailbox->reset();
+	coprocessor->reset();
+	coprocessor->setClock(0);
+	coprocessor_release_pending = coprocessor_enabled;
+	
+	cpu_to_sid->reset();
+	
+	rewind_buffer->clear();
+	rewind_capture_pending = false;
+	run_ahead_frame_valid = false;
+	timer_clock = cia_clock = sound_clock = frame_clock = 0;
+	frame_profile->start(frame_clock, idle_cycles_skipped);
+	
+	scheduler->reset();
+	scheduler->schedule(EVENT_TIMER, timer->cycles_to_next_event());
+	scheduler->schedule(EVENT_CIA, cia->cycles_to_next_event());
+	scheduler->schedule(EVENT_SOUND, SOUND_SYNC_CYCLES * cpu_clock_multiplier);
+	scheduler->schedule(EVENT_FRAME, cpu_cycles_per_frame);
 }
 
-void E64::machine_t::toggle_recording_sound()
+void E64::machine_t::apply_cpu_clock()
 {
-	if (!recording_sound) {
-		start_recording_sound();
-	} else {
-		stop_recording_sound();
+	uint32_t clock_speed = CPU_CLOCK_SPEED * cpu_clock_multiplier;
+	cpu_cycles_per_frame = clock_speed / FPS;
+	timer->set_clock_speed(clock_speed);
+	cia->set_clock_speed(clock_speed);
+	cpu_to_sid->adjust_frequencies(clock_speed, SID_CLOCK_SPEED);
+}
+
+bool E64::machine_t::set_cpu_clock_multiplier(uint8_t multiplier)
+{
+	if ((multiplier == 0) || (multiplier > CPU_CLOCK_MULTIPLIER_MAX)) return false;
+	
+	/*
+	 * An input log is stamped with cpu cycles at one clock speed
+	 */
+	if (input_log->mode() != INPUT_LIVE) {
+		printf("[Machine] Error: can't change cpu clock while recording or replaying input\n");
+		return false;
 	}
+	
+	if (multiplier == cpu_clock_multiplier) return true;
+	
+	/*
+	 * The coprocessor is released up to the end of the frame, which
+	 * is about to move
+	 */
+	wait_for_coprocessor();
+	coprocessor_release_pending = coprocessor_enabled;
+	
+	/*
+	 * Bring everything up to date at the old speed first
+	 */
+	sync_timer();
+	sync_cia();
+	sync_sound();
+	
+	/*
+	 * The part of the current frame that has passed stays the same
+	 * in time, not in cycles
+	 */
+	int64_t now = m68k->getClock();
+	int64_t frame_passed = ((now - frame_clock) * multiplier) / cpu_clock_multiplier;
+	
+	cpu_clock_multiplier = multiplier;
+	apply_cpu_clock();
+	
+	frame_clock = now - frame_passed;
+	scheduler->schedule(EVENT_FRAME, frame_clock + cpu_cycles_per_frame);
+	scheduler->schedule(EVENT_TIMER, now + timer->cycles_to_next_event());
+	scheduler->schedule(EVENT_CIA, now + cia->cycles_to_next_event());
+	scheduler->schedule(EVENT_SOUND, now + (SOUND_SYNC_CYCLES * cpu_clock_multiplier));
+	
+	printf("[Machine] Cpu clock set to %.2f MHz (%ux)\n",
+	       (double)CPU_CLOCK_SPEED * cpu_clock_multiplier / 1000000, cpu_clock_multiplier);
+	return true;
 }
 
-void E64::machine_t::start_recording_sound()
+void E64::machine_t::connect_audio_sink(audio_sink_t *sink)
 {
-	recording_sound = true;
-	sound->clear_record_buffer();
-	host.settings->create_wav();
-	hud.show_notification("start recording sound");
+	if (recording_sound) toggle_recording_sound();
+	audio = sink ? sink : &default_audio_sink;
 }
 
-void E64::machine_t::stop_recording_sound()
+void E64::machine_t::toggle_recording_sound()
 {
-	recording_sound = false;
-	host.settings->finish_wav();
-	hud.show_notification("stop recording sound");
+	if (!recording_sound) {
+		recording_sound = true;
+		sound->clear_record_buffer();
+		audio->start_recording();
+	} else {
+		recording_sound = false;
+		audio->stop_recording();
+	}
 }
 
 bool E64::machine_t::buffer_within_specs()
@@ -248,3 +640,507 @@ void E64::machine_t::flip_modes()
 		mode = RUNNING;
 	}
 }
+
+void E64::machine_t::update_key_states(uint8_t *states)
+{
+	switch (input_log->mode()) {
+		case INPUT_REPLAYING:
+			break;
+		case INPUT_RECORDING:
+			for (int i=0; i<128; i++) {
+				if (key_states[i] != states[i]) {
+					input_log->record(m68k->getClock(), i, states[i]);
+					key_states[i] = states[i];
+				}
+			}
+			break;
+		case INPUT_LIVE:
+			for (int i=0; i<128; i++) key_states[i] = states[i];
+			break;
+	}
+}
+
+bool E64::machine_t::start_input_recording(const char *path)
+{
+	blitter->power_on();
+	reset();
+	
+	if (!input_log->start_recording(path)) return false;
+	
+	/*
+	 * Keys held down at the start are part of the log
+	 */
+	for (int i=0; i<128; i++) {
+		if (key_states[i]) input_log->record(0, i, key_states[i]);
+	}
+	return true;
+}
+
+bool E64::machine_t::start_input_replay(const char *path)
+{
+	blitter->power_on();
+	reset();
+	
+	if (!input_log->start_replay(path)) return false;
+	
+	for (int i=0; i<128; i++) key_states[i] = 0;
+	scheduler->schedule(EVENT_INPUT, input_log->next_moment());
+	return true;
+}
+
+void E64::machine_t::stop_input_log()
+{
+	input_log->stop();
+	scheduler->cancel(EVENT_INPUT);
+}
+
+void E64::machine_t::replay_input()
+{
+	struct input_event_t event;
+	
+	while (input_log->pop(m68k->getClock(), &event)) {
+		key_states[event.scancode] = event.state;
+	}
+	
+	if (input_log->next_moment() == INT64_MAX) {
+		/* end of log, back to live input */
+		input_log->stop();
+	} else {
+		scheduler->schedule(EVENT_INPUT, input_log->next_moment());
+	}
+}
+
+/*
+ * Header: "E64S", version and a byte order marker (both 32 bit, host
+ * byte order). The same tag ends the file, as a check on completeness.
+ */
+static const char state_tag[4] = { 'E', '6', '4', 'S' };
+static const uint32_t state_byte_order = 0x01020304;
+
+/*
+ * Everything but the rom image, video memory and framebuffer
+ */
+void E64::machine_t::save_core_state(FILE *f)
+{
+	uint64_t sid_mod = cpu_to_sid->get_mod();
+	fwrite(&frame_is_done, sizeof(frame_is_done), 1, f);
+	fwrite(&m68k_cycle_saldo, sizeof(m68k_cycle_saldo), 1, f);
+	fwrite(&timer_clock, sizeof(timer_clock), 1, f);
+	fwrite(&cia_clock, sizeof(cia_clock), 1, f);
+	fwrite(&sound_clock, sizeof(sound_clock), 1, f);
+	fwrite(&frame_clock, sizeof(frame_clock), 1, f);
+	fwrite(&cpu_clock_multiplier, sizeof(cpu_clock_multiplier), 1, f);
+	fwrite(&sid_mod, sizeof(sid_mod), 1, f);
+	fwrite(key_states, 1, 128, f);
+	scheduler->save_state(f);
+	
+	fwrite(&fpu_mode, sizeof(fpu_mode), 1, f);
+	m68k->save_state(f);
+	TTL74LS148->save_state(f);
+	timer->save_state(f);
+	cia->save_state(f);
+	sound->save_state(f);
+	blitter->save_state(f);
+	
+	wait_for_coprocessor();
+	fwrite(&coprocessor_enabled, sizeof(coprocessor_enabled), 1, f);
+	fwrite(&coprocessor_release_pending, sizeof(coprocessor_release_pending), 1, f);
+	coprocessor->save_state(f);
+	coprocessor_TTL74LS148->save_state(f);
+	mailbox->save_state(f);
+}
+
+void E64::machine_t::load_core_state(FILE *f)
+{
+	uint64_t sid_mod;
+	fread(&frame_is_done, sizeof(frame_is_done), 1, f);
+	fread(&m68k_cycle_saldo, sizeof(m68k_cycle_saldo), 1, f);
+	fread(&timer_clock, sizeof(timer_clock), 1, f);
+	fread(&cia_clock, sizeof(cia_clock), 1, f);
+	fread(&sound_clock, sizeof(sound_clock), 1, f);
+	fread(&frame_clock, sizeof(frame_clock), 1, f);
+	fread(&cpu_clock_multiplier, sizeof(cpu_clock_multiplier), 1, f);
+	apply_cpu_clock();
+	fread(&sid_mod, sizeof(sid_mod), 1, f);
+	cpu_to_sid->set_mod(sid_mod);
+	fread(key_states, 1, 128, f);
+	scheduler->load_state(f);
+	
+	enum fpu_mode_t saved_fpu_mode;
+	fread(&saved_fpu_mode, sizeof(saved_fpu_mode), 1, f);
+	set_fpu_mode(saved_fpu_mode);
+	m68k->load_state(f);
+	TTL74LS148->load_state(f);
+	timer->load_state(f);
+	cia->load_state(f);
+	sound->load_state(f);
+	blitter->load_state(f);
+	
+	bool enabled;
+	wait_for_coprocessor();
+	fread(&enabled, sizeof(enabled), 1, f);
+	enable_coprocessor(enabled);
+	fread(&coprocessor_release_pending, sizeof(coprocessor_release_pending), 1, f);
+	coprocessor->load_state(f);
+	coprocessor_TTL74LS148->load_state(f);
+	mailbox->load_state(f);
+}
+
+bool E64::machine_t::save_state(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	
+	if (!f) {
+		printf("[Machine] Error: can't open %s for writing\n", path);
+		return false;
+	}
+	
+	uint32_t version = STATE_VERSION;
+	fwrite(state_tag, 1, 4, f);
+	fwrite(&version, sizeof(version), 1, f);
+	fwrite(&state_byte_order, sizeof(state_byte_order), 1, f);
+	
+	fwrite(mmu->current_rom_image, 1, 65536, f);
+	save_core_state(f);
+	blitter->save_memory(f);
+	fwrite(blitter->fb, sizeof(uint16_t), VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES, f);
+	
+	fwrite(state_tag, 1, 4, f);
+	
+	bool result = !ferror(f);
+	if (fclose(f)) result = false;
+	
+	if (result) {
+		printf("[Machine] Saved state to %s\n", path);
+	} else {
+		printf("[Machine] Error: writing state to %s failed\n", path);
+	}
+	return result;
+}
+
+bool E64::machine_t::load_state(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	
+	if (!f) {
+		printf("[Machine] Error: can't open %s\n", path);
+		return false;
+	}
+	
+	char tag[4];
+	uint32_t version, byte_order;
+	
+	if ((fread(tag, 1, 4, f) != 4) ||
+	    (fread(&version, sizeof(version), 1, f) != 1) ||
+	    (fread(&byte_order, sizeof(byte_order), 1, f) != 1) ||
+	    memcmp(tag, state_tag, 4) ||
+	    (version != STATE_VERSION) ||
+	    (byte_order != state_byte_order)) {
+		printf("[Machine] Error: %s is not a compatible state (version %u)\n", path, STATE_VERSION);
+		fclose(f);
+		return false;
+	}
+	
+	/*
+	 * A different timeline than the one of the input log
+	 */
+	if (input_log->mode() != INPUT_LIVE) input_log->stop();
+	
+	fread(mmu->current_rom_image, 1, 65536, f);
+	load_core_state(f);
+	blitter->load_memory(f);
+	
+	/*
+	 * Memory was replaced without write tracking
+	 */
+	m68k->flush_blocks();
+	fread(blitter->fb, sizeof(uint16_t), VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES, f);
+	
+	bool result = (fread(tag, 1, 4, f) == 4) && !memcmp(tag, state_tag, 4);
+	fclose(f);
+	
+	if (result) {
+		printf("[Machine] Loaded state from %s\n", path);
+		rewind_buffer->clear();
+		frame_profile->start(frame_clock, idle_cycles_skipped);
+	} else {
+		printf("[Machine] Error: %s is incomplete\n", path);
+		reset();
+	}
+	return result;
+}
+
+void E64::machine_t::enable_rewind(uint32_t seconds)
+{
+	rewind_buffer->resize(seconds * FPS);
+	if (seconds) {
+		printf("[Machine] Rewind buffer of %u seconds\n", seconds);
+	}
+}
+
+uint32_t E64::machine_t::rewind_available()
+{
+	return rewind_buffer->size();
+}
+
+bool E64::machine_t::rewind(uint32_t frames)
+{
+	if ((frames == 0) || (frames > rewind_available())) return false;
+	
+	/*
+	 * A different timeline than the one of the input log
+	 */
+	if (input_log->mode() != INPUT_LIVE) input_log->stop();
+	
+	uint8_t *state;
+	size_t state_size;
+	rewind_buffer->restore(frames, blitter, &state, &state_size);
+	
+	FILE *f = fmemopen(state, state_size, "rb");
+	load_core_state(f);
+	fclose(f);
+	
+	/*
+	 * Memory was replaced without write tracking
+	 */
+	m68k->flush_blocks();
+	
+	rewind_capture_pending = false;
+	frame_profile->start(frame_clock, idle_cycles_skipped);
+	return true;
+}
+
+void E64::machine_t::capture_rewind_snapshot()
+{
+	char *state;
+	size_t state_size;
+	
+	FILE *f = open_memstream(&state, &state_size);
+	save_core_state(f);
+	fclose(f);
+	
+	rewind_buffer->capture(blitter, (uint8_t *)state, state_size);
+	rewind_capture_pending = false;
+}
+
+bool E64::machine_t::run_ahead(uint8_t frames)
+{
+	run_ahead_frame_valid = false;
+	
+	/*
+	 * An input log only knows about one timeline
+	 */
+	if ((frames == 0) || (input_log->mode() != INPUT_LIVE)) return false;
+	
+	/*
+	 * Nor can the coprocessor's writes be rolled back
+	 */
+	if (coprocessor_enabled) return false;
+	
+	char *state;
+	size_t state_size;
+	
+	FILE *f = open_memstream(&state, &state_size);
+	save_core_state(f);
+	fclose(f);
+	
+	uint64_t idle_cycles = idle_cycles_skipped;
+	uint64_t instructions = instructions_executed;
+	uint32_t pixels_drawn = blitter->pixels_drawn;
+	uint32_t sid_cycles_run = sound->cycles_run;
+	uint32_t interrupts[8];
+	memcpy(interrupts, m68k->interrupts, sizeof(interrupts));
+	uint64_t trace_count;
+	m68k->save_trace(run_ahead_trace_log, &trace_count);
+	audio_sink_t *sink = audio;
+	audio = &default_audio_sink;
+	memcpy(run_ahead_fb, blitter->fb, VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES * sizeof(uint16_t));
+	blitter->start_journal();
+	running_ahead = true;
+	
+	/*
+	 * A breakpoint ends the speculation, it will be reached again
+	 * on the real timeline
+	 */
+	uint8_t frames_done = 0;
+	while (frames_done < frames) {
+		if (run(RUN_AHEAD_CYCLES_PER_STEP)) break;
+		if (frame_done()) frames_done++;
+	}
+	
+	if (frames_done == frames) {
+		std::swap_ranges(blitter->fb, blitter->fb + (VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES), run_ahead_fb);
+		run_ahead_frame_valid = true;
+	} else {
+		memcpy(blitter->fb, run_ahead_fb, VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES * sizeof(uint16_t));
+	}
+	
+	/*
+	 * Roll back. Only blocks on pages restored by the journal become
+	 * stale, the block cache and jit keep the rest.
+	 */
+	running_ahead = false;
+	for (uint32_t i = 0; i < blitter->journal_pages(); i++) {
+		mmu->track_writes(blitter->journal_page_number(i) << VIDEO_MEMORY_PAGE_SHIFT, VIDEO_MEMORY_PAGE_SIZE);
+	}
+	blitter->undo_journal();
+	f = fmemopen(state, state_size, "rb");
+	load_core_state(f);
+	fclose(f);
+	free(state);
+	audio = sink;
+	idle_cycles_skipped = idle_cycles;
+	instructions_executed = instructions;
+	blitter->pixels_drawn = pixels_drawn;
+	sound->cycles_run = sid_cycles_run;
+	memcpy(m68k->interrupts, interrupts, sizeof(interrupts));
+	m68k->restore_trace(run_ahead_trace_log, trace_count);
+	
+	return run_ahead_frame_valid;
+}
+
+void E64::machine_t::enable_coprocessor(bool enable)
+{
+	if (enable == coprocessor_enabled) return;
+	
+	if (enable) {
+		coprocessor_busy = false;
+		coprocessor_quit = false;
+		coprocessor_thread = new std::thread(&machine_t::coprocessor_loop, this);
+		coprocessor_release_pending = true;
+	} else {
+		wait_for_coprocessor();
+		{
+			std::lock_guard<std::mutex> lock(coprocessor_mutex);
+			coprocessor_quit = true;
+		}
+		coprocessor_condition.notify_all();
+		coprocessor_thread->join();
+		delete coprocessor_thread;
+		coprocessor_thread = nullptr;
+		coprocessor_release_pending = false;
+	}
+	
+	coprocessor_enabled = enable;
+	mailbox->coprocessor_present = enable;
+	printf("[Machine] Coprocessor %s\n", enable ? "enabled" : "disabled");
+	
+	apply_block_cache();
+}
+
+void E64::machine_t::enable_block_cache(bool enable)
+{
+	block_cache_requested = enable;
+	apply_block_cache();
+}
+
+void E64::machine_t::apply_block_cache()
+{
+	bool active = block_cache_requested && !coprocessor_enabled;
+	if (active != m68k->block_cache()) m68k->enable_block_cache(active);
+	
+	active = active && jit_requested;
+	if (active != m68k->jit_active()) {
+		if (m68k->enable_jit(active)) {
+			printf("[Machine] JIT %s\n", active ? "enabled" : "disabled");
+		}
+	}
+}
+
+void E64::machine_t::enable_jit(bool enable)
+{
+	jit_requested = enable;
+	apply_block_cache();
+}
+
+const char *E64::fpu_mode_names[FPU_MODES] = {
+	"none", "fast", "exact"
+};
+
+void E64::machine_t::set_fpu_mode(enum fpu_mode_t mode)
+{
+	if (mode == fpu_mode) return;
+	
+	fpu_mode = mode;
+	m68k->set_fpu_accuracy(mode == FPU_MODE_EXACT ? FPU_EXACT : FPU_FAST);
+	m68k->enable_fpu(mode != FPU_MODE_NONE);
+	printf("[Machine] FPU %s\n", fpu_mode_names[mode]);
+}
+
+void E64::machine_t::enable_hle(bool enable)
+{
+	if (enable == hle_requested) return;
+	
+	wait_for_coprocessor();
+	hle_requested = enable;
+	m68k->enable_hle(enable);
+	coprocessor->enable_hle(enable);
+	m68k_ic::patch_rom(mmu, enable);
+	printf("[Machine] HLE %s\n", enable ? "enabled" : "disabled");
+}
+
+void E64::machine_t::release_coprocessor()
+{
+	{
+		std::lock_guard<std::mutex> lock(coprocessor_mutex);
+		coprocessor_target = frame_clock + cpu_cycles_per_frame;
+		coprocessor_busy = true;
+	}
+	coprocessor_condition.notify_all();
+	coprocessor_release_pending = false;
+}
+
+void E64::machine_t::wait_for_coprocessor()
+{
+	if (!coprocessor_enabled) return;
+	
+	std::unique_lock<std::mutex> lock(coprocessor_mutex);
+	coprocessor_condition.wait(lock, [this] { return !coprocessor_busy; });
+}
+
+void E64::machine_t::coprocessor_loop()
+{
+	std::unique_lock<std::mutex> lock(coprocessor_mutex);
+	
+	for (;;) {
+		coprocessor_condition.wait(lock, [this] { return coprocessor_busy || coprocessor_quit; });
+		if (coprocessor_quit) return;
+		
+		int64_t target = coprocessor_target;
+		lock.unlock();
+		run_coprocessor(target);
+		lock.lock();
+		
+		coprocessor_busy = false;
+		coprocessor_condition.notify_all();
+	}
+}
+
+void E64::machine_t::run_coprocessor(int64_t target)
+{
+	while (coprocessor->getClock() < target) {
+		/*
+		 * A reset by the main cpu keeps the clock going
+		 */
+		if (mailbox->coprocessor_reset_requested()) {
+			int64_t clock = coprocessor->getClock();
+			coprocessor->reset();
+			coprocessor->setClock(clock);
+		}
+		
+		if (!mailbox->coprocessor_is_running()) {
+			/* halted, nothing happens up to the barrier */
+			coprocessor->setClock(target);
+			break;
+		}
+		
+		mailbox->update_interrupt(MAILBOX_COPROCESSOR);
+		
+		int64_t slice_end = std::min<int64_t>(coprocessor->getClock() + COPROCESSOR_SLICE_CYCLES, target);
+		if (!coprocessor->fast_forward(slice_end)) {
+			do {
+				coprocessor->execute();
+			} while (coprocessor->getClock() < slice_end);
+		}
+	}
+}
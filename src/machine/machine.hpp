@@ -8,14 +8,47 @@
 #ifndef MACHINE_HPP
 #define MACHINE_HPP
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "audio_sink.hpp"
 #include "cia.hpp"
 #include "clocks.hpp"
+#include "input_log.hpp"
+#include "mailbox.hpp"
 #include "mmu.hpp"
+#include "rewind_buffer.hpp"
 #include "sound.hpp"
+#include "state_hash_log.hpp"
 #include "timer.hpp"
 #include "blitter.hpp"
 #include "TTL74LS148.hpp"
 #include "m68k.hpp"
+#include "scheduler.hpp"
+#include "slow_frame_log.hpp"
+
+/*
+ * Maximum number of cpu cycles the sound ic is allowed to lag behind
+ */
+#define SOUND_SYNC_CYCLES	512
+
+/*
+ * The coprocessor checks for a reset, halt or doorbell interrupt
+ * after each slice of this number of cycles
+ */
+#define COPROCESSOR_SLICE_CYCLES	512
+
+/*
+ * Size of the steps taken while running ahead, no host events are
+ * processed in between
+ */
+#define RUN_AHEAD_CYCLES_PER_STEP	8192
+
+/*
+ * Save state format, bump version after any change in the layout of
+ * the machine or its components. States are stored in host byte order.
+ */
+#define STATE_VERSION		8
 
 namespace E64
 {
@@ -25,24 +58,162 @@ enum mode_t {
 	PAUSED
 };
 
+/*
+ * Floating point unit of the main cpu, a 68881 computing in host long
+ * doubles (fast) or with exact extended precision in softfloat
+ */
+enum fpu_mode_t {
+	FPU_MODE_NONE,
+	FPU_MODE_FAST,
+	FPU_MODE_EXACT
+};
+
+#define FPU_MODES	3
+
+extern const char *fpu_mode_names[FPU_MODES];
+
 class machine_t {
 private:	
 	clocks *cpu_to_sid;
 	char machine_help_string[2048];
 	int32_t m68k_cycle_saldo;
-	int32_t frame_cycle_saldo;
 	bool frame_is_done;
 	
+	/*
+	 * Moments (cpu clock) up to which timer, cia and sound have run,
+	 * and start of the current frame
+	 */
+	int64_t timer_clock;
+	int64_t cia_clock;
+	int64_t sound_clock;
+	int64_t frame_clock;
+	
+	/*
+	 * Cpu clock as a multiple of CPU_CLOCK_SPEED. Timer, cia and
+	 * sound are clocked from the cpu and follow, as does the length
+	 * of a frame in cycles. Only the cpu gets more done per frame.
+	 */
+	uint8_t cpu_clock_multiplier;
+	uint32_t cpu_cycles_per_frame;
+	void apply_cpu_clock();
+	
+	scheduler_t *scheduler;
+	
+	uint64_t idle_cycles_skipped;
+	uint64_t instructions_executed;
+	void process_events();
+	void sync_cia();
+	void sync_sound();
+	void end_frame();
+	
 	/*
 	 * Keeping track of soundbuffer and its performance
 	 */
 	uint64_t underruns, equalruns, overruns;
 	uint64_t under_lap, equal_lap, over_lap;
 	
+	/*
+	 * Target size of the host audio queue, AUDIO_BUFFER_SIZE by
+	 * default. Smaller means less latency and more risk of underruns.
+	 */
+	double audio_buffer_size;
+	
 	bool recording_sound;
 	
-	void start_recording_sound();
-	void stop_recording_sound();
+	/*
+	 * Sound goes to the connected audio sink. Without one, it's
+	 * discarded by the default sink.
+	 */
+	audio_sink_t default_audio_sink;
+	audio_sink_t *audio;
+	
+	/*
+	 * Keyboard state as seen by the cia
+	 */
+	uint8_t key_states[128];
+	
+	input_log_t *input_log;
+	void replay_input();
+	
+	void save_core_state(FILE *f);
+	void load_core_state(FILE *f);
+	
+	/*
+	 * A snapshot is taken at the end of a frame, but only after
+	 * leaving run(), when the machine is in a consistent state
+	 */
+	rewind_buffer_t *rewind_buffer;
+	bool rewind_capture_pending;
+	void capture_rewind_snapshot();
+	
+	/*
+	 * While running ahead, the machine runs on a speculative timeline
+	 * that will be rolled back. The framebuffer of the last
+	 * speculative frame is kept for display.
+	 */
+	bool running_ahead;
+	bool run_ahead_frame_valid;
+	uint16_t *run_ahead_fb;
+	m68k_ic::trace_entry_t *run_ahead_trace_log;
+	
+	/*
+	 * Only one in every render_interval frames is drawn by the
+	 * blitter, the others are discarded
+	 */
+	uint16_t render_interval;
+	uint16_t render_counter;
+	bool last_frame_rendered;
+	
+	/*
+	 * Hashes of cpu, ram, framebuffer, timer and sound, taken at the
+	 * frame event itself. That moment doesn't depend on the number
+	 * of cycles run per call, so runs with different step sizes
+	 * can be compared.
+	 */
+	state_hash_log_t *state_hash_log;
+	void log_state_hashes();
+	
+	/*
+	 * Profiles of the current and the last finished frame, only
+	 * kept while the slow frame log is active
+	 */
+	slow_frame_log_t *slow_frame_log;
+	frame_profile_t *frame_profile;
+	frame_profile_t *last_frame_profile;
+	void finish_frame_profile();
+	
+	/*
+	 * The coprocessor runs on a host thread of its own. At the start
+	 * of run(), the main thread releases it up to the end of the
+	 * current frame, and at the end of the frame (before the blitter
+	 * runs) it waits for it. From there until the next call to
+	 * run(), the coprocessor is idle. Snapshots, save states and
+	 * hashes see both cpu's at the same moment.
+	 */
+	bool coprocessor_enabled;
+	bool coprocessor_release_pending;
+	std::thread *coprocessor_thread;
+	std::mutex coprocessor_mutex;
+	std::condition_variable coprocessor_condition;
+	bool coprocessor_busy;
+	bool coprocessor_quit;
+	int64_t coprocessor_target;
+	void coprocessor_loop();
+	void run_coprocessor(int64_t target);
+	void release_coprocessor();
+	void wait_for_coprocessor();
+	
+	/*
+	 * The coprocessor writes shared ram without write tracking, so
+	 * the block cache is only active without it
+	 */
+	bool block_cache_requested;
+	bool jit_requested;
+	void apply_block_cache();
+	
+	enum fpu_mode_t fpu_mode;
+	
+	bool hle_requested;
 public:
 	enum mode_t mode;
 
@@ -53,11 +224,22 @@ public:
 	blitter_ic	*blitter;
 	sound_ic	*sound;
 	cia_ic		*cia;
+	
+	TTL74LS148_ic	*coprocessor_TTL74LS148;
+	m68k_ic		*coprocessor;
+	mailbox_ic	*mailbox;
 
 	machine_t();
 	~machine_t();
 
 	bool run(uint16_t no_of_cycles);
+	
+	/*
+	 * Brings the timer up to date with the cpu and reschedules its
+	 * next event. Must be called around register writes from the
+	 * cpu, as these may change the moment of the next interrupt.
+	 */
+	void sync_timer();
 
 	void reset();
 	
@@ -70,14 +252,147 @@ public:
 		return result;
 	}
 	
-	inline int32_t frame_cycles() { return frame_cycle_saldo; }
+	int32_t frame_cycles();
+	inline uint32_t cycles_per_frame() { return cpu_cycles_per_frame; }
+	
+	/*
+	 * Changes the cpu clock multiplier (1 up to and including
+	 * CPU_CLOCK_MULTIPLIER_MAX) between frames or halfway one. Not
+	 * possible with an active input log.
+	 */
+	bool set_cpu_clock_multiplier(uint8_t multiplier);
+	inline uint8_t get_cpu_clock_multiplier() { return cpu_clock_multiplier; }
+	
+	inline uint64_t idle_cycles() { return idle_cycles_skipped; }
+	inline uint64_t instructions() { return instructions_executed; }
+	
+	/*
+	 * FNV-1a hash over all ram, for comparing runs
+	 */
+	uint64_t ram_hash();
 	
 	/*
 	 * Sound related
 	 */
+	void connect_audio_sink(audio_sink_t *sink);
 	void toggle_recording_sound();
 	inline bool recording() { return recording_sound; }
 	bool buffer_within_specs();
+	inline void set_audio_buffer_size(uint32_t size) { audio_buffer_size = size; }
+	inline uint32_t get_audio_buffer_size() { return audio_buffer_size; }
+	
+	/*
+	 * Input related
+	 */
+	void update_key_states(uint8_t *states);
+	
+	/*
+	 * Recording and replay of keyboard input. Both start with a
+	 * fresh machine (memory contents and reset), and use a fixed
+	 * clock for the sound ic so the guest runs bit identical. While
+	 * replaying, live input is ignored. A reset stops the log.
+	 */
+	bool start_input_recording(const char *path);
+	bool start_input_replay(const char *path);
+	void stop_input_log();
+	inline enum input_log_mode_t input_mode() { return input_log->mode(); }
+	
+	/*
+	 * Save states, full machine state in a binary file. After a
+	 * failed load, the machine is reset.
+	 */
+	bool save_state(const char *path);
+	bool load_state(const char *path);
+	
+	/*
+	 * Rewinding, one snapshot per frame for the last number of
+	 * seconds (0 disables). Rewinding 1 frame goes back to the start
+	 * of the current frame.
+	 */
+	void enable_rewind(uint32_t seconds);
+	uint32_t rewind_available();
+	bool rewind(uint32_t frames);
+	
+	/*
+	 * Running ahead, to be called right after a frame is done and
+	 * host input has been processed. Emulates a number of frames
+	 * with current input, keeps the last framebuffer and rolls back
+	 * the machine. Only the framebuffer of the speculative frame
+	 * differs from a machine that never ran ahead. Not available
+	 * with an active input log or coprocessor. Returns true if a
+	 * speculative frame is available.
+	 */
+	bool run_ahead(uint8_t frames);
+	
+	/*
+	 * Framebuffer to show on the host, the one of the speculative
+	 * frame after a successful run ahead
+	 */
+	inline uint16_t *display_fb() {
+		return run_ahead_frame_valid ? run_ahead_fb : blitter->fb;
+	}
+	
+	/*
+	 * Frame skipping, draw only one in every number of frames (1
+	 * draws all). Guest state is not affected, only the contents of
+	 * the framebuffer. frame_rendered() tells if the blitter ran at
+	 * the end of the last frame.
+	 */
+	void set_render_interval(uint16_t frames);
+	inline uint16_t get_render_interval() { return render_interval; }
+	inline bool frame_rendered() { return last_frame_rendered; }
+	
+	/*
+	 * Writes the state hashes at the end of every frame to a file,
+	 * to detect divergence between runs (see E64-compare)
+	 */
+	bool start_state_hashing(const char *path);
+	void stop_state_hashing();
+	
+	/*
+	 * Second 68020 sharing ram and rom, halted until the main cpu
+	 * starts it through the mailbox. Memory shared between both
+	 * cpu's isn't deterministic within a frame.
+	 */
+	void enable_coprocessor(bool enable);
+	inline bool coprocessor_available() { return coprocessor_enabled; }
+	
+	/*
+	 * Decoded basic blocks for the main cpu (see m68k.hpp)
+	 */
+	void enable_block_cache(bool enable);
+	inline bool block_cache_active() { return m68k->block_cache(); }
+	
+	/*
+	 * Translation of hot blocks to host code, on top of the block
+	 * cache (see m68k_jit.hpp)
+	 */
+	void enable_jit(bool enable);
+	inline bool jit_active() { return m68k->jit_active(); }
+	
+	/*
+	 * Only the main cpu gets an fpu, the softfloat state is shared
+	 * by all threads. Part of the save state.
+	 */
+	void set_fpu_mode(enum fpu_mode_t mode);
+	inline enum fpu_mode_t get_fpu_mode() { return fpu_mode; }
+	
+	/*
+	 * Runs hot kernel routines natively (see m68k_hle.cpp), with
+	 * the same results and timing as the interpreter
+	 */
+	void enable_hle(bool enable);
+	inline bool hle_active() { return m68k->hle(); }
+	
+	/*
+	 * Profiles each frame on the guest side. When the host finds a
+	 * frame too slow, it calls log_slow_frame() right after the frame
+	 * is done, with its own measurement and budget in microseconds.
+	 */
+	bool start_slow_frame_log(const char *path);
+	void stop_slow_frame_log();
+	inline bool slow_frame_logging() { return slow_frame_log->active(); }
+	void log_slow_frame(uint32_t vm_time, uint32_t budget);
 };
 
 }
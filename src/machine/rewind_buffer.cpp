@@ -0,0 +1,151 @@
+/*
+ * rewind_buffer.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "rewind_buffer.hpp"
+
+E64::rewind_buffer_t::rewind_buffer_t()
+{
+	snapshots = nullptr;
+	no_of_snapshots = 0;
+	oldest = count = 0;
+	shadow = nullptr;
+	full_sync_needed = true;
+}
+
+E64::rewind_buffer_t::~rewind_buffer_t()
+{
+	resize(0);
+}
+
+void E64::rewind_buffer_t::resize(uint32_t no)
+{
+	clear();
+	
+	delete [] snapshots;
+	delete [] shadow;
+	snapshots = nullptr;
+	shadow = nullptr;
+	
+	no_of_snapshots = no;
+	
+	if (no_of_snapshots) {
+		snapshots = new struct rewind_snapshot_t[no_of_snapshots];
+		shadow = new uint8_t[VIDEO_MEMORY_PAGES * VIDEO_MEMORY_PAGE_SIZE];
+	}
+}
+
+void E64::rewind_buffer_t::drop(struct rewind_snapshot_t *snapshot)
+{
+	free(snapshot->state);
+	delete [] snapshot->page_numbers;
+	delete [] snapshot->page_data;
+}
+
+void E64::rewind_buffer_t::clear()
+{
+	while (count) {
+		drop(latest());
+		count--;
+	}
+	oldest = 0;
+	full_sync_needed = true;
+}
+
+void E64::rewind_buffer_t::capture(blitter_ic *blitter, uint8_t *state, size_t state_size)
+{
+	if (!no_of_snapshots) {
+		free(state);
+		return;
+	}
+	
+	if (count == no_of_snapshots) {
+		drop(&snapshots[oldest]);
+		oldest = (oldest + 1) % no_of_snapshots;
+		count--;
+	}
+	
+	count++;
+	struct rewind_snapshot_t *snapshot = latest();
+	
+	snapshot->state = state;
+	snapshot->state_size = state_size;
+	snapshot->no_of_pages = 0;
+	snapshot->page_numbers = nullptr;
+	snapshot->page_data = nullptr;
+	
+	if (full_sync_needed) {
+		/*
+		 * No history before this snapshot
+		 */
+		for (int page=0; page<VIDEO_MEMORY_PAGES; page++) {
+			memcpy(&shadow[page * VIDEO_MEMORY_PAGE_SIZE],
+			       blitter->video_memory_page(page), VIDEO_MEMORY_PAGE_SIZE);
+		}
+		full_sync_needed = false;
+	} else {
+		uint16_t dirty = 0;
+		for (int page=0; page<VIDEO_MEMORY_PAGES; page++) {
+			if (blitter->page_dirty(page)) dirty++;
+		}
+		
+		if (dirty) {
+			snapshot->page_numbers = new uint16_t[dirty];
+			snapshot->page_data = new uint8_t[dirty * VIDEO_MEMORY_PAGE_SIZE];
+			
+			for (int page=0; page<VIDEO_MEMORY_PAGES; page++) {
+				if (blitter->page_dirty(page)) {
+					uint8_t *old_contents = &shadow[page * VIDEO_MEMORY_PAGE_SIZE];
+					snapshot->page_numbers[snapshot->no_of_pages] = page;
+					memcpy(&snapshot->page_data[snapshot->no_of_pages * VIDEO_MEMORY_PAGE_SIZE],
+					       old_contents, VIDEO_MEMORY_PAGE_SIZE);
+					memcpy(old_contents, blitter->video_memory_page(page), VIDEO_MEMORY_PAGE_SIZE);
+					snapshot->no_of_pages++;
+				}
+			}
+		}
+	}
+	
+	blitter->clear_dirty_pages();
+}
+
+void E64::rewind_buffer_t::restore(uint32_t frames, blitter_ic *blitter, uint8_t **state, size_t *state_size)
+{
+	/*
+	 * Back to the latest snapshot, pages written since then are
+	 * still in the shadow copy
+	 */
+	for (int page=0; page<VIDEO_MEMORY_PAGES; page++) {
+		if (blitter->page_dirty(page)) {
+			memcpy(blitter->video_memory_page(page),
+			       &shadow[page * VIDEO_MEMORY_PAGE_SIZE], VIDEO_MEMORY_PAGE_SIZE);
+		}
+	}
+	blitter->clear_dirty_pages();
+	
+	/*
+	 * Then undo complete frames, newest first
+	 */
+	while ((frames > 1) && (count > 1)) {
+		struct rewind_snapshot_t *snapshot = latest();
+		
+		for (int i=0; i<snapshot->no_of_pages; i++) {
+			uint8_t *old_contents = &snapshot->page_data[i * VIDEO_MEMORY_PAGE_SIZE];
+			uint16_t page = snapshot->page_numbers[i];
+			memcpy(blitter->video_memory_page(page), old_contents, VIDEO_MEMORY_PAGE_SIZE);
+			memcpy(&shadow[page * VIDEO_MEMORY_PAGE_SIZE], old_contents, VIDEO_MEMORY_PAGE_SIZE);
+		}
+		
+		drop(snapshot);
+		count--;
+		frames--;
+	}
+	
+	*state = latest()->state;
+	*state_size = latest()->state_size;
+}
@@ -0,0 +1,84 @@
+/*
+ * rewind_buffer.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Ring of snapshots, one per frame. Each snapshot holds the machine
+ * state without video memory (a serialized blob), plus the previous
+ * contents of the 4kb pages that were written during its frame. A
+ * shadow copy of video memory, kept up to date with only the dirty
+ * pages, provides those previous contents. So per frame, only written
+ * pages are copied instead of all 16mb.
+ */
+
+#ifndef REWIND_BUFFER_HPP
+#define REWIND_BUFFER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include "blitter.hpp"
+
+namespace E64
+{
+
+struct rewind_snapshot_t {
+	uint8_t *state;
+	size_t state_size;
+	
+	uint16_t no_of_pages;
+	uint16_t *page_numbers;
+	uint8_t *page_data;
+};
+
+class rewind_buffer_t {
+private:
+	struct rewind_snapshot_t *snapshots;
+	uint32_t no_of_snapshots;
+	uint32_t oldest;
+	uint32_t count;
+	
+	uint8_t *shadow;
+	bool full_sync_needed;
+	
+	inline struct rewind_snapshot_t *latest()
+	{
+		return &snapshots[(oldest + count - 1) % no_of_snapshots];
+	}
+	void drop(struct rewind_snapshot_t *snapshot);
+public:
+	rewind_buffer_t();
+	~rewind_buffer_t();
+	
+	/*
+	 * Maximum number of snapshots, 0 disables the buffer
+	 */
+	void resize(uint32_t no);
+	inline uint32_t capacity() { return no_of_snapshots; }
+	inline uint32_t size() { return count; }
+	
+	/*
+	 * Drops all snapshots, e.g. after a reset. The next capture
+	 * synchronizes the complete shadow copy.
+	 */
+	void clear();
+	
+	/*
+	 * Takes ownership of state (allocated with malloc)
+	 */
+	void capture(blitter_ic *blitter, uint8_t *state, size_t state_size);
+	
+	/*
+	 * Brings video memory back to the snapshot that is frames - 1
+	 * before the latest one, and drops all newer snapshots. Returns
+	 * that snapshot's state in state and state_size (still owned by
+	 * the buffer).
+	 */
+	void restore(uint32_t frames, blitter_ic *blitter, uint8_t **state, size_t *state_size);
+};
+
+}
+
+#endif
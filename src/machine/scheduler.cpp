@@ -0,0 +1,67 @@
+/*
+ * scheduler.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include "scheduler.hpp"
+
+#define	NEVER	INT64_MAX
+
+E64::scheduler_t::scheduler_t()
+{
+	reset();
+}
+
+void E64::scheduler_t::reset()
+{
+	for (int i=0; i<NO_OF_EVENTS; i++) deadlines[i] = NEVER;
+	next = NEVER;
+}
+
+void E64::scheduler_t::schedule(enum event_t event, int64_t moment)
+{
+	deadlines[event] = moment;
+	find_next();
+}
+
+void E64::scheduler_t::cancel(enum event_t event)
+{
+	deadlines[event] = NEVER;
+	find_next();
+}
+
+enum E64::event_t E64::scheduler_t::pop(int64_t moment)
+{
+	if (next > moment) return NO_OF_EVENTS;
+	
+	int earliest = 0;
+	for (int i=1; i<NO_OF_EVENTS; i++) {
+		if (deadlines[i] < deadlines[earliest]) earliest = i;
+	}
+	
+	deadlines[earliest] = NEVER;
+	find_next();
+	
+	return (enum event_t)earliest;
+}
+
+void E64::scheduler_t::find_next()
+{
+	next = deadlines[0];
+	for (int i=1; i<NO_OF_EVENTS; i++) {
+		if (deadlines[i] < next) next = deadlines[i];
+	}
+}
+
+void E64::scheduler_t::save_state(FILE *f)
+{
+	fwrite(deadlines, sizeof(int64_t), NO_OF_EVENTS, f);
+}
+
+void E64::scheduler_t::load_state(FILE *f)
+{
+	fread(deadlines, sizeof(int64_t), NO_OF_EVENTS, f);
+	find_next();
+}
@@ -0,0 +1,69 @@
+/*
+ * scheduler.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * The scheduler keeps track of the moments (in cpu cycles since reset)
+ * at which the other ic's need attention from the machine. In between
+ * those moments, the cpu can run in a tight loop without stepping any
+ * other ic.
+ */
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+namespace E64
+{
+
+enum event_t {
+	EVENT_TIMER,
+	EVENT_CIA,
+	EVENT_SOUND,
+	EVENT_FRAME,
+	EVENT_INPUT,
+	NO_OF_EVENTS
+};
+
+class scheduler_t {
+private:
+	int64_t deadlines[NO_OF_EVENTS];
+	
+	/*
+	 * Cached value of the earliest deadline
+	 */
+	int64_t next;
+	
+	void find_next();
+public:
+	scheduler_t();
+	
+	/*
+	 * Cancels all pending events
+	 */
+	void reset();
+	
+	void schedule(enum event_t event, int64_t moment);
+	void cancel(enum event_t event);
+	
+	inline int64_t next_event() { return next; }
+	inline int64_t deadline(enum event_t event) { return deadlines[event]; }
+	
+	/*
+	 * Returns the earliest event that is due at moment and removes
+	 * it from the queue. Returns NO_OF_EVENTS if nothing is due.
+	 */
+	enum event_t pop(int64_t moment);
+	
+	void save_state(FILE *f);
+	void load_state(FILE *f);
+};
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * slow_frame_log.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include <algorithm>
+#include "slow_frame_log.hpp"
+
+void E64::frame_profile_t::start(int64_t clock, uint64_t idle_cycles_skipped)
+{
+	start_clock = end_clock = clock;
+	start_idle_cycles = idle_cycles_skipped;
+	idle_cycles = 0;
+	no_of_pc_samples = 0;
+	blitter_operations = 0;
+	blitter_pixels = 0;
+	sid_cycles = 0;
+	for (int i = 0; i < 8; i++) interrupts[i] = 0;
+}
+
+E64::slow_frame_log_t::slow_frame_log_t()
+{
+	file = nullptr;
+	frame = 0;
+	slow_frames = 0;
+}
+
+E64::slow_frame_log_t::~slow_frame_log_t()
+{
+	stop();
+}
+
+bool E64::slow_frame_log_t::start(const char *path)
+{
+	stop();
+	
+	file = fopen(path, "w");
+	if (!file) {
+		printf("[Slow frames] Error: can't open %s for writing\n", path);
+		return false;
+	}
+	
+	fprintf(file, "# E64 slow frames\n");
+	
+	frame = 0;
+	slow_frames = 0;
+	printf("[Slow frames] Logging frames over budget to %s\n", path);
+	return true;
+}
+
+void E64::slow_frame_log_t::stop()
+{
+	if (file) {
+		fclose(file);
+		file = nullptr;
+		printf("[Slow frames] %lu of %lu frames over budget\n", (unsigned long)slow_frames, (unsigned long)frame);
+	}
+}
+
+void E64::slow_frame_log_t::write(frame_profile_t *profile, uint32_t vm_time, uint32_t budget)
+{
+	slow_frames++;
+	
+	fprintf(file, "\nframe %lu (ends at cycle %li): vm %.2f ms, budget %.2f ms\n",
+		(unsigned long)(frame - 1), (long)profile->end_clock,
+		(double)vm_time / 1000, (double)budget / 1000);
+	fprintf(file, "  cpu:        %li cycles, %lu idle cycles skipped\n",
+		(long)(profile->end_clock - profile->start_clock), (unsigned long)profile->idle_cycles);
+	fprintf(file, "  blitter:    %u operations, %u pixels\n",
+		profile->blitter_operations, profile->blitter_pixels);
+	fprintf(file, "  sound:      %u sid cycles\n", profile->sid_cycles);
+	fprintf(file, "  interrupts:");
+	for (int i = 1; i < 8; i++) fprintf(file, " %u:%u", i, profile->interrupts[i]);
+	fprintf(file, "\n");
+	
+	/*
+	 * Histogram, most frequent program counters first
+	 */
+	uint32_t *samples = profile->pc_samples;
+	uint32_t no_of_samples = profile->no_of_pc_samples;
+	std::sort(samples, samples + no_of_samples);
+	
+	uint32_t pcs[FRAME_PROFILE_TOP_PCS];
+	uint32_t counts[FRAME_PROFILE_TOP_PCS];
+	int no_of_pcs = 0;
+	
+	for (uint32_t i = 0; i < no_of_samples; ) {
+		uint32_t j = i;
+		while ((j < no_of_samples) && (samples[j] == samples[i])) j++;
+		
+		/*
+		 * Insert into the sorted top list
+		 */
+		int k = (no_of_pcs < FRAME_PROFILE_TOP_PCS) ? no_of_pcs++ : FRAME_PROFILE_TOP_PCS;
+		while ((k > 0) && (counts[k - 1] < j - i)) {
+			if (k < FRAME_PROFILE_TOP_PCS) {
+				pcs[k] = pcs[k - 1];
+				counts[k] = counts[k - 1];
+			}
+			k--;
+		}
+		if (k < FRAME_PROFILE_TOP_PCS) {
+			pcs[k] = samples[i];
+			counts[k] = j - i;
+		}
+		i = j;
+	}
+	
+	fprintf(file, "  pc samples: %u\n", no_of_samples);
+	for (int i = 0; i < no_of_pcs; i++) {
+		fprintf(file, "    %08x %6u %6.2f%%\n", pcs[i], counts[i], 100.0 * counts[i] / no_of_samples);
+	}
+	fflush(file);
+}
@@ -0,0 +1,77 @@
+/*
+ * slow_frame_log.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Guest side diagnostics of frames that took the host too long. During
+ * each frame, the machine samples the program counter and counts
+ * blitter work, sid cycles and interrupts. When the host measures a
+ * frame over budget, the profile of that frame is appended to the log.
+ * This tells whether the cpu, the blitter or sound caused a stutter.
+ *
+ * File layout (text): a block of lines per slow frame.
+ */
+
+#ifndef SLOW_FRAME_LOG_HPP
+#define SLOW_FRAME_LOG_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+/*
+ * The pc is sampled once per pass through the scheduler, that's at
+ * least every SOUND_SYNC_CYCLES
+ */
+#define FRAME_PROFILE_MAX_SAMPLES	4096
+#define FRAME_PROFILE_TOP_PCS		16
+
+namespace E64
+{
+
+struct frame_profile_t {
+	int64_t start_clock;
+	int64_t end_clock;
+	uint64_t start_idle_cycles;
+	uint64_t idle_cycles;
+	uint32_t no_of_pc_samples;
+	uint32_t pc_samples[FRAME_PROFILE_MAX_SAMPLES];
+	uint32_t blitter_operations;
+	uint32_t blitter_pixels;
+	uint32_t sid_cycles;
+	uint32_t interrupts[8];
+	
+	void start(int64_t clock, uint64_t idle_cycles_skipped);
+	
+	inline void sample_pc(uint32_t pc)
+	{
+		if (no_of_pc_samples < FRAME_PROFILE_MAX_SAMPLES) pc_samples[no_of_pc_samples++] = pc;
+	}
+};
+
+class slow_frame_log_t {
+private:
+	FILE *file;
+	uint64_t frame;
+	uint64_t slow_frames;
+public:
+	slow_frame_log_t();
+	~slow_frame_log_t();
+	
+	bool start(const char *path);
+	void stop();
+	
+	inline bool active() { return file != nullptr; }
+	inline void frame_done() { frame++; }
+	
+	/*
+	 * Host times in microseconds. Sorts the pc samples.
+	 */
+	void write(frame_profile_t *profile, uint32_t vm_time, uint32_t budget);
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * state_hash_log.cpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+#include <cstring>
+#include "state_hash_log.hpp"
+
+const char *E64::state_hash_subsystem_names[STATE_HASH_SUBSYSTEMS] = {
+	"cpu", "ram", "fb", "timer", "sound"
+};
+
+E64::state_hash_log_t::state_hash_log_t()
+{
+	file = nullptr;
+	frame = 0;
+}
+
+E64::state_hash_log_t::~state_hash_log_t()
+{
+	stop();
+}
+
+bool E64::state_hash_log_t::start(const char *path)
+{
+	stop();
+	
+	file = fopen(path, "w");
+	if (!file) {
+		printf("[Hashes] Error: can't open %s for writing\n", path);
+		return false;
+	}
+	
+	fprintf(file, "# E64 state hashes: frame");
+	for (int i = 0; i < STATE_HASH_SUBSYSTEMS; i++) fprintf(file, " %s", state_hash_subsystem_names[i]);
+	fprintf(file, "\n");
+	
+	frame = 0;
+	printf("[Hashes] Writing state hash per frame to %s\n", path);
+	return true;
+}
+
+void E64::state_hash_log_t::stop()
+{
+	if (file) {
+		fclose(file);
+		file = nullptr;
+		printf("[Hashes] Stopped after %lu frames\n", (unsigned long)frame);
+	}
+}
+
+void E64::state_hash_log_t::write(uint64_t *hashes)
+{
+	fprintf(file, "%lu", (unsigned long)frame);
+	for (int i = 0; i < STATE_HASH_SUBSYSTEMS; i++) fprintf(file, " %016lx", (unsigned long)hashes[i]);
+	fprintf(file, "\n");
+	frame++;
+}
+
+uint64_t E64::state_hash_log_t::hash(const void *data, size_t size, uint64_t hash)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	
+	while (size >= 8) {
+		uint64_t word;
+		memcpy(&word, bytes, 8);
+		hash ^= word;
+		hash *= 0x100000001b3;
+		bytes += 8;
+		size -= 8;
+	}
+	while (size--) {
+		hash ^= *bytes++;
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
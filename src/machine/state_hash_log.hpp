@@ -0,0 +1,62 @@
+/*
+ * state_hash_log.hpp
+ * E64
+ *
+ * Copyright © 2023 elmerucr. All rights reserved.
+ */
+
+/*
+ * Log of machine state hashes, one line per frame. Two runs that
+ * should behave the same (e.g. before and after a change to the core)
+ * can be compared with E64-compare, which reports the first frame and
+ * subsystem that diverge.
+ *
+ * File layout (text): a header line starting with '#', followed by
+ * lines with the frame number and one 64 bit hex hash per subsystem.
+ */
+
+#ifndef STATE_HASH_LOG_HPP
+#define STATE_HASH_LOG_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+namespace E64
+{
+
+enum state_hash_subsystem_t {
+	STATE_HASH_CPU,
+	STATE_HASH_RAM,
+	STATE_HASH_FB,
+	STATE_HASH_TIMER,
+	STATE_HASH_SOUND,
+	STATE_HASH_SUBSYSTEMS
+};
+
+extern const char *state_hash_subsystem_names[STATE_HASH_SUBSYSTEMS];
+
+class state_hash_log_t {
+private:
+	FILE *file;
+	uint64_t frame;
+public:
+	state_hash_log_t();
+	~state_hash_log_t();
+	
+	bool start(const char *path);
+	void stop();
+	
+	inline bool active() { return file != nullptr; }
+	
+	void write(uint64_t *hashes);
+	
+	/*
+	 * FNV-1a over 64 bit words (host byte order), a trailing part
+	 * is hashed per byte
+	 */
+	static uint64_t hash(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325);
+};
+
+}
+
+#endif
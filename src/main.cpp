@@ -6,13 +6,19 @@
  */
 
 #include <cstdio>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include "common.hpp"
 #include "hud.hpp"
 #include "sdl2.hpp"
 
-#define	CYCLES_PER_STEP	511
+/*
+ * Sid sampling methods by their number in the performance profile
+ */
+static const sampling_method sid_sampling_methods[3] = {
+	SAMPLE_FAST, SAMPLE_INTERPOLATE, SAMPLE_RESAMPLE_INTERPOLATE
+};
 
 /*
  * global components
@@ -21,9 +27,13 @@ E64::host_t	host;
 E64::hud_t	hud;
 E64::stats_t	stats;
 E64::machine_t	machine;
-bool		app_running;
+std::atomic<bool> app_running;
 std::chrono::time_point<std::chrono::steady_clock> start_time, end_time, refresh_moment;
 
+static void emulate();
+static void process_host_events();
+static void set_turbo(bool on);
+static void update_render_interval();
 static void finish_frame();
 
 int main(int argc, char **argv)
@@ -34,9 +44,38 @@ int main(int argc, char **argv)
 	
 	app_running = true;
 	
+	machine.connect_audio_sink(host.audio);
+	machine.enable_rewind(host.settings->rewind_seconds);
+	machine.enable_coprocessor(host.settings->coprocessor);
+	machine.enable_block_cache(host.settings->block_cache);
+	machine.enable_jit(host.settings->jit);
+	machine.set_fpu_mode((enum E64::fpu_mode_t)host.settings->fpu_mode_at_init);
+	machine.enable_hle(host.settings->hle);
+	machine.set_audio_buffer_size(host.settings->audio_buffer_size);
+	machine.sound->set_sampling_method(sid_sampling_methods[host.settings->sid_sampling]);
+	if (host.settings->use_custom_rom)
+		machine.mmu->use_custom_rom(host.settings->rom_path);
+	
 	hud.reset();
 	machine.reset();
+	machine.set_cpu_clock_multiplier(host.settings->cpu_clock_multiplier_at_init);
 	stats.reset();
+	set_turbo(host.settings->turbo);
+	
+	if (host.settings->load_state_path)
+		machine.load_state(host.settings->load_state_path);
+	
+	if (host.settings->replay_input_path) {
+		machine.start_input_replay(host.settings->replay_input_path);
+	} else if (host.settings->record_input_path) {
+		machine.start_input_recording(host.settings->record_input_path);
+	}
+	
+	if (host.settings->state_hashes_path)
+		machine.start_state_hashing(host.settings->state_hashes_path);
+	
+	if (host.settings->slow_frame_log_path)
+		machine.start_slow_frame_log(host.settings->slow_frame_log_path);
 
 	/*
 	 * Initial machine mode
@@ -46,83 +85,194 @@ int main(int argc, char **argv)
 	 */
 	machine.mode = E64::RUNNING;
 	
-	host.video->update_title();
+	start_time = std::chrono::steady_clock::now();
+	
+	/*
+	 * Machine and hud run on their own thread. Sdl wants event
+	 * handling and rendering on the main thread, so that's where
+	 * presentation stays. A blocking present (vsync) doesn't take
+	 * any time from the emulation this way.
+	 */
+	std::thread emulation_thread(emulate);
+	
+	while (app_running) {
+		if (E64::sdl2_process_events() == E64::QUIT_EVENT) app_running = false;
+		
+		if (host.frames->acquire()) {
+			host.video->update_textures(host.frames->front_frame());
+			host.video->update_screen();
+		} else {
+			std::this_thread::sleep_for(std::chrono::microseconds(host.settings->present_poll_time));
+		}
+	}
+	
+	emulation_thread.join();
+	
+	end_time = std::chrono::steady_clock::now();
 	
-	start_time = refresh_moment = std::chrono::steady_clock::now();
+	printf("[E64] Virtual machine ran for %.2f seconds\n",
+	       (double)std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() / 1000
+	);
 
+	E64::sdl2_cleanup();
+	return 0;
+}
+
+static void emulate()
+{
+	refresh_moment = std::chrono::steady_clock::now();
+	
 	while (app_running) {
 		switch (machine.mode) {
 			case E64::RUNNING:
-				if (machine.run(CYCLES_PER_STEP)) {
+				if (machine.run(host.settings->cycles_per_step)) {
 					machine.flip_modes();
 					hud.blitter->terminal_printf(hud.terminal->number, "breakpoint reached at $%06x\n", machine.m68k->getPC());
 				}
 				if (machine.frame_done()) finish_frame();
 				break;
 			case E64::PAUSED:
-				hud.run(CYCLES_PER_STEP);
+				hud.run(host.settings->cycles_per_step);
 				if (hud.frame_done()) finish_frame();
 				break;
 		}
 	}
+}
+
+static void process_host_events()
+{
+	struct E64::host_event_t event;
 	
-	end_time = std::chrono::steady_clock::now();
+	while (host.events->pop(&event)) {
+		switch (event.type) {
+			case E64::HOST_EVENT_KEY_STATES:
+				host.update_key_states(event.key_states);
+				break;
+			case E64::HOST_EVENT_RESET:
+				machine.reset();
+				stats.reset();
+				break;
+			case E64::HOST_EVENT_TOGGLE_RECORDING_SOUND:
+				machine.toggle_recording_sound();
+				hud.show_notification(machine.recording() ? "start recording sound" : "stop recording sound");
+				break;
+			case E64::HOST_EVENT_FLIP_MODES:
+				machine.flip_modes();
+				break;
+			case E64::HOST_EVENT_TOGGLE_STATS:
+				hud.toggle_stats();
+				break;
+			case E64::HOST_EVENT_TOGGLE_TURBO:
+				set_turbo(!host.settings->turbo);
+				if (host.settings->turbo) {
+					hud.show_notification("turbo on, drawing 1 in %u frames", host.settings->turbo_render_interval);
+				} else {
+					hud.show_notification("turbo off");
+				}
+				break;
+			case E64::HOST_EVENT_INSERT_BINARY:
+				if (machine.mmu->insert_binary(event.text)) {
+					hud.show_notification("%s\n\n"
+							      "loading $%04x bytes from $%04x to $%04x",
+							      event.text,
+							      machine.mmu->read_memory_16(OS_FILE_END_ADDRESS) - machine.mmu->read_memory_16(OS_FILE_START_ADDRESS),
+							      machine.mmu->read_memory_16(OS_FILE_START_ADDRESS),
+							      machine.mmu->read_memory_16(OS_FILE_END_ADDRESS));
+				} else {
+					hud.blitter->terminal_printf(hud.terminal->number, "[MMU] Error: can't open %s\n", event.text);
+				}
+				break;
+			case E64::HOST_EVENT_NOTIFICATION:
+				hud.show_notification("%s", event.text);
+				break;
+		}
+	}
 	
-	printf("[E64] Virtual machine ran for %.2f seconds\n",
-	       (double)std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() / 1000
-	);
+	host.key_states[E64::SCANCODE_GRAVE] = (machine.cia->registers[E64::SCANCODE_GRAVE] << 1) | (host.key_states[E64::SCANCODE_GRAVE] & 0x01);
+	machine.update_key_states(host.key_states);
+}
 
-	E64::sdl2_cleanup();
-	return 0;
+/*
+ * Turbo mode runs the machine unthrottled. Only one in a number of
+ * frames is drawn and handed over, and sound is dropped.
+ */
+static void set_turbo(bool on)
+{
+	host.settings->turbo = on;
+	update_render_interval();
+	machine.connect_audio_sink(on ? nullptr : host.audio);
+}
+
+/*
+ * Outside turbo mode, frames are skipped when the host can't keep up.
+ * Cpu and sound keep running at full rate.
+ */
+static void update_render_interval()
+{
+	uint16_t interval = host.settings->turbo ? host.settings->turbo_render_interval : stats.frameskip();
+	if (interval != machine.get_render_interval()) machine.set_render_interval(interval);
 }
 
 static void finish_frame()
 {
-	if (E64::sdl2_process_events() == E64::QUIT_EVENT) app_running = false;
+	process_host_events();
+	
+	bool turbo = host.settings->turbo && (machine.mode == E64::RUNNING);
+	bool render = (machine.mode == E64::PAUSED) || machine.frame_rendered();
+	
+	/*
+	 * With fresh input, emulate ahead and show the speculative frame
+	 */
+	stats.start_run_ahead_time();
+	machine.run_ahead(((machine.mode == E64::RUNNING) && !turbo) ? host.settings->run_ahead_frames : 0);
+	stats.end_run_ahead_time();
 	
 	if (machine.mode == E64::PAUSED) {
 		hud.process_keypress();
 		hud.update_views();
 	}
 	
-	hud.update_stats_view();
-	hud.redraw();
+	if (render) {
+		hud.update_stats_view();
+		hud.redraw();
+	}
 	
 	// time measurement
 	stats.start_update_textures_time();
-
-	host.video->update_textures();
+	
+	if ((machine.mode == E64::RUNNING) && (stats.last_frame_vm_time() > host.settings->slow_frame_budget))
+		machine.log_slow_frame(stats.last_frame_vm_time(), host.settings->slow_frame_budget);
+	
+	/*
+	 * Hand over the frame to the presentation thread
+	 */
+	if (render) {
+		struct E64::frame_t *frame = host.frames->back_frame();
+		memcpy(frame->vm_fb, machine.display_fb(), VM_MAX_PIXELS_PER_SCANLINE * VM_MAX_SCANLINES * sizeof(uint16_t));
+		memcpy(frame->hud_fb, hud.blitter->fb, HUD_PIXELS_PER_SCANLINE * HUD_SCANLINES * sizeof(uint16_t));
+		frame->screen_size = machine.blitter->screen_size;
+		frame->scanline_screen_size = machine.blitter->scanline_screen_size;
+		frame->mode = machine.mode;
+		host.frames->publish();
+	}
 	
 	// time measurement
 	stats.start_idle_time();
 	
+	refresh_moment += std::chrono::microseconds(stats.frametime);
 	/*
-	 * If vsync is enabled, the update screen function takes more
-	 * time, i.e. it will return after a few milliseconds, exactly
-	 * when vertical refresh is done. This will avoid tearing.
-	 * There's no need then to let the system sleep with a
-	 * calculated value. But we will still have to do a time
-	 * measurement for estimation of idle time.
-	 *
-	 * When there's no vsync, a sleep time is implemented manually.
+	 * Check if the next update is in the past,
+	 * this can be the result of a debug session.
+	 * If so, calculate a new update moment. This will
+	 * avoid "playing catch-up" by the virtual machine.
+	 * In turbo mode, there's no waiting at all.
 	 */
-	if (host.video->vsync_disabled()) {
-		refresh_moment += std::chrono::microseconds(stats.frametime);
-		/*
-		 * Check if the next update is in the past,
-		 * this can be the result of a debug session.
-		 * If so, calculate a new update moment. This will
-		 * avoid "playing catch-up" by the virtual machine.
-		 */
-		if (refresh_moment > std::chrono::steady_clock::now()) {
-			std::this_thread::sleep_until(refresh_moment);
-		} else {
-			refresh_moment = std::chrono::steady_clock::now();
-		}
+	if (!turbo && (refresh_moment > std::chrono::steady_clock::now())) {
+		std::this_thread::sleep_until(refresh_moment);
+	} else {
+		refresh_moment = std::chrono::steady_clock::now();
 	}
 	
-	host.video->update_screen();
-	
 	/*
 	 * time measurement, starting vm time
 	 *
@@ -132,4 +282,5 @@ static void finish_frame()
 	stats.start_vm_time();
 	
 	stats.process_parameters();
+	update_render_interval();
 }